@@ -13,12 +13,94 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+/* io_uring through raw system calls, DB_NO_IO_URING forces the pread
+ * threads */
+#if defined(__linux__) && !defined(DB_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DB_AIO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DB_SCAN_X86
+#endif
 
 #include "db.h"
 
 #define USE_GREGORIAN_CALENDAR
 
+#define DB_PAGE_DEF_CACHE_SIZE (16*1024*1024)
+#define DB_PAGE_DEF_BLK_SIZE (64*1024)
+#define DB_PAGE_DEF_READ_AHEAD (4)
+#define DB_PAGE_MAX_LOAD (256) /* most blocks filled by one vectored read */
+
+/* records per chunk handed to a scan worker, a multiple of 64 so each
+ * word of a selection bitmap belongs to a single chunk */
+#define DB_PAR_CHUNK_SIZE (256*1024)
+#define DB_PAR_MAX_WORKER (256)
+
+/* asynchronous reads kept in flight and the threads serving them
+ * when io_uring is not available */
+#define DB_AIO_DEPTH (8)
+#define DB_AIO_THREAD_NUM (4)
+#define DB_AIO_CHUNK_SIZE (1024*1024)
+#define DB_AIO_SUBMIT_TRY (8) /* interrupted io_uring_enter calls retried */
+
+/* state of struct db_aio_req */
+#define DB_AIO_FREE (0)
+#define DB_AIO_QUEUED (1)
+#define DB_AIO_RUNNING (2)
+#define DB_AIO_DONE (3)
+
+/* bytes of a memo read along with its header when it is not mapped */
+#define DB_MEMO_READ_SIZE (4096)
+
+/* block size of an arena created with a size of 0 */
+#define DB_ARENA_DEF_BLK_SIZE (64*1024)
+
+/* output buffered by db_export before it is handed to the writer */
+#define DB_EXPORT_BUF_SIZE (1024*1024)
+#define DB_EXPORT_MAX_PENDING (16) /* parallel chunks formatted ahead of the writer */
+
+/* julian day of 1970-01-01 */
+#define DB_JD_EPOCH (2440588)
+#define DB_PAGE_NONE (0xffffffff)
+
+#define DB_HIX_MAGIC (0x58484244) /* "DBHX" */
+#define DB_HIX_VERSION (2)
+
+#define DB_IXF_NODE_SIZE (512)
+#define DB_IXF_NONE (0xffffffff)
+#define DB_IXF_OPT_UNIQUE (0x01)
+#define DB_IXF_OPT_FOR (0x08)
+#define DB_IXF_OPT_COMPACT (0x20)
+#define DB_IXF_OPT_COMPOUND (0x40)
+#define DB_IXF_ATTR_LEAF (0x02)
+#define DB_IXF_COLLATE_OFF (92)  /* collation name and table of a .CDX tag header */
+#define DB_IXF_COLLATE_LEN (282)
+
+/* whether a tag holds a key for every record of the table */
+#define DB_TAG_UNCHECKED (0)
+#define DB_TAG_COMPLETE (1)
+#define DB_TAG_PARTIAL (2)
+
 #define swap_byte(a, b) \
     do { \
         a^=b; \
@@ -31,6 +113,7 @@ struct db_field
     char s_name[12];
     uint8_t u8_type;
     uint8_t u8_len;
+    uint8_t u8_dec;
     uint32_t u32_acc_len;
     //uint8_t u8_flag;
     //uint16_t u16_auto_inc_next;
@@ -64,15 +147,274 @@ struct db_memo_hdr
     uint16_t u16_blk_size;
 };
 
+struct db_aio_req
+{
+    void *pv_buf;
+    size_t t_len;
+    off_t t_off;
+    ssize_t t_ret;
+    uint32_t u32_seq; /* submit order, the pread threads serve the oldest */
+    uint8_t u8_state;
+};
+
+/* reads on one file descriptor, served by io_uring or pread threads */
+struct db_aio
+{
+    int i_fd;
+    uint32_t u32_seq;
+    struct db_aio_req ast_req[DB_AIO_DEPTH];
+
+#ifdef DB_AIO_URING
+    /* -1 when the kernel refused a ring */
+    int i_ring_fd;
+    uint8_t *pu8_sq_ring;
+    size_t t_sq_len;
+    uint8_t *pu8_cq_ring;
+    size_t t_cq_len;
+    struct io_uring_sqe *ast_sqe;
+    size_t t_sqe_len;
+    struct io_uring_params st_param;
+#endif
+
+    /* started on first use when there is no ring */
+    uint32_t u32_thread_num;
+    pthread_t ast_thread[DB_AIO_THREAD_NUM];
+    pthread_mutex_t st_lock;
+    pthread_cond_t st_cond;
+    bool b_stop;
+};
+
+struct db_page
+{
+    uint32_t u32_blk_idx;
+    uint32_t u32_rec_num;
+    uint16_t u16_pin;
+    bool b_ref;
+    int8_t i8_aio_slot; /* read ahead still in flight, -1 if none */
+    uint8_t *pu8_data;
+};
+
+struct db_page_cache
+{
+    uint32_t u32_blk_rec_num;
+    uint32_t u32_blk_num;
+    uint32_t u32_page_num;
+    uint32_t u32_page_max; /* pages the memory budget allows */
+    uint8_t u8_read_ahead;
+
+    /* CLOCK hand and the last block touched for sequential detection */
+    uint32_t u32_hand;
+    uint32_t u32_last_blk;
+
+    struct db_page *ast_page;
+    /* page buffers, NULL for lazy access which allocates each page */
+    uint8_t *pu8_data;
+
+    /* block index to page index, DB_PAGE_NONE when not resident */
+    uint32_t *pu32_blk_map;
+
+    /* guards the pages, pins and CLOCK state for concurrent cursors */
+    pthread_mutex_t st_lock;
+
+    /* reads ahead of a sequential scan, NULL for synchronous reads */
+    struct db_aio *pst_aio;
+};
+
+struct db_index
+{
+    uint32_t u32_field_idx;
+    uint32_t u32_rec_num;
+    uint32_t u32_bucket_mask;
+
+    /* arrays point into the sidecar mapping instead of the heap */
+    bool b_mapped;
+
+    /* first record id+1 of each bucket, 0 when empty */
+    uint32_t *pu32_bucket;
+    /* next record id+1 in the same bucket, ascending */
+    uint32_t *pu32_next;
+    /* key hash of every record */
+    uint32_t *pu32_hash;
+    /* last record id+1 of each bucket, built when records are appended */
+    uint32_t *pu32_tail;
+};
+
+/* an opened FoxPro index file (.CDX/.IDX), mapped read-only */
+struct db_ixf
+{
+    uint8_t *pu8_map;
+    size_t t_map_len;
+    bool b_stale; /* written before the table was last modified */
+};
+
+/* how a lookup key is turned into the key stored in a tag */
+enum db_tag_key
+{
+    DB_TAG_KEY_NONE = 0, /* expression not understood */
+    DB_TAG_KEY_RAW,      /* field bytes as they are */
+    DB_TAG_KEY_UPPER,    /* UPPER(field) */
+    DB_TAG_KEY_NUM,      /* N/F field as sortable double */
+    DB_TAG_KEY_DATE,     /* D field as sortable julian day */
+    DB_TAG_KEY_INT,      /* I field with the sign bit flipped */
+};
+
+struct db_tag
+{
+    char s_name[11];
+    char *s_expr;
+    char *s_for;
+    struct db_ixf *pst_ixf;
+
+    uint32_t u32_root;
+    uint16_t u16_key_len;
+    uint8_t u8_option;
+    bool b_compact;
+    bool b_desc;
+    bool b_machine;
+    uint8_t u8_complete; /* DB_TAG_xxx, checked on first lookup */
+
+    int16_t i16_field_idx;
+    enum db_tag_key e_key;
+};
+
+/* sidecar index file (.HIX), host byte order, laid out to be used in
+ * place once mapped: header, one entry per hash index, one entry per
+ * ordered index, then the bucket, next and hash arrays of every hash
+ * index and, 8 bytes aligned, the keys and record ids of every ordered
+ * index */
+struct db_hix_hdr
+{
+    uint32_t u32_magic;
+    uint32_t u32_version;
+    uint8_t au8_last_update[3];
+    uint8_t u8_reserved;
+    uint32_t u32_rec_num;
+    uint64_t u64_file_size;
+    uint32_t u32_index_num;
+    uint32_t u32_order_num;
+};
+
+struct db_hix_entry
+{
+    uint32_t u32_field_idx;
+    uint32_t u32_acc_len;
+    uint32_t u32_field_len;
+    uint32_t u32_bucket_mask;
+    uint64_t u64_offset;
+};
+
+struct db_hix_order
+{
+    uint32_t u32_field_idx;
+    uint32_t u32_acc_len;
+    uint32_t u32_field_len;
+    uint32_t u32_num;
+    uint64_t u64_offset;
+};
+
+struct db_order
+{
+    uint32_t u32_field_idx;
+    uint32_t u32_num;
+    bool b_mapped; /* arrays point into the sidecar mapping */
+
+    /* keys in ascending order and the record id of each key */
+    int64_t *pi64_key;
+    uint32_t *pu32_rec_id;
+};
+
+enum db_filter_op
+{
+    DB_FILTER_OP_NONE = 0, /* never matches */
+    DB_FILTER_OP_EQ,
+    DB_FILTER_OP_PREFIX,
+    DB_FILTER_OP_RANGE,
+    DB_FILTER_OP_IN,
+    DB_FILTER_OP_AND,
+    DB_FILTER_OP_OR,
+    DB_FILTER_OP_NOT,
+};
+
+/* how field bytes are turned into keys which sort by memcmp */
+enum db_filter_val
+{
+    DB_FILTER_VAL_RAW = 0, /* field bytes as they are */
+    DB_FILTER_VAL_DATE,    /* D field, blank dates never match */
+    DB_FILTER_VAL_NUM,     /* N/F field as fixed point with the field decimals */
+    DB_FILTER_VAL_NUM_DBL, /* N/F field too wide for the fixed point, as double */
+    DB_FILTER_VAL_INT,     /* I field */
+    DB_FILTER_VAL_CUR,     /* Y field */
+    DB_FILTER_VAL_DBL,     /* B field */
+    DB_FILTER_VAL_TIME,    /* T field */
+};
+
+struct db_filter
+{
+    enum db_filter_op e_op;
+    enum db_filter_val e_val;
+
+    uint32_t u32_offset;
+    uint8_t u8_len;
+    uint8_t u8_dec;
+
+    /* keys of u32_key_len bytes, sorted for IN, lowest and highest for RANGE */
+    uint32_t u32_key_len;
+    uint32_t u32_key_num;
+    uint8_t *pu8_key;
+    bool b_lo;
+    bool b_hi;
+
+    struct db_filter *pst_left;
+    struct db_filter *pst_right;
+};
+
+/* block of an arena, the data follows the header */
+struct db_arena_blk
+{
+    struct db_arena_blk *pst_next;
+    size_t t_size;
+    uint8_t *pu8_data;
+};
+
+struct db_arena
+{
+    struct db_arena_blk *pst_head;
+    struct db_arena_blk *pst_cur; /* NULL until the first allocation after a reset */
+    size_t t_used;                /* bytes taken from the current block */
+    size_t t_blk_size;
+};
+
 struct db_itor
 {
     uint32_t u32_buf_len;
     uint8_t *pu8_buf;
 
+    /* records not matching the filter are skipped, NULL for all */
+    struct db_filter *pst_filter;
+
     db_pf_itor pf_itor;
     void *pv_usr_data;
 };
 
+struct db_cursor
+{
+    struct db *pst_db;
+
+    /* next record to visit */
+    uint32_t u32_pos;
+
+    /* copy of the current record when it is not resident */
+    uint32_t u32_buf_len;
+    uint8_t *pu8_buf;
+
+    /* copies of the records of the last batch when not resident */
+    uint32_t u32_batch_cap;
+    uint8_t *pu8_batch;
+
+    /* records not matching the filter are skipped, NULL for all */
+    struct db_filter *pst_filter;
+};
+
 struct db
 {
     char *s_db_name;
@@ -80,14 +422,57 @@ struct db
     char *s_memo_name;
     FILE *pf_memo;
 
+    /* read-only mapping of the memo file, NULL to read it with pread */
+    uint8_t *pu8_memo_map;
+    size_t t_memo_map_len;
+
+    /* read ahead of db_memo_stream, created on first use and held by
+     * one stream at a time */
+    struct db_aio *pst_memo_aio;
+    pthread_mutex_t st_memo_aio_lock;
+
     struct db_file_hdr st_file_hdr;
     struct db_memo_hdr st_memo_hdr;
 
     struct db_field_info st_field_info;
 
-    /* cache for record data */
+    /* record access mode (DB_ACCESS_xxx) */
+    uint8_t u8_access;
+
+    /* code page of text, the header one unless db_config.s_encode is given */
+    uint8_t u8_code_page;
+
+    /* file mapping when accessed by DB_ACCESS_MMAP */
+    uint8_t *pu8_map;
+    size_t t_map_len;
+
+    /* cache for record data, points into the mapping for DB_ACCESS_MMAP */
     uint8_t *pu8_rec_cache;
 
+    /* block cache for DB_ACCESS_PAGED */
+    struct db_page_cache *pst_page_cache;
+
+    /* hash index of each field, NULL when not built */
+    struct db_index **apst_index;
+
+    /* ordered index of each field, NULL when not built */
+    struct db_order **apst_order;
+
+    /* FoxPro index files and the tags they hold */
+    struct db_ixf **apst_ixf;
+    uint8_t u8_ixf_num;
+    struct db_tag *ast_tag;
+    uint16_t u16_tag_num;
+    /* records which existed when the first tag was read, tags know
+     * nothing of records appended later */
+    uint32_t u32_tag_rec_num;
+
+    /* sidecar index file and its mapping */
+    char *s_hix_name;
+    uint8_t *pu8_hix_map;
+    size_t t_hix_len;
+    bool b_index_dirty;
+
     /* iterator object */
     struct db_itor *pst_itor;
 
@@ -132,7 +517,45 @@ static void _remove_trailing_space(char *s_str)
     }
 }
 
-static void _db_JD_to_date(uint8_t *au8_jd, struct db_date *pst_date)
+/* strip the padding of field data, C fields are left aligned and
+ * N/F fields are right aligned, a blank D field becomes empty */
+static const uint8_t *_db_field_trim(
+        const struct db_field *pst_field,
+        const uint8_t *pu8_data,
+        uint32_t *pu32_len)
+{
+    uint32_t u32_len = pst_field->u8_len;
+
+    switch(toupper(pst_field->u8_type))
+    {
+        case 'N':
+        case 'F':
+            while((u32_len > 0) && (' ' == pu8_data[0]))
+            {
+                pu8_data++;
+                u32_len--;
+            }
+            /* fall through */
+        case 'C':
+            while((u32_len > 0) && ((' ' == pu8_data[u32_len-1]) || ('\0' == pu8_data[u32_len-1])))
+                u32_len--;
+            break;
+        case 'D':
+            if(' ' == pu8_data[0])
+                u32_len = 0;
+            break;
+        case 'L':
+            u32_len = 1;
+            break;
+        default:
+            break;
+    }
+
+    *pu32_len = u32_len;
+    return pu8_data;
+}
+
+static void _db_JD_to_date(const uint8_t *au8_jd, struct db_date *pst_date)
 {
     uint32_t u32_jdn;
     uint32_t u32_ms;
@@ -162,6 +585,14 @@ static void _db_JD_to_date(uint8_t *au8_jd, struct db_date *pst_date)
     pst_date->u8_sec = u32_ms/1000;
 }
 
+/* blank T fields are all spaces or all zeros, any byte of a julian
+ * day may be a space */
+static bool _db_time_is_blank(const uint8_t *pu8_data)
+{
+    return (0 == memcmp((void *)pu8_data, (void *)"        ", 8)) ||
+           (0 == memcmp((void *)pu8_data, (void *)"\0\0\0\0\0\0\0\0", 8));
+}
+
 static void _db_read_field_desc(struct db *pst_db)
 {
     FILE *fp = pst_db->pf_db;
@@ -186,6 +617,7 @@ static void _db_read_field_desc(struct db *pst_db)
         memcpy((void *)pst_field->s_name, (void *)data, 11);
         pst_field->u8_type = data[11];
         pst_field->u8_len = data[16];
+        pst_field->u8_dec = data[17];
         pst_field->u32_acc_len = u32_acc_len;
 
         *ppst_field = pst_field;
@@ -228,6 +660,16 @@ static void _db_read_file_header(struct db *pst_db)
     pst_hdr->u8_code_page = data[29];
 }
 
+static uint32_t _db_get_le32(const uint8_t *pu8_data)
+{
+    return (uint32_t)pu8_data[3]<<24 | pu8_data[2]<<16 | pu8_data[1]<<8 | pu8_data[0];
+}
+
+static uint32_t _db_get_be32(const uint8_t *pu8_data)
+{
+    return (uint32_t)pu8_data[0]<<24 | pu8_data[1]<<16 | pu8_data[2]<<8 | pu8_data[3];
+}
+
 static void _db_read_memo_header(struct db *pst_db)
 {
     FILE *fp = pst_db->pf_memo;
@@ -241,543 +683,8325 @@ static void _db_read_memo_header(struct db *pst_db)
     pst_hdr->u16_blk_size = (uint16_t)(data[6]<<8) | data[7];
 }
 
-static uint32_t _db_memo_read(
+static void _db_memo_map_init(struct db *pst_db)
+{
+    struct stat st_stat;
+    void *pv_map;
+
+    if((0 != fstat(fileno(pst_db->pf_memo), &st_stat)) || (0 == st_stat.st_size))
+        return;
+
+    pv_map = mmap(NULL, st_stat.st_size, PROT_READ, MAP_SHARED, fileno(pst_db->pf_memo), 0);
+    if(MAP_FAILED == pv_map)
+        return;
+
+    pst_db->pu8_memo_map = (uint8_t *)pv_map;
+    pst_db->t_memo_map_len = st_stat.st_size;
+}
+
+/* locate a memo with a single fetch of its header and data; mapped
+ * memos are returned in place, otherwise up to u32_buf_len bytes are
+ * read into pu8_buf. *pu32_len is the whole memo length and
+ * *pu32_avail the bytes available at the returned address */
+static const uint8_t *_db_memo_fetch(
         struct db *pst_db,
         uint32_t u32_blk_idx,
         uint8_t *pu8_buf,
-        uint32_t u32_buf_len)
+        uint32_t u32_buf_len,
+        uint32_t *pu32_len,
+        uint32_t *pu32_avail)
 {
-    FILE *fp = pst_db->pf_memo;
     uint16_t u16_blk_size = pst_db->st_memo_hdr.u16_blk_size;
-    uint32_t u32_len = 0;
-    uint8_t au8_data[8];
+    off_t t_offset = (off_t)u32_blk_idx*u16_blk_size;
+    uint8_t au8_hdr[8];
+    struct iovec ast_iov[2];
+    ssize_t t_read;
 
-    do
+    if((0 == u32_blk_idx) || (0 == u16_blk_size))
+        return NULL;
+
+    if(NULL != pst_db->pu8_memo_map)
     {
-        if(!fp)
-            break;
+        const uint8_t *pu8_memo = &pst_db->pu8_memo_map[t_offset];
+        size_t t_left;
 
-        if(0 != fseek(fp, u16_blk_size*u32_blk_idx, SEEK_SET))
-            break;
+        if((size_t)t_offset+8 > pst_db->t_memo_map_len)
+            return NULL;
 
-        fread((void *)au8_data, 1, 8, fp);
-        u32_len = au8_data[4]<<24 |
-                  au8_data[5]<<16 |
-                  au8_data[6]<<8 |
-                  au8_data[7];
+        /* never hand out bytes beyond the end of a truncated file */
+        t_left = pst_db->t_memo_map_len-t_offset-8;
+        *pu32_len = _db_get_be32(&pu8_memo[4]);
+        *pu32_avail = (*pu32_len > t_left)?(t_left):(*pu32_len);
 
-        if((NULL != pu8_buf) && (0 != u32_buf_len))
-        {
-            if(u32_len > u32_buf_len)
-                u32_len = u32_buf_len;
+        return &pu8_memo[8];
+    }
 
-            if(u32_len != fread((void *)pu8_buf, 1, u32_len, fp))
-                break;
-        }
+    if(NULL == pst_db->pf_memo)
+        return NULL;
 
-        return u32_len;
-    }while(0);
+    ast_iov[0].iov_base = (void *)au8_hdr;
+    ast_iov[0].iov_len = 8;
+    ast_iov[1].iov_base = (void *)pu8_buf;
+    ast_iov[1].iov_len = (NULL == pu8_buf)?(0):(u32_buf_len);
 
-    return 0;
-}
+    t_read = preadv(fileno(pst_db->pf_memo), ast_iov, 2, t_offset);
+    if(t_read < 8)
+        return NULL;
+
+    *pu32_len = _db_get_be32(&au8_hdr[4]);
+    *pu32_avail = ((uint32_t)(t_read-8) > *pu32_len)?(*pu32_len):(t_read-8);
 
+    return pu8_buf;
+}
 
-static bool _db_rec_cache_init(struct db *pst_db)
+/* read a whole memo into an allocated buffer with u32_extra spare
+ * bytes after it, one read unless the memo is larger than the first
+ * read window */
+static uint8_t *_db_memo_load(
+        struct db *pst_db,
+        uint32_t u32_blk_idx,
+        uint32_t u32_extra,
+        uint32_t *pu32_len)
 {
-    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    uint16_t u16_blk_size = pst_db->st_memo_hdr.u16_blk_size;
+    uint32_t u32_window = DB_MEMO_READ_SIZE;
+    const uint8_t *pu8_memo;
+    uint8_t *pu8_buf = NULL;
+    uint32_t u32_len = 0;
+    uint32_t u32_avail = 0;
 
-    pst_db->pu8_rec_cache = (uint8_t *)malloc(pst_hdr->u32_rec_num*pst_hdr->u16_rec_len);
-    if(NULL == pst_db->pu8_rec_cache)
-        return false;
+    if(NULL != pst_db->pu8_memo_map)
+    {
+        pu8_memo = _db_memo_fetch(pst_db, u32_blk_idx, NULL, 0, &u32_len, &u32_avail);
+        if(NULL == pu8_memo)
+            return NULL;
 
-    fseek(pst_db->pf_db, pst_hdr->u16_hdr_len, SEEK_SET);
-    fread((void *)pst_db->pu8_rec_cache, 1, pst_hdr->u32_rec_num*pst_hdr->u16_rec_len, pst_db->pf_db);
+        pu8_buf = (uint8_t *)malloc((size_t)u32_avail+u32_extra);
+        if(!pu8_buf)
+            return NULL;
 
-    return true;
-}
+        memcpy((void *)pu8_buf, (void *)pu8_memo, u32_avail);
+        *pu32_len = u32_avail;
+        return pu8_buf;
+    }
 
-static bool _db_rec_cache_deinit(struct db *pst_db)
-{
-    free(pst_db->pu8_rec_cache);
-    return true;
+    /* read whole memo blocks, the first one less its header */
+    if(u16_blk_size > 8)
+        u32_window = ((DB_MEMO_READ_SIZE+u16_blk_size-1)/u16_blk_size)*u16_blk_size-8;
+
+    pu8_buf = (uint8_t *)malloc((size_t)u32_window+u32_extra);
+    if(!pu8_buf)
+        return NULL;
+
+    if(NULL == _db_memo_fetch(pst_db, u32_blk_idx, pu8_buf, u32_window, &u32_len, &u32_avail))
+    {
+        free(pu8_buf);
+        return NULL;
+    }
+
+    if(u32_len > u32_avail)
+    {
+        uint8_t *pu8_new = (uint8_t *)realloc(pu8_buf, (size_t)u32_len+u32_extra);
+        ssize_t t_read;
+
+        if(!pu8_new)
+        {
+            free(pu8_buf);
+            return NULL;
+        }
+
+        pu8_buf = pu8_new;
+
+        if(u32_avail == u32_window)
+        {
+            t_read = pread(
+                    fileno(pst_db->pf_memo),
+                    (void *)&pu8_buf[u32_avail],
+                    u32_len-u32_avail,
+                    (off_t)u32_blk_idx*u16_blk_size+8+u32_avail);
+
+            if(t_read > 0)
+                u32_avail += t_read;
+        }
+    }
+
+    *pu32_len = u32_avail;
+    return pu8_buf;
 }
 
-static bool _db_rec_cache_read(
-        struct db *pst_db,
-        uint32_t u32_rec_index,
-        uint8_t *pu8_data)
+/* bump t_len bytes from the arena, NULL on failure */
+static void *_db_arena_alloc(struct db_arena *pst_arena, size_t t_len)
 {
-    uint32_t u32_size = pst_db->st_file_hdr.u16_rec_len;
-    uint32_t u32_offset = u32_rec_index*u32_size;
+    struct db_arena_blk *pst_blk;
 
-    memcpy((void *)pu8_data, (void *)&pst_db->pu8_rec_cache[u32_offset], u32_size);
-    return true;
+    t_len = (t_len+7)&~(size_t)7;
+
+    if((NULL != pst_arena->pst_cur) && (pst_arena->t_used+t_len <= pst_arena->pst_cur->t_size))
+    {
+        void *pv_data = &pst_arena->pst_cur->pu8_data[pst_arena->t_used];
+
+        pst_arena->t_used += t_len;
+        return pv_data;
+    }
+
+    /* blocks kept by the last reset are used again in order */
+    pst_blk = (NULL != pst_arena->pst_cur)?(pst_arena->pst_cur->pst_next):(pst_arena->pst_head);
+
+    if((NULL == pst_blk) || (t_len > pst_blk->t_size))
+    {
+        size_t t_size = (t_len > pst_arena->t_blk_size)?(t_len):(pst_arena->t_blk_size);
+        struct db_arena_blk *pst_new = (struct db_arena_blk *)malloc(sizeof(struct db_arena_blk)+t_size);
+
+        if(!pst_new)
+            return NULL;
+
+        pst_new->t_size = t_size;
+        pst_new->pu8_data = (uint8_t *)&pst_new[1];
+        pst_new->pst_next = pst_blk;
+
+        if(NULL != pst_arena->pst_cur)
+            pst_arena->pst_cur->pst_next = pst_new;
+        else
+            pst_arena->pst_head = pst_new;
+
+        pst_blk = pst_new;
+    }
+
+    pst_arena->pst_cur = pst_blk;
+    pst_arena->t_used = t_len;
+
+    return pst_blk->pu8_data;
 }
 
-#if 0
-static bool _db_rec_cache_write(
+/* as _db_memo_load, with the memo allocated in the arena */
+static uint8_t *_db_memo_load_arena(
         struct db *pst_db,
-        uint32_t u32_rec_index,
-        uint8_t *pu8_data)
+        uint32_t u32_blk_idx,
+        uint32_t u32_extra,
+        uint32_t *pu32_len,
+        struct db_arena *pst_arena)
 {
-    uint32_t u32_size = pst_db->st_file_hdr.u16_rec_len;
-    uint32_t u32_offset = u32_rec_index*u32_size;
+    uint8_t au8_window[DB_MEMO_READ_SIZE];
+    const uint8_t *pu8_memo;
+    uint8_t *pu8_buf;
+    uint32_t u32_len = 0;
+    uint32_t u32_avail = 0;
 
-    memcpy((void *)&pst_db->pu8_rec_cache[u32_offset], (void *)pu8_data, u32_size);
-    return true;
-}
+    /* the first window is read on the stack so short memos take a
+     * single read and no more arena than their length */
+    pu8_memo = _db_memo_fetch(pst_db, u32_blk_idx, au8_window, sizeof(au8_window), &u32_len, &u32_avail);
+    if(NULL == pu8_memo)
+        return NULL;
 
-static bool _db_rec_cache_flush(struct db *pst_db)
-{
-    return true;
-}
-#endif
+    if(NULL != pst_db->pu8_memo_map)
+        u32_len = u32_avail;
 
-static bool _db_rec_read(struct db *pst_db, uint32_t u32_rec_idx, uint8_t *pu8_data)
-{
-    FILE *fp = pst_db->pf_db;
-    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    pu8_buf = (uint8_t *)_db_arena_alloc(pst_arena, (size_t)u32_len+u32_extra);
+    if(!pu8_buf)
+        return NULL;
 
-    if(u32_rec_idx >= pst_db->st_file_hdr.u32_rec_num)
-        return false;
+    memcpy((void *)pu8_buf, (void *)pu8_memo, u32_avail);
 
-    if(false == _db_rec_cache_read(pst_db, u32_rec_idx, pu8_data))
+    if(u32_len > u32_avail)
     {
-        /* error handle when cache miss */
-        fseek(fp, u16_rec_len*u32_rec_idx, SEEK_SET);
-        
+        ssize_t t_read = pread(
+                fileno(pst_db->pf_memo),
+                (void *)&pu8_buf[u32_avail],
+                u32_len-u32_avail,
+                (off_t)u32_blk_idx*pst_db->st_memo_hdr.u16_blk_size+8+u32_avail);
+
+        if(t_read > 0)
+            u32_avail += t_read;
     }
 
-    return true;
+    *pu32_len = u32_avail;
+    return pu8_buf;
 }
 
-#if 0
-static bool _db_rec_write(
-        struct db *pst_db,
-        uint32_t u32_rec_index,
-        uint8_t *pu8_data)
+
+static bool _db_rec_map_init(struct db *pst_db)
 {
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    struct stat st_stat;
+    uint32_t u32_rec_avail;
+    void *pv_map;
+
+    if(0 != fstat(fileno(pst_db->pf_db), &st_stat))
+        return false;
+
+    if((0 == st_stat.st_size) || (st_stat.st_size < pst_hdr->u16_hdr_len))
+        return false;
+
+    pv_map = mmap(NULL, st_stat.st_size, PROT_READ, MAP_SHARED, fileno(pst_db->pf_db), 0);
+    if(MAP_FAILED == pv_map)
+        return false;
+
+    pst_db->pu8_map = (uint8_t *)pv_map;
+    pst_db->t_map_len = st_stat.st_size;
+    pst_db->pu8_rec_cache = pst_db->pu8_map+pst_hdr->u16_hdr_len;
+
+    /* never hand out records beyond the end of a truncated file */
+    u32_rec_avail = (pst_hdr->u16_rec_len)?((st_stat.st_size-pst_hdr->u16_hdr_len)/pst_hdr->u16_rec_len):(0);
+    if(u32_rec_avail < pst_hdr->u32_rec_num)
+        pst_hdr->u32_rec_num = u32_rec_avail;
+
     return true;
 }
-#endif
 
-hdb db_open(char *s_file_name)
+/* read until t_len bytes or the end of file, network file systems
+ * may return less than asked */
+static ssize_t _db_pread_full(int i_fd, void *pv_buf, size_t t_len, off_t t_off)
 {
-    struct db *pst_db = NULL;
+    size_t t_done = 0;
 
-    do
+    while(t_done < t_len)
     {
-        /* open db file (.dbf) */
-        if(!s_file_name)
-            break;
+        ssize_t t_read = pread(i_fd, (uint8_t *)pv_buf+t_done, t_len-t_done, t_off+t_done);
 
-        pst_db = (struct db *)calloc(sizeof(struct db), 1);
-        if(!pst_db)
-            break;
+        if(t_read <= 0)
+            return (t_done)?((ssize_t)t_done):(t_read);
 
-        pst_db->s_db_name = strdup(s_file_name);
+        t_done += t_read;
+    }
 
-        pst_db->pf_db = fopen(s_file_name, "rb");
-        if(NULL == pst_db->pf_db)
-            break;
+    return t_done;
+}
 
-        _db_read_file_header(pst_db);
+static void *_db_aio_thread(void *pv_aio)
+{
+    struct db_aio *pst_aio = (struct db_aio *)pv_aio;
 
-        /* open memo file (.fpt) if available */
-        if(pst_db->st_file_hdr.u8_flag & 0x02)
+    pthread_mutex_lock(&pst_aio->st_lock);
+
+    while(false == pst_aio->b_stop)
+    {
+        struct db_aio_req *pst_req = NULL;
+
+        for(uint32_t idx=0; idx<DB_AIO_DEPTH; idx++)
         {
-            pst_db->s_memo_name = strdup(s_file_name);
-            sprintf(strchr(pst_db->s_memo_name, '.'), ".FPT");
+            struct db_aio_req *pst_cand = &pst_aio->ast_req[idx];
 
-            pst_db->pf_memo = fopen(pst_db->s_memo_name, "rb");
-            if(NULL == pst_db->pf_memo)
-            {
-                printf("warning: memo file missing.\n");
-            }
-            else
-            {
-                _db_read_memo_header(pst_db);
-            }
+            if((DB_AIO_QUEUED == pst_cand->u8_state) &&
+               ((NULL == pst_req) || ((int32_t)(pst_cand->u32_seq-pst_req->u32_seq) < 0)))
+                pst_req = pst_cand;
         }
 
-        /* parsing field description */
-        _db_read_field_desc(pst_db);
+        if(NULL == pst_req)
+        {
+            pthread_cond_wait(&pst_aio->st_cond, &pst_aio->st_lock);
+            continue;
+        }
 
-        _db_rec_cache_init(pst_db);
+        pst_req->u8_state = DB_AIO_RUNNING;
+        pthread_mutex_unlock(&pst_aio->st_lock);
 
-        return (hdb)pst_db;
-    }while(0);
+        pst_req->t_ret = _db_pread_full(pst_aio->i_fd, pst_req->pv_buf, pst_req->t_len, pst_req->t_off);
 
-    return INVALID_DB_HANDLE;
+        pthread_mutex_lock(&pst_aio->st_lock);
+        pst_req->u8_state = DB_AIO_DONE;
+        pthread_cond_broadcast(&pst_aio->st_cond);
+    }
+
+    pthread_mutex_unlock(&pst_aio->st_lock);
+
+    return NULL;
 }
 
-bool db_close(hdb h_db)
+#ifdef DB_AIO_URING
+static bool _db_aio_ring_init(struct db_aio *pst_aio)
 {
-    struct db *pst_db = (struct db *)h_db;
+    struct io_uring_params *pst_param = &pst_aio->st_param;
+    void *pv_map;
 
-    if(pst_db->s_db_name)
-        free(pst_db->s_db_name);
+    memset((void *)pst_param, 0, sizeof(struct io_uring_params));
 
-    if(pst_db->s_memo_name)
-        free(pst_db->s_memo_name);
+    pst_aio->i_ring_fd = syscall(__NR_io_uring_setup, DB_AIO_DEPTH, pst_param);
+    if(pst_aio->i_ring_fd < 0)
+        return false;
 
-    if(pst_db->pf_db)
-        fclose(pst_db->pf_db);
+    pst_aio->t_sq_len = pst_param->sq_off.array+pst_param->sq_entries*sizeof(uint32_t);
+    pst_aio->t_cq_len = pst_param->cq_off.cqes+pst_param->cq_entries*sizeof(struct io_uring_cqe);
+    pst_aio->t_sqe_len = pst_param->sq_entries*sizeof(struct io_uring_sqe);
 
-    if(pst_db->pf_memo)
-        fclose(pst_db->pf_memo);
+    pv_map = mmap(NULL, pst_aio->t_sq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, pst_aio->i_ring_fd, IORING_OFF_SQ_RING);
+    if(MAP_FAILED == pv_map)
+        goto fail;
 
-    /* free find function buffer */
-    free(pst_db->pu8_find_buf);
+    pst_aio->pu8_sq_ring = (uint8_t *)pv_map;
 
-    /* free field info */
+    pv_map = mmap(NULL, pst_aio->t_cq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, pst_aio->i_ring_fd, IORING_OFF_CQ_RING);
+    if(MAP_FAILED == pv_map)
+        goto fail;
+
+    pst_aio->pu8_cq_ring = (uint8_t *)pv_map;
+
+    pv_map = mmap(NULL, pst_aio->t_sqe_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, pst_aio->i_ring_fd, IORING_OFF_SQES);
+    if(MAP_FAILED == pv_map)
+        goto fail;
+
+    pst_aio->ast_sqe = (struct io_uring_sqe *)pv_map;
+
+    return true;
+
+fail:
+    if(pst_aio->pu8_sq_ring)
+        munmap((void *)pst_aio->pu8_sq_ring, pst_aio->t_sq_len);
+
+    if(pst_aio->pu8_cq_ring)
+        munmap((void *)pst_aio->pu8_cq_ring, pst_aio->t_cq_len);
+
+    close(pst_aio->i_ring_fd);
+    pst_aio->i_ring_fd = -1;
+    pst_aio->pu8_sq_ring = NULL;
+    pst_aio->pu8_cq_ring = NULL;
+
+    return false;
+}
+
+static bool _db_aio_ring_submit(struct db_aio *pst_aio, uint32_t u32_slot)
+{
+    struct io_uring_params *pst_param = &pst_aio->st_param;
+    struct db_aio_req *pst_req = &pst_aio->ast_req[u32_slot];
+    uint32_t *pu32_head = (uint32_t *)&pst_aio->pu8_sq_ring[pst_param->sq_off.head];
+    uint32_t *pu32_tail = (uint32_t *)&pst_aio->pu8_sq_ring[pst_param->sq_off.tail];
+    uint32_t u32_mask = *(uint32_t *)&pst_aio->pu8_sq_ring[pst_param->sq_off.ring_mask];
+    uint32_t u32_tail = *pu32_tail;
+    struct io_uring_sqe *pst_sqe = &pst_aio->ast_sqe[u32_tail&u32_mask];
+
+    memset((void *)pst_sqe, 0, sizeof(struct io_uring_sqe));
+    pst_sqe->opcode = IORING_OP_READ;
+    pst_sqe->fd = pst_aio->i_fd;
+    pst_sqe->addr = (uint64_t)(uintptr_t)pst_req->pv_buf;
+    pst_sqe->len = pst_req->t_len;
+    pst_sqe->off = pst_req->t_off;
+    pst_sqe->user_data = u32_slot;
+
+    ((uint32_t *)&pst_aio->pu8_sq_ring[pst_param->sq_off.array])[u32_tail&u32_mask] = u32_tail&u32_mask;
+    __atomic_store_n(pu32_tail, u32_tail+1, __ATOMIC_RELEASE);
+
+    /* the kernel reads the tail on entry, so it is published first and
+     * the entry is retried until the kernel takes it */
+    for(int idx=0; idx<DB_AIO_SUBMIT_TRY; idx++)
     {
-        struct db_field_info *pst_info = &pst_db->st_field_info;
-        struct db_field *pst_field = pst_info->pst_field;
-        struct db_field *pst_next = pst_info->pst_field->pst_next;
+        long l_ret = syscall(__NR_io_uring_enter, pst_aio->i_ring_fd, 1, 0, 0, NULL, 0);
 
-        while(pst_field)
+        if((1 == l_ret) || (u32_tail != __atomic_load_n(pu32_head, __ATOMIC_ACQUIRE)))
+            return true;
+
+        if((l_ret < 0) && (EINTR != errno) && (EAGAIN != errno))
+            break;
+    }
+
+    /* without SQPOLL the ring is only read inside io_uring_enter, an
+     * entry it did not take can be withdrawn before a plain read */
+    if(u32_tail != __atomic_load_n(pu32_head, __ATOMIC_ACQUIRE))
+        return true;
+
+    __atomic_store_n(pu32_tail, u32_tail, __ATOMIC_RELEASE);
+
+    return false;
+}
+
+/* move finished reads to their slots, waiting for one if b_wait */
+static void _db_aio_ring_reap(struct db_aio *pst_aio, bool b_wait)
+{
+    struct io_uring_params *pst_param = &pst_aio->st_param;
+    uint32_t *pu32_head = (uint32_t *)&pst_aio->pu8_cq_ring[pst_param->cq_off.head];
+    uint32_t *pu32_tail = (uint32_t *)&pst_aio->pu8_cq_ring[pst_param->cq_off.tail];
+    uint32_t u32_mask = *(uint32_t *)&pst_aio->pu8_cq_ring[pst_param->cq_off.ring_mask];
+    struct io_uring_cqe *ast_cqe = (struct io_uring_cqe *)&pst_aio->pu8_cq_ring[pst_param->cq_off.cqes];
+    uint32_t u32_head = *pu32_head;
+
+    if((true == b_wait) && (u32_head == __atomic_load_n(pu32_tail, __ATOMIC_ACQUIRE)))
+        syscall(__NR_io_uring_enter, pst_aio->i_ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    for(; u32_head != __atomic_load_n(pu32_tail, __ATOMIC_ACQUIRE); u32_head++)
+    {
+        struct io_uring_cqe *pst_cqe = &ast_cqe[u32_head&u32_mask];
+        struct db_aio_req *pst_req = &pst_aio->ast_req[pst_cqe->user_data];
+
+        pst_req->t_ret = pst_cqe->res;
+        pst_req->u8_state = DB_AIO_DONE;
+    }
+
+    __atomic_store_n(pu32_head, u32_head, __ATOMIC_RELEASE);
+}
+
+static void _db_aio_ring_deinit(struct db_aio *pst_aio)
+{
+    if(pst_aio->i_ring_fd < 0)
+        return;
+
+    munmap((void *)pst_aio->ast_sqe, pst_aio->t_sqe_len);
+    munmap((void *)pst_aio->pu8_cq_ring, pst_aio->t_cq_len);
+    munmap((void *)pst_aio->pu8_sq_ring, pst_aio->t_sq_len);
+    close(pst_aio->i_ring_fd);
+}
+#endif
+
+static struct db_aio *_db_aio_create(int i_fd)
+{
+    struct db_aio *pst_aio = (struct db_aio *)calloc(1, sizeof(struct db_aio));
+
+    if(!pst_aio)
+        return NULL;
+
+    pst_aio->i_fd = i_fd;
+    pthread_mutex_init(&pst_aio->st_lock, NULL);
+    pthread_cond_init(&pst_aio->st_cond, NULL);
+
+#ifdef DB_AIO_URING
+    _db_aio_ring_init(pst_aio);
+#endif
+
+    return pst_aio;
+}
+
+/* queue a read, returns its slot or -1 when DB_AIO_DEPTH reads are
+ * in flight already */
+static int32_t _db_aio_submit(struct db_aio *pst_aio, void *pv_buf, size_t t_len, off_t t_off)
+{
+    struct db_aio_req *pst_req = NULL;
+    uint32_t u32_slot;
+
+    /* the workers look at the states too */
+    pthread_mutex_lock(&pst_aio->st_lock);
+
+    for(u32_slot=0; u32_slot<DB_AIO_DEPTH; u32_slot++)
+    {
+        if(DB_AIO_FREE == pst_aio->ast_req[u32_slot].u8_state)
         {
-            free(pst_field);
-            pst_field = pst_next;
+            pst_req = &pst_aio->ast_req[u32_slot];
+            break;
+        }
+    }
 
-            if(pst_field)
-                pst_next = pst_field->pst_next;
+    if(NULL == pst_req)
+    {
+        pthread_mutex_unlock(&pst_aio->st_lock);
+        return -1;
+    }
+
+    pst_req->pv_buf = pv_buf;
+    pst_req->t_len = t_len;
+    pst_req->t_off = t_off;
+    pst_req->t_ret = 0;
+
+#ifdef DB_AIO_URING
+    if(pst_aio->i_ring_fd >= 0)
+    {
+        pst_req->u8_state = DB_AIO_QUEUED;
+
+        /* a full or broken ring degrades to a plain read */
+        if(false == _db_aio_ring_submit(pst_aio, u32_slot))
+        {
+            pst_req->t_ret = _db_pread_full(pst_aio->i_fd, pv_buf, t_len, t_off);
+            pst_req->u8_state = DB_AIO_DONE;
         }
 
-        free(pst_info->a_field);
+        pthread_mutex_unlock(&pst_aio->st_lock);
+
+        return u32_slot;
     }
+#endif
 
-    /* deinit record cache */
-    _db_rec_cache_deinit(pst_db);
+    if(0 == pst_aio->u32_thread_num)
+    {
+        while((pst_aio->u32_thread_num < DB_AIO_THREAD_NUM) &&
+              (0 == pthread_create(&pst_aio->ast_thread[pst_aio->u32_thread_num], NULL, _db_aio_thread, (void *)pst_aio)))
+            pst_aio->u32_thread_num++;
+    }
 
-    memset((void *)pst_db, 0, sizeof(struct db));
-    free(pst_db);
+    if(0 == pst_aio->u32_thread_num)
+    {
+        pst_req->t_ret = _db_pread_full(pst_aio->i_fd, pv_buf, t_len, t_off);
+        pst_req->u8_state = DB_AIO_DONE;
+        pthread_mutex_unlock(&pst_aio->st_lock);
 
-    return true;
+        return u32_slot;
+    }
+
+    pst_req->u32_seq = pst_aio->u32_seq++;
+    pst_req->u8_state = DB_AIO_QUEUED;
+    pthread_cond_broadcast(&pst_aio->st_cond);
+    pthread_mutex_unlock(&pst_aio->st_lock);
+
+    return u32_slot;
 }
 
-bool db_get_info(hdb h_db, struct db_info *pst_info)
+/* wait for a read and free its slot, returns the bytes read */
+static ssize_t _db_aio_wait(struct db_aio *pst_aio, int32_t i32_slot)
 {
-    struct db_file_hdr *pst_hdr;
+    struct db_aio_req *pst_req = &pst_aio->ast_req[i32_slot];
+    ssize_t t_ret;
 
-    if(INVALID_DB_HANDLE == h_db || NULL == pst_info)
+#ifdef DB_AIO_URING
+    if(pst_aio->i_ring_fd >= 0)
     {
+        while(DB_AIO_DONE != pst_req->u8_state)
+            _db_aio_ring_reap(pst_aio, true);
+    }
+    else
+#endif
+    {
+        pthread_mutex_lock(&pst_aio->st_lock);
+
+        while(DB_AIO_DONE != pst_req->u8_state)
+            pthread_cond_wait(&pst_aio->st_cond, &pst_aio->st_lock);
+
+        pthread_mutex_unlock(&pst_aio->st_lock);
+    }
+
+    t_ret = pst_req->t_ret;
+
+    /* finish short reads and reads the ring could not do */
+    if(t_ret < 0)
+        t_ret = _db_pread_full(pst_aio->i_fd, pst_req->pv_buf, pst_req->t_len, pst_req->t_off);
+    else if(((size_t)t_ret < pst_req->t_len) && (t_ret > 0))
+    {
+        ssize_t t_rest = _db_pread_full(pst_aio->i_fd, (uint8_t *)pst_req->pv_buf+t_ret, pst_req->t_len-t_ret, pst_req->t_off+t_ret);
+
+        if(t_rest > 0)
+            t_ret += t_rest;
+    }
+
+    pthread_mutex_lock(&pst_aio->st_lock);
+    pst_req->u8_state = DB_AIO_FREE;
+    pthread_mutex_unlock(&pst_aio->st_lock);
+
+    return t_ret;
+}
+
+static void _db_aio_destroy(struct db_aio *pst_aio)
+{
+    if(!pst_aio)
+        return;
+
+    for(int32_t idx=0; idx<DB_AIO_DEPTH; idx++)
+    {
+        uint8_t u8_state;
+
+        pthread_mutex_lock(&pst_aio->st_lock);
+        u8_state = pst_aio->ast_req[idx].u8_state;
+        pthread_mutex_unlock(&pst_aio->st_lock);
+
+        if(DB_AIO_FREE != u8_state)
+            _db_aio_wait(pst_aio, idx);
+    }
+
+    pthread_mutex_lock(&pst_aio->st_lock);
+    pst_aio->b_stop = true;
+    pthread_cond_broadcast(&pst_aio->st_cond);
+    pthread_mutex_unlock(&pst_aio->st_lock);
+
+    for(uint32_t idx=0; idx<pst_aio->u32_thread_num; idx++)
+        pthread_join(pst_aio->ast_thread[idx], NULL);
+
+#ifdef DB_AIO_URING
+    _db_aio_ring_deinit(pst_aio);
+#endif
+
+    pthread_mutex_destroy(&pst_aio->st_lock);
+    pthread_cond_destroy(&pst_aio->st_cond);
+    free(pst_aio);
+}
+
+/* read a large range with DB_AIO_DEPTH chunks in flight */
+static size_t _db_aio_read_all(int i_fd, uint8_t *pu8_buf, size_t t_len, off_t t_off)
+{
+    struct db_aio *pst_aio = (t_len > DB_AIO_CHUNK_SIZE)?(_db_aio_create(i_fd)):(NULL);
+    int32_t ai32_slot[DB_AIO_DEPTH];
+    size_t t_next = 0;
+    size_t t_done = 0;
+    uint32_t u32_head = 0;
+    uint32_t u32_num = 0;
+
+    if(NULL == pst_aio)
+    {
+        ssize_t t_read = _db_pread_full(i_fd, pu8_buf, t_len, t_off);
+
+        return (t_read > 0)?(t_read):(0);
+    }
+
+    while((t_done < t_len) || (u32_num > 0))
+    {
+        /* keep the window full, then take the oldest chunk */
+        while((u32_num < DB_AIO_DEPTH) && (t_next < t_len))
+        {
+            size_t t_chunk = (t_len-t_next > DB_AIO_CHUNK_SIZE)?(DB_AIO_CHUNK_SIZE):(t_len-t_next);
+
+            ai32_slot[(u32_head+u32_num)%DB_AIO_DEPTH] = _db_aio_submit(pst_aio, &pu8_buf[t_next], t_chunk, t_off+t_next);
+            t_next += t_chunk;
+            u32_num++;
+        }
+
+        if(0 == u32_num)
+            break;
+
+        {
+            size_t t_chunk = (t_len-t_done > DB_AIO_CHUNK_SIZE)?(DB_AIO_CHUNK_SIZE):(t_len-t_done);
+            ssize_t t_read = _db_aio_wait(pst_aio, ai32_slot[u32_head]);
+
+            u32_head = (u32_head+1)%DB_AIO_DEPTH;
+            u32_num--;
+
+            /* stop at the end of a truncated file */
+            if((t_read < 0) || ((size_t)t_read < t_chunk))
+            {
+                t_done += (t_read > 0)?(t_read):(0);
+                t_len = t_done;
+                continue;
+            }
+
+            t_done += t_chunk;
+        }
+    }
+
+    _db_aio_destroy(pst_aio);
+
+    return t_done;
+}
+
+static bool _db_page_cache_init(struct db *pst_db, const struct db_config *pst_config)
+{
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    struct db_page_cache *pst_cache;
+    uint32_t u32_cache_size = DB_PAGE_DEF_CACHE_SIZE;
+    uint32_t u32_blk_len;
+
+    if(0 == pst_hdr->u16_rec_len)
         return false;
+
+    pst_cache = (struct db_page_cache *)calloc(1, sizeof(struct db_page_cache));
+    if(!pst_cache)
+        return false;
+
+    pst_cache->u32_blk_rec_num = DB_PAGE_DEF_BLK_SIZE/pst_hdr->u16_rec_len;
+    pst_cache->u8_read_ahead = DB_PAGE_DEF_READ_AHEAD;
+
+    if(pst_config)
+    {
+        if(pst_config->u32_cache_size)
+            u32_cache_size = pst_config->u32_cache_size;
+
+        if(pst_config->u32_blk_rec_num)
+            pst_cache->u32_blk_rec_num = pst_config->u32_blk_rec_num;
+
+        if(pst_config->u8_read_ahead)
+            pst_cache->u8_read_ahead = pst_config->u8_read_ahead;
     }
 
-    pst_hdr = &((struct db *)(h_db))->st_file_hdr;
+    if(0 == pst_cache->u32_blk_rec_num)
+        pst_cache->u32_blk_rec_num = 1;
 
-    pst_info->u8_type = pst_hdr->u8_type;
-    memcpy((void *)pst_info->au8_last_update, (void *)pst_hdr->au8_last_update, 3);
-    pst_info->u16_hdr_len = pst_hdr->u16_hdr_len;
-    pst_info->u32_rec_num = pst_hdr->u32_rec_num;
-    pst_info->u16_rec_len = pst_hdr->u16_rec_len;
-    pst_info->u8_enc = pst_hdr->u8_enc;
-    pst_info->u8_code_page = pst_hdr->u8_code_page;
+    /* a block never exceeds the cache size, which keeps its length in 32 bits */
+    if((size_t)pst_cache->u32_blk_rec_num*pst_hdr->u16_rec_len > u32_cache_size)
+        pst_cache->u32_blk_rec_num = (u32_cache_size > pst_hdr->u16_rec_len)?(u32_cache_size/pst_hdr->u16_rec_len):(1);
+
+    u32_blk_len = pst_cache->u32_blk_rec_num*pst_hdr->u16_rec_len;
+    pst_cache->u32_blk_num = ((uint64_t)pst_hdr->u32_rec_num+pst_cache->u32_blk_rec_num-1)/pst_cache->u32_blk_rec_num;
+
+    /* a block in use by an iterator, one by a nested find and the read ahead window */
+    pst_cache->u32_page_num = u32_cache_size/u32_blk_len;
+    if(pst_cache->u32_page_num < pst_cache->u8_read_ahead+3)
+        pst_cache->u32_page_num = pst_cache->u8_read_ahead+3;
+
+    pst_cache->u32_page_max = pst_cache->u32_page_num;
+
+    /* lazy access keeps every block once it is read */
+    if((pst_cache->u32_page_num > pst_cache->u32_blk_num) || (DB_ACCESS_LAZY == pst_db->u8_access))
+        pst_cache->u32_page_num = pst_cache->u32_blk_num;
+
+    /* an empty table keeps its read ahead until it has grown */
+    if((pst_cache->u32_blk_num > 0) && (pst_cache->u8_read_ahead >= pst_cache->u32_page_num))
+        pst_cache->u8_read_ahead = (pst_cache->u32_page_num > 1)?(pst_cache->u32_page_num-1):(0);
+
+    pst_cache->u32_last_blk = DB_PAGE_NONE;
+
+    /* an empty table has no block yet, pages are added as it grows */
+    if(pst_cache->u32_blk_num > 0)
+    {
+        pst_cache->ast_page = (struct db_page *)calloc(pst_cache->u32_page_num, sizeof(struct db_page));
+        pst_cache->pu32_blk_map = (uint32_t *)malloc(pst_cache->u32_blk_num*sizeof(uint32_t));
+
+        /* lazy access only pays for the blocks which are read */
+        if(DB_ACCESS_LAZY != pst_db->u8_access)
+            pst_cache->pu8_data = (uint8_t *)malloc((size_t)pst_cache->u32_page_num*u32_blk_len);
+    }
+
+    if((pst_cache->u32_blk_num > 0) &&
+       (!pst_cache->ast_page || !pst_cache->pu32_blk_map ||
+        (!pst_cache->pu8_data && (DB_ACCESS_LAZY != pst_db->u8_access))))
+    {
+        free(pst_cache->ast_page);
+        free(pst_cache->pu8_data);
+        free(pst_cache->pu32_blk_map);
+        free(pst_cache);
+        return false;
+    }
+
+    if(pst_cache->u32_blk_num > 0)
+        memset((void *)pst_cache->pu32_blk_map, 0xff, pst_cache->u32_blk_num*sizeof(uint32_t));
+
+    for(uint32_t idx=0; idx<pst_cache->u32_page_num; idx++)
+    {
+        pst_cache->ast_page[idx].u32_blk_idx = DB_PAGE_NONE;
+        pst_cache->ast_page[idx].i8_aio_slot = -1;
+
+        if(NULL != pst_cache->pu8_data)
+            pst_cache->ast_page[idx].pu8_data = &pst_cache->pu8_data[(size_t)idx*u32_blk_len];
+    }
+
+    pthread_mutex_init(&pst_cache->st_lock, NULL);
+
+    /* without it read ahead falls back to wider synchronous reads */
+    if(pst_cache->u8_read_ahead)
+        pst_cache->pst_aio = _db_aio_create(fileno(pst_db->pf_db));
+
+    pst_db->pst_page_cache = pst_cache;
 
     return true;
 }
 
-uint8_t db_field_get_num(hdb h_db)
+static void _db_page_drain(struct db *pst_db);
+
+static void _db_page_cache_deinit(struct db *pst_db)
 {
-    return ((struct db *)h_db)->st_field_info.u8_field_num;
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+
+    if(!pst_cache)
+        return;
+
+    _db_page_drain(pst_db);
+    _db_aio_destroy(pst_cache->pst_aio);
+
+    pthread_mutex_destroy(&pst_cache->st_lock);
+
+    if(NULL == pst_cache->pu8_data)
+    {
+        for(uint32_t idx=0; idx<pst_cache->u32_page_num; idx++)
+            free(pst_cache->ast_page[idx].pu8_data);
+    }
+
+    free(pst_cache->ast_page);
+    free(pst_cache->pu8_data);
+    free(pst_cache->pu32_blk_map);
+    free(pst_cache);
+
+    pst_db->pst_page_cache = NULL;
 }
 
-int16_t db_field_get_idx(hdb h_db, char *s_name)
+/* pick an unpinned page by CLOCK and detach it from its block */
+static struct db_page *_db_page_evict(struct db_page_cache *pst_cache)
 {
-    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
-    struct db_field *pst_field;
-    uint8_t u8_idx = 0;
+    struct db_page *pst_page;
 
-    pst_field = pst_info->pst_field;
-    while(pst_field)
+    for(uint32_t u32_scan=0; u32_scan<2*pst_cache->u32_page_num; u32_scan++)
     {
-        if(0 == strcmp(s_name, pst_field->s_name))
+        pst_page = &pst_cache->ast_page[pst_cache->u32_hand];
+        pst_cache->u32_hand = (pst_cache->u32_hand+1)%pst_cache->u32_page_num;
+
+        if(pst_page->u16_pin)
+            continue;
+
+        if(pst_page->b_ref)
         {
-            return u8_idx;
+            pst_page->b_ref = false;
+            continue;
         }
 
-        u8_idx++;
-        pst_field = pst_field->pst_next;
+        if(DB_PAGE_NONE != pst_page->u32_blk_idx)
+            pst_cache->pu32_blk_map[pst_page->u32_blk_idx] = DB_PAGE_NONE;
+
+        pst_page->u32_blk_idx = DB_PAGE_NONE;
+        pst_page->u32_rec_num = 0;
+
+        return pst_page;
+    }
+
+    return NULL;
+}
+
+/* give a page of lazy access its buffer on the first load */
+static bool _db_page_alloc(struct db_page *pst_page, uint32_t u32_blk_len)
+{
+    if(NULL == pst_page->pu8_data)
+        pst_page->pu8_data = (uint8_t *)malloc(u32_blk_len);
+
+    return (NULL != pst_page->pu8_data);
+}
+
+/* load u32_blk_idx and up to u32_max-1 blocks following it which are
+ * not resident yet with a single vectored read */
+static bool _db_page_load(struct db *pst_db, uint32_t u32_blk_idx, uint32_t u32_max)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    struct db_page *apst_page[DB_PAGE_MAX_LOAD];
+    struct iovec ast_iov[DB_PAGE_MAX_LOAD];
+    uint32_t u32_blk_len = pst_cache->u32_blk_rec_num*pst_hdr->u16_rec_len;
+    uint32_t u32_num = 0;
+    ssize_t t_read;
+
+    if(u32_max > DB_PAGE_MAX_LOAD)
+        u32_max = DB_PAGE_MAX_LOAD;
+
+    while((u32_num < u32_max) && (u32_blk_idx+u32_num < pst_cache->u32_blk_num))
+    {
+        if(DB_PAGE_NONE != pst_cache->pu32_blk_map[u32_blk_idx+u32_num])
+            break;
+
+        /* lazy access has a page for each block, nothing is evicted */
+        if(DB_ACCESS_LAZY == pst_db->u8_access)
+            apst_page[u32_num] = &pst_cache->ast_page[u32_blk_idx+u32_num];
+        else
+            apst_page[u32_num] = _db_page_evict(pst_cache);
+
+        if((NULL == apst_page[u32_num]) || (false == _db_page_alloc(apst_page[u32_num], u32_blk_len)))
+            break;
+
+        /* keep the page out of the CLOCK until it is filled */
+        apst_page[u32_num]->u16_pin++;
+
+        ast_iov[u32_num].iov_base = (void *)apst_page[u32_num]->pu8_data;
+        ast_iov[u32_num].iov_len = u32_blk_len;
+        u32_num++;
+    }
+
+    if(0 == u32_num)
+        return false;
+
+    t_read = preadv(
+            fileno(pst_db->pf_db),
+            ast_iov,
+            u32_num,
+            pst_hdr->u16_hdr_len+(off_t)u32_blk_idx*u32_blk_len);
+
+    if(t_read < 0)
+        t_read = 0;
+
+    for(uint32_t idx=0; idx<u32_num; idx++)
+    {
+        struct db_page *pst_page = apst_page[idx];
+        uint32_t u32_rec_num = pst_hdr->u32_rec_num-(u32_blk_idx+idx)*pst_cache->u32_blk_rec_num;
+
+        pst_page->u16_pin--;
+
+        if(u32_rec_num > pst_cache->u32_blk_rec_num)
+            u32_rec_num = pst_cache->u32_blk_rec_num;
+
+        /* drop records cut off by a truncated file */
+        if((size_t)t_read < (size_t)u32_rec_num*pst_hdr->u16_rec_len)
+            u32_rec_num = t_read/pst_hdr->u16_rec_len;
+
+        t_read = ((size_t)t_read > u32_blk_len)?(t_read-u32_blk_len):(0);
+
+        if(0 == u32_rec_num)
+            continue;
+
+        pst_page->u32_blk_idx = u32_blk_idx+idx;
+        pst_page->u32_rec_num = u32_rec_num;
+        pst_page->b_ref = (0 == idx);
+        pst_cache->pu32_blk_map[u32_blk_idx+idx] = pst_page-pst_cache->ast_page;
+    }
+
+    return (DB_PAGE_NONE != pst_cache->pu32_blk_map[u32_blk_idx]);
+}
+
+/* complete the read ahead of a page, the block is dropped again when
+ * it lies beyond the end of a truncated file */
+static void _db_page_finish(struct db *pst_db, struct db_page *pst_page)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    uint32_t u32_blk_idx = pst_page->u32_blk_idx;
+    uint32_t u32_rec_num = pst_hdr->u32_rec_num-u32_blk_idx*pst_cache->u32_blk_rec_num;
+    ssize_t t_read = _db_aio_wait(pst_cache->pst_aio, pst_page->i8_aio_slot);
+
+    pst_page->i8_aio_slot = -1;
+    pst_page->u16_pin--;
+
+    if(u32_rec_num > pst_cache->u32_blk_rec_num)
+        u32_rec_num = pst_cache->u32_blk_rec_num;
+
+    if(t_read < 0)
+        t_read = 0;
+
+    if((size_t)t_read < (size_t)u32_rec_num*pst_hdr->u16_rec_len)
+        u32_rec_num = t_read/pst_hdr->u16_rec_len;
+
+    pst_page->u32_rec_num = u32_rec_num;
+
+    if(0 == u32_rec_num)
+    {
+        pst_cache->pu32_blk_map[u32_blk_idx] = DB_PAGE_NONE;
+        pst_page->u32_blk_idx = DB_PAGE_NONE;
+    }
+}
+
+/* complete every read ahead still in flight */
+static void _db_page_drain(struct db *pst_db)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+
+    for(uint32_t idx=0; idx<pst_cache->u32_page_num; idx++)
+    {
+        if(pst_cache->ast_page[idx].i8_aio_slot >= 0)
+            _db_page_finish(pst_db, &pst_cache->ast_page[idx]);
+    }
+}
+
+/* keep the blocks after u32_blk_idx in flight while it is consumed */
+static void _db_page_read_ahead(struct db *pst_db, uint32_t u32_blk_idx)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    uint32_t u32_blk_len = pst_cache->u32_blk_rec_num*pst_hdr->u16_rec_len;
+
+    for(uint32_t u32_blk=u32_blk_idx+1;
+        (u32_blk <= u32_blk_idx+pst_cache->u8_read_ahead) && (u32_blk < pst_cache->u32_blk_num);
+        u32_blk++)
+    {
+        struct db_page *pst_page;
+        int32_t i32_slot;
+
+        if(DB_PAGE_NONE != pst_cache->pu32_blk_map[u32_blk])
+            continue;
+
+        if(DB_ACCESS_LAZY == pst_db->u8_access)
+            pst_page = &pst_cache->ast_page[u32_blk];
+        else
+            pst_page = _db_page_evict(pst_cache);
+
+        if((NULL == pst_page) || (false == _db_page_alloc(pst_page, u32_blk_len)))
+            break;
+
+        i32_slot = _db_aio_submit(
+                pst_cache->pst_aio,
+                pst_page->pu8_data,
+                u32_blk_len,
+                pst_hdr->u16_hdr_len+(off_t)u32_blk*u32_blk_len);
+
+        if(i32_slot < 0)
+            break;
+
+        /* pinned until _db_page_finish so the CLOCK leaves it alone */
+        pst_page->u32_blk_idx = u32_blk;
+        pst_page->u32_rec_num = 0;
+        pst_page->i8_aio_slot = i32_slot;
+        pst_page->u16_pin++;
+        pst_page->b_ref = false;
+        pst_cache->pu32_blk_map[u32_blk] = pst_page-pst_cache->ast_page;
+    }
+}
+
+static struct db_page *_db_page_get(struct db *pst_db, uint32_t u32_blk_idx)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    struct db_page *pst_page;
+    bool b_seq;
+
+    if(u32_blk_idx >= pst_cache->u32_blk_num)
+        return NULL;
+
+    b_seq = (u32_blk_idx == pst_cache->u32_last_blk+1);
+    pst_cache->u32_last_blk = u32_blk_idx;
+
+    if(DB_PAGE_NONE == pst_cache->pu32_blk_map[u32_blk_idx])
+    {
+        /* without asynchronous reads, read ahead in the same call */
+        uint32_t u32_max = ((true == b_seq) && (NULL == pst_cache->pst_aio))?(1+pst_cache->u8_read_ahead):(1);
+
+        if(false == _db_page_load(pst_db, u32_blk_idx, u32_max))
+            return NULL;
+    }
+
+    pst_page = &pst_cache->ast_page[pst_cache->pu32_blk_map[u32_blk_idx]];
+
+    if(pst_page->i8_aio_slot >= 0)
+    {
+        _db_page_finish(pst_db, pst_page);
+
+        if(DB_PAGE_NONE == pst_cache->pu32_blk_map[u32_blk_idx])
+            return NULL;
+    }
+
+    pst_page->u16_pin++;
+    pst_page->b_ref = true;
+
+    /* the page is pinned first so the read ahead cannot evict it */
+    if((true == b_seq) && (NULL != pst_cache->pst_aio))
+        _db_page_read_ahead(pst_db, u32_blk_idx);
+
+    return pst_page;
+}
+
+static void _db_page_put(struct db *pst_db, uint32_t u32_blk_idx)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    uint32_t u32_page_idx = pst_cache->pu32_blk_map[u32_blk_idx];
+
+    if((DB_PAGE_NONE != u32_page_idx) && (pst_cache->ast_page[u32_page_idx].u16_pin))
+        pst_cache->ast_page[u32_page_idx].u16_pin--;
+}
+
+static bool _db_rec_cache_init(struct db *pst_db, const struct db_config *pst_config)
+{
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+
+    if((DB_ACCESS_MMAP == pst_db->u8_access) && (true == _db_rec_map_init(pst_db)))
+        return true;
+
+    if((DB_ACCESS_PAGED != pst_db->u8_access) && (DB_ACCESS_LAZY != pst_db->u8_access))
+    {
+        /* fall back to an in-memory copy if the file can not be mapped */
+        pst_db->u8_access = DB_ACCESS_CACHE;
+
+        pst_db->pu8_rec_cache = (uint8_t *)malloc((size_t)pst_hdr->u32_rec_num*pst_hdr->u16_rec_len);
+        if(NULL != pst_db->pu8_rec_cache)
+        {
+            size_t t_read = _db_aio_read_all(
+                    fileno(pst_db->pf_db),
+                    pst_db->pu8_rec_cache,
+                    (size_t)pst_hdr->u32_rec_num*pst_hdr->u16_rec_len,
+                    pst_hdr->u16_hdr_len);
+
+            /* never hand out records beyond the end of a truncated file */
+            if(t_read < (size_t)pst_hdr->u32_rec_num*pst_hdr->u16_rec_len)
+                pst_hdr->u32_rec_num = t_read/pst_hdr->u16_rec_len;
+
+            return true;
+        }
+    }
+
+    /* table does not fit in memory, serve it from a bounded block cache */
+    if(DB_ACCESS_LAZY != pst_db->u8_access)
+        pst_db->u8_access = DB_ACCESS_PAGED;
+
+    return _db_page_cache_init(pst_db, pst_config);
+}
+
+static bool _db_rec_cache_deinit(struct db *pst_db)
+{
+    _db_page_cache_deinit(pst_db);
+
+    if(pst_db->pu8_map)
+    {
+        munmap((void *)pst_db->pu8_map, pst_db->t_map_len);
+        pst_db->pu8_map = NULL;
+        pst_db->pu8_rec_cache = NULL;
+        return true;
+    }
+
+    free(pst_db->pu8_rec_cache);
+    return true;
+}
+
+static bool _db_rec_cache_read(
+        struct db *pst_db,
+        uint32_t u32_rec_index,
+        uint8_t *pu8_data)
+{
+    uint32_t u32_size = pst_db->st_file_hdr.u16_rec_len;
+    size_t t_offset = (size_t)u32_rec_index*u32_size;
+
+    if(NULL == pst_db->pu8_rec_cache)
+        return false;
+
+    memcpy((void *)pu8_data, (void *)&pst_db->pu8_rec_cache[t_offset], u32_size);
+    return true;
+}
+
+#if 0
+static bool _db_rec_cache_write(
+        struct db *pst_db,
+        uint32_t u32_rec_index,
+        uint8_t *pu8_data)
+{
+    uint32_t u32_size = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_offset = u32_rec_index*u32_size;
+
+    memcpy((void *)&pst_db->pu8_rec_cache[u32_offset], (void *)pu8_data, u32_size);
+    return true;
+}
+
+static bool _db_rec_cache_flush(struct db *pst_db)
+{
+    return true;
+}
+#endif
+
+/* pin the records from u32_rec_idx up to the end of its cache block
+ * and return them in place, _db_rec_release must follow */
+static uint8_t *_db_rec_acquire(struct db *pst_db, uint32_t u32_rec_idx, uint32_t *pu32_num)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    struct db_page *pst_page;
+    uint32_t u32_blk_off;
+
+    if(u32_rec_idx >= pst_db->st_file_hdr.u32_rec_num)
+        return NULL;
+
+    if(NULL != pst_db->pu8_rec_cache)
+    {
+        *pu32_num = pst_db->st_file_hdr.u32_rec_num-u32_rec_idx;
+        return &pst_db->pu8_rec_cache[(size_t)u32_rec_idx*pst_db->st_file_hdr.u16_rec_len];
+    }
+
+    if(NULL == pst_cache)
+        return NULL;
+
+    /* a pinned page is never reloaded, so only pinning needs the lock */
+    pthread_mutex_lock(&pst_cache->st_lock);
+
+    pst_page = _db_page_get(pst_db, u32_rec_idx/pst_cache->u32_blk_rec_num);
+    if(NULL == pst_page)
+    {
+        pthread_mutex_unlock(&pst_cache->st_lock);
+        return NULL;
+    }
+
+    u32_blk_off = u32_rec_idx%pst_cache->u32_blk_rec_num;
+    if(u32_blk_off >= pst_page->u32_rec_num)
+    {
+        pst_page->u16_pin--;
+        pthread_mutex_unlock(&pst_cache->st_lock);
+        return NULL;
+    }
+
+    pthread_mutex_unlock(&pst_cache->st_lock);
+
+    *pu32_num = pst_page->u32_rec_num-u32_blk_off;
+    return &pst_page->pu8_data[u32_blk_off*pst_db->st_file_hdr.u16_rec_len];
+}
+
+static void _db_rec_release(struct db *pst_db, uint32_t u32_rec_idx)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+
+    if((NULL == pst_db->pu8_rec_cache) && (NULL != pst_cache))
+    {
+        pthread_mutex_lock(&pst_cache->st_lock);
+        _db_page_put(pst_db, u32_rec_idx/pst_cache->u32_blk_rec_num);
+        pthread_mutex_unlock(&pst_cache->st_lock);
+    }
+}
+
+static bool _db_rec_read(struct db *pst_db, uint32_t u32_rec_idx, uint8_t *pu8_data)
+{
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    uint8_t *pu8_rec;
+    uint32_t u32_num;
+
+    if(u32_rec_idx >= pst_db->st_file_hdr.u32_rec_num)
+        return false;
+
+    if(false == _db_rec_cache_read(pst_db, u32_rec_idx, pu8_data))
+    {
+        /* cache miss, go through the block cache or read the file */
+        pu8_rec = _db_rec_acquire(pst_db, u32_rec_idx, &u32_num);
+        if(NULL != pu8_rec)
+        {
+            memcpy((void *)pu8_data, (void *)pu8_rec, pst_hdr->u16_rec_len);
+            _db_rec_release(pst_db, u32_rec_idx);
+        }
+        else if(pst_hdr->u16_rec_len != pread(
+                    fileno(pst_db->pf_db),
+                    (void *)pu8_data,
+                    pst_hdr->u16_rec_len,
+                    pst_hdr->u16_hdr_len+(off_t)u32_rec_idx*pst_hdr->u16_rec_len))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* return record data in place when it is resident in the cache or
+ * the mapping, otherwise read it into pu8_buf */
+static uint8_t *_db_rec_fetch(struct db *pst_db, uint32_t u32_rec_idx, uint8_t *pu8_buf)
+{
+    if(u32_rec_idx >= pst_db->st_file_hdr.u32_rec_num)
+        return NULL;
+
+    if(NULL != pst_db->pu8_rec_cache)
+        return &pst_db->pu8_rec_cache[(size_t)u32_rec_idx*pst_db->st_file_hdr.u16_rec_len];
+
+    if(false == _db_rec_read(pst_db, u32_rec_idx, pu8_buf))
+        return NULL;
+
+    return pu8_buf;
+}
+
+/* pin records as _db_rec_acquire does, or read the single record into
+ * pu8_buf when every cache page is pinned by other cursors;
+ * _db_rec_release must follow only if *pb_pinned is set */
+static uint8_t *_db_rec_acquire_any(
+        struct db *pst_db,
+        uint32_t u32_rec_idx,
+        uint32_t *pu32_num,
+        uint8_t *pu8_buf,
+        bool *pb_pinned)
+{
+    uint8_t *pu8_data = _db_rec_acquire(pst_db, u32_rec_idx, pu32_num);
+
+    *pb_pinned = (NULL != pu8_data);
+    if(true == *pb_pinned)
+        return pu8_data;
+
+    if(false == _db_rec_read(pst_db, u32_rec_idx, pu8_buf))
+        return NULL;
+
+    *pu32_num = 1;
+    return pu8_buf;
+}
+
+#if 0
+static bool _db_rec_write(
+        struct db *pst_db,
+        uint32_t u32_rec_index,
+        uint8_t *pu8_data)
+{
+    return true;
+}
+#endif
+
+static uint32_t _db_hash(const uint8_t *pu8_data, uint32_t u32_len)
+{
+    uint32_t u32_hash = 2166136261u;
+
+    while(u32_len--)
+    {
+        u32_hash ^= *pu8_data++;
+        u32_hash *= 16777619u;
+    }
+
+    return u32_hash;
+}
+
+static void _db_index_free(struct db_index *pst_index)
+{
+    if(!pst_index)
+        return;
+
+    if(pst_index->b_mapped)
+    {
+        free(pst_index);
+        return;
+    }
+
+    free(pst_index->pu32_bucket);
+    free(pst_index->pu32_next);
+    free(pst_index->pu32_hash);
+    free(pst_index->pu32_tail);
+    free(pst_index);
+}
+
+/* visit the records whose key hashes like the given key, record ids
+ * come in ascending order and u32_rec_id is the previous hit or
+ * DB_PAGE_NONE to start from the bucket head */
+static uint32_t _db_index_next(
+        const struct db_index *pst_index,
+        uint32_t u32_hash,
+        uint32_t u32_rec_id)
+{
+    uint32_t u32_prev = 0;
+    uint32_t u32_next;
+
+    if(DB_PAGE_NONE == u32_rec_id)
+        u32_next = pst_index->pu32_bucket[u32_hash&pst_index->u32_bucket_mask];
+    else
+    {
+        u32_prev = u32_rec_id+1;
+        u32_next = pst_index->pu32_next[u32_rec_id];
+    }
+
+    /* a link which does not ascend within the table ends the chain,
+     * so a corrupt sidecar can neither read out of bounds nor loop */
+    while((u32_next > u32_prev) && (u32_next <= pst_index->u32_rec_num))
+    {
+        if(u32_hash == pst_index->pu32_hash[u32_next-1])
+            return u32_next-1;
+
+        u32_prev = u32_next;
+        u32_next = pst_index->pu32_next[u32_next-1];
+    }
+
+    return DB_PAGE_NONE;
+}
+
+static bool _db_key_match(
+        const struct db_field *pst_field,
+        const uint8_t *pu8_rec_data,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len)
+{
+    const uint8_t *pu8_data;
+    uint32_t u32_len;
+
+    pu8_data = _db_field_trim(pst_field, pu8_rec_data+pst_field->u32_acc_len, &u32_len);
+
+    return (u32_len == u32_key_len) && (0 == memcmp((void *)pu8_data, (void *)pu8_key, u32_len));
+}
+
+static uint64_t _db_file_size(struct db *pst_db)
+{
+    struct stat st_stat;
+
+    if(0 != fstat(fileno(pst_db->pf_db), &st_stat))
+        return 0;
+
+    return st_stat.st_size;
+}
+
+static void _db_order_free(struct db_order *pst_order);
+
+/* map the sidecar index file and attach the indexes it holds when it
+ * was written for the current state of the table */
+static bool _db_index_attach(struct db *pst_db)
+{
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    struct db_hix_hdr *pst_hix;
+    struct db_hix_entry *pst_entry;
+    struct db_hix_order *pst_order_entry;
+    struct stat st_stat;
+    void *pv_map;
+    int fd;
+
+    fd = open(pst_db->s_hix_name, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    if((0 != fstat(fd, &st_stat)) || (st_stat.st_size < sizeof(struct db_hix_hdr)))
+    {
+        close(fd);
+        return false;
+    }
+
+    pv_map = mmap(NULL, st_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(MAP_FAILED == pv_map)
+        return false;
+
+    pst_hix = (struct db_hix_hdr *)pv_map;
+
+    do
+    {
+        if((DB_HIX_MAGIC != pst_hix->u32_magic) || (DB_HIX_VERSION != pst_hix->u32_version))
+            break;
+
+        if((0 != memcmp((void *)pst_hix->au8_last_update, (void *)pst_hdr->au8_last_update, 3)) ||
+           (pst_hix->u32_rec_num != pst_hdr->u32_rec_num) ||
+           (pst_hix->u64_file_size != _db_file_size(pst_db)))
+            break;
+
+        if(st_stat.st_size < sizeof(struct db_hix_hdr)+
+                             (uint64_t)pst_hix->u32_index_num*sizeof(struct db_hix_entry)+
+                             (uint64_t)pst_hix->u32_order_num*sizeof(struct db_hix_order))
+            break;
+
+        pst_db->apst_index = (struct db_index **)calloc(pst_info->u8_field_num, sizeof(struct db_index *));
+        if(!pst_db->apst_index)
+            break;
+
+        if((pst_hix->u32_order_num) && (NULL == pst_db->apst_order))
+        {
+            pst_db->apst_order = (struct db_order **)calloc(pst_info->u8_field_num, sizeof(struct db_order *));
+            if(!pst_db->apst_order)
+                break;
+        }
+
+        pst_entry = (struct db_hix_entry *)(pst_hix+1);
+
+        for(uint32_t idx=0; idx<pst_hix->u32_index_num; idx++, pst_entry++)
+        {
+            struct db_field *pst_field;
+            struct db_index *pst_index;
+            uint64_t u64_len;
+
+            if(pst_entry->u32_field_idx >= pst_info->u8_field_num)
+                continue;
+
+            pst_field = pst_info->a_field[pst_entry->u32_field_idx];
+            if((pst_field->u32_acc_len != pst_entry->u32_acc_len) || (pst_field->u8_len != pst_entry->u32_field_len))
+                continue;
+
+            u64_len = ((uint64_t)pst_entry->u32_bucket_mask+1+2*(uint64_t)pst_hix->u32_rec_num)*sizeof(uint32_t);
+            if((pst_entry->u64_offset%sizeof(uint32_t)) || (pst_entry->u64_offset+u64_len > st_stat.st_size))
+                continue;
+
+            pst_index = (struct db_index *)calloc(1, sizeof(struct db_index));
+            if(!pst_index)
+                continue;
+
+            pst_index->u32_field_idx = pst_entry->u32_field_idx;
+            pst_index->u32_rec_num = pst_hix->u32_rec_num;
+            pst_index->u32_bucket_mask = pst_entry->u32_bucket_mask;
+            pst_index->b_mapped = true;
+            pst_index->pu32_bucket = (uint32_t *)((uint8_t *)pv_map+pst_entry->u64_offset);
+            pst_index->pu32_next = pst_index->pu32_bucket+pst_entry->u32_bucket_mask+1;
+            pst_index->pu32_hash = pst_index->pu32_next+pst_hix->u32_rec_num;
+
+            _db_index_free(pst_db->apst_index[pst_index->u32_field_idx]);
+            pst_db->apst_index[pst_index->u32_field_idx] = pst_index;
+        }
+
+        pst_order_entry = (struct db_hix_order *)pst_entry;
+
+        for(uint32_t idx=0; idx<pst_hix->u32_order_num; idx++, pst_order_entry++)
+        {
+            struct db_field *pst_field;
+            struct db_order *pst_order;
+            uint64_t u64_len;
+
+            if(pst_order_entry->u32_field_idx >= pst_info->u8_field_num)
+                continue;
+
+            pst_field = pst_info->a_field[pst_order_entry->u32_field_idx];
+            if((pst_field->u32_acc_len != pst_order_entry->u32_acc_len) ||
+               (pst_field->u8_len != pst_order_entry->u32_field_len) ||
+               (pst_order_entry->u32_num > pst_hix->u32_rec_num))
+                continue;
+
+            u64_len = (uint64_t)pst_order_entry->u32_num*(sizeof(int64_t)+sizeof(uint32_t));
+            if((pst_order_entry->u64_offset%sizeof(int64_t)) || (pst_order_entry->u64_offset+u64_len > st_stat.st_size))
+                continue;
+
+            pst_order = (struct db_order *)calloc(1, sizeof(struct db_order));
+            if(!pst_order)
+                continue;
+
+            pst_order->u32_field_idx = pst_order_entry->u32_field_idx;
+            pst_order->u32_num = pst_order_entry->u32_num;
+            pst_order->b_mapped = true;
+            pst_order->pi64_key = (int64_t *)((uint8_t *)pv_map+pst_order_entry->u64_offset);
+            pst_order->pu32_rec_id = (uint32_t *)(pst_order->pi64_key+pst_order->u32_num);
+
+            _db_order_free(pst_db->apst_order[pst_order->u32_field_idx]);
+            pst_db->apst_order[pst_order->u32_field_idx] = pst_order;
+        }
+
+        pst_db->pu8_hix_map = (uint8_t *)pv_map;
+        pst_db->t_hix_len = st_stat.st_size;
+
+        return true;
+    }while(0);
+
+    munmap(pv_map, st_stat.st_size);
+
+    return false;
+}
+
+static uint32_t _db_date_to_JD(uint16_t u16_year, uint8_t u8_month, uint8_t u8_day)
+{
+    uint32_t u32_a = (14-u8_month)/12;
+    uint32_t u32_y = u16_year+4800-u32_a;
+    uint32_t u32_m = u8_month+12*u32_a-3;
+
+    return u8_day+(153*u32_m+2)/5+365*u32_y+u32_y/4-u32_y/100+u32_y/400-32045;
+}
+
+/* a calendar date, months of 1 to 12 with their number of days */
+static bool _db_date_valid(uint16_t u16_year, uint8_t u8_month, uint8_t u8_day)
+{
+    static const uint8_t au8_day_num[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    if((u8_month < 1) || (u8_month > 12) || (u8_day < 1) || (u8_day > au8_day_num[u8_month-1]))
+        return false;
+
+    return (2 != u8_month) || (u8_day < 29) ||
+           ((0 == u16_year%4) && ((0 != u16_year%100) || (0 == u16_year%400)));
+}
+
+static uint64_t _db_get_le64(const uint8_t *pu8_data)
+{
+    return (uint64_t)_db_get_le32(&pu8_data[4])<<32 | _db_get_le32(pu8_data);
+}
+
+/* T field as milliseconds since 1970-01-01, false when blank */
+static bool _db_time_to_epoch_ms(const uint8_t *pu8_data, int64_t *pi64_ms)
+{
+    uint32_t u32_day = _db_get_le32(pu8_data);
+    uint32_t u32_ms = _db_get_le32(&pu8_data[4]);
+
+    if(true == _db_time_is_blank(pu8_data))
+        return false;
+
+    *pi64_ms = ((int64_t)u32_day-DB_JD_EPOCH)*86400000+u32_ms;
+    return true;
+}
+
+static const uint8_t *_db_ixf_node(const struct db_ixf *pst_ixf, uint32_t u32_offset)
+{
+    if((DB_IXF_NONE == u32_offset) || ((size_t)u32_offset+DB_IXF_NODE_SIZE > pst_ixf->t_map_len))
+        return NULL;
+
+    return &pst_ixf->pu8_map[u32_offset];
+}
+
+/* callback of the tag walk, return false to stop */
+typedef bool (*_db_pf_tag_visit)(const uint8_t *pu8_key, uint32_t u32_rec_id, void *pv_usr_data);
+
+/* visit the keys of a tag in ascending order from the first key that
+ * is not less than pu8_lo (NULL for the first key of the tag) */
+static bool _db_tag_walk(
+        const struct db_tag *pst_tag,
+        const uint8_t *pu8_lo,
+        _db_pf_tag_visit pf_visit,
+        void *pv_usr_data)
+{
+    const struct db_ixf *pst_ixf = pst_tag->pst_ixf;
+    uint16_t u16_key_len = pst_tag->u16_key_len;
+    uint8_t u8_fill = (DB_TAG_KEY_NUM == pst_tag->e_key || DB_TAG_KEY_DATE == pst_tag->e_key || DB_TAG_KEY_INT == pst_tag->e_key)?(0x00):(' ');
+    uint32_t u32_entry_len = pst_tag->b_compact?(u16_key_len+8):(u16_key_len+4);
+    const uint8_t *pu8_node;
+    uint8_t au8_key[256];
+    uint32_t u32_depth = 0;
+    size_t t_leaf_num = 0;
+
+    if(u16_key_len > sizeof(au8_key))
+        return false;
+
+    /* descend to the leaf which holds the lower bound */
+    pu8_node = _db_ixf_node(pst_ixf, pst_tag->u32_root);
+
+    while((NULL != pu8_node) && !(pu8_node[0] & DB_IXF_ATTR_LEAF))
+    {
+        uint16_t u16_key_num = pu8_node[2] | pu8_node[3]<<8;
+        const uint8_t *pu8_entry = pu8_node+12;
+        uint16_t u16_idx = 0;
+
+        if((0 == u16_key_num) || (12+u16_key_num*u32_entry_len > DB_IXF_NODE_SIZE) || (++u32_depth > 64))
+            return false;
+
+        /* every entry holds the highest key of its child */
+        if(NULL != pu8_lo)
+        {
+            while((u16_idx+1 < u16_key_num) && (memcmp((void *)&pu8_entry[u16_idx*u32_entry_len], (void *)pu8_lo, u16_key_len) < 0))
+                u16_idx++;
+        }
+
+        pu8_node = _db_ixf_node(pst_ixf, _db_get_be32(&pu8_entry[(u16_idx+1)*u32_entry_len-4]));
+    }
+
+    /* walk the leaves left to right, a file has no more leaves than
+     * nodes so a longer walk follows a corrupt sibling link */
+    while(NULL != pu8_node)
+    {
+        uint16_t u16_key_num = pu8_node[2] | pu8_node[3]<<8;
+
+        if(++t_leaf_num > pst_ixf->t_map_len/DB_IXF_NODE_SIZE)
+            return false;
+
+        if(true == pst_tag->b_compact)
+        {
+            uint32_t u32_rec_mask = _db_get_le32(&pu8_node[14]);
+            uint8_t u8_dup_mask = pu8_node[18];
+            uint8_t u8_trail_mask = pu8_node[19];
+            uint8_t u8_rec_bits = pu8_node[20];
+            uint8_t u8_dup_bits = pu8_node[21];
+            uint8_t u8_info_len = pu8_node[23];
+            const uint8_t *pu8_key_end = pu8_node+DB_IXF_NODE_SIZE;
+
+            if((0 == u8_info_len) || (u8_info_len > 8) || (24+u16_key_num*u8_info_len > DB_IXF_NODE_SIZE))
+                return false;
+
+            for(uint16_t u16_idx=0; u16_idx<u16_key_num; u16_idx++)
+            {
+                const uint8_t *pu8_info = &pu8_node[24+u16_idx*u8_info_len];
+                uint64_t u64_info = 0;
+                uint32_t u32_dup, u32_trail, u32_len;
+
+                for(int idx=u8_info_len-1; idx>=0; idx--)
+                    u64_info = u64_info<<8 | pu8_info[idx];
+
+                u32_dup = (u64_info>>u8_rec_bits)&u8_dup_mask;
+                u32_trail = (u64_info>>(u8_rec_bits+u8_dup_bits))&u8_trail_mask;
+
+                if(u32_dup+u32_trail > u16_key_len)
+                    return false;
+
+                /* key bytes are packed from the end of the node backwards */
+                u32_len = u16_key_len-u32_dup-u32_trail;
+                pu8_key_end -= u32_len;
+                if(pu8_key_end < pu8_info+u8_info_len)
+                    return false;
+
+                memcpy((void *)&au8_key[u32_dup], (void *)pu8_key_end, u32_len);
+                memset((void *)&au8_key[u16_key_len-u32_trail], u8_fill, u32_trail);
+
+                if((NULL != pu8_lo) && (memcmp((void *)au8_key, (void *)pu8_lo, u16_key_len) < 0))
+                    continue;
+
+                if(false == pf_visit(au8_key, (uint32_t)(u64_info&u32_rec_mask)-1, pv_usr_data))
+                    return true;
+            }
+        }
+        else
+        {
+            const uint8_t *pu8_entry = pu8_node+12;
+
+            if(12+u16_key_num*u32_entry_len > DB_IXF_NODE_SIZE)
+                return false;
+
+            for(uint16_t u16_idx=0; u16_idx<u16_key_num; u16_idx++, pu8_entry+=u32_entry_len)
+            {
+                if((NULL != pu8_lo) && (memcmp((void *)pu8_entry, (void *)pu8_lo, u16_key_len) < 0))
+                    continue;
+
+                if(false == pf_visit(pu8_entry, _db_get_be32(&pu8_entry[u16_key_len])-1, pv_usr_data))
+                    return true;
+            }
+        }
+
+        pu8_node = _db_ixf_node(pst_ixf, _db_get_le32(&pu8_node[8]));
+    }
+
+    return true;
+}
+
+/* bind the key expression of a tag to the field it covers */
+static void _db_tag_bind(struct db *pst_db, struct db_tag *pst_tag)
+{
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    char s_expr[64];
+    char *s_name = s_expr;
+    size_t t_len = 0;
+    bool b_upper = false;
+
+    pst_tag->i16_field_idx = -1;
+    pst_tag->e_key = DB_TAG_KEY_NONE;
+
+    /* keys of a descending tag or another collation are not in the
+     * order the walk and the key encoding expect */
+    if((true == pst_tag->b_desc) || (false == pst_tag->b_machine))
+        return;
+
+    for(char *s_src=pst_tag->s_expr; *s_src && (t_len < sizeof(s_expr)-1); s_src++)
+    {
+        if(!isspace((unsigned char)*s_src))
+            s_expr[t_len++] = toupper((unsigned char)*s_src);
+    }
+
+    s_expr[t_len] = '\0';
+
+    if((0 == strncmp(s_expr, "UPPER(", 6)) && (')' == s_expr[t_len-1]))
+    {
+        b_upper = true;
+        s_name = s_expr+6;
+        s_expr[t_len-1] = '\0';
+    }
+
+    for(int idx=0; idx<pst_info->u8_field_num; idx++)
+    {
+        struct db_field *pst_field = pst_info->a_field[idx];
+        char s_field[12];
+        int i_len;
+
+        for(i_len=0; (i_len < 11) && pst_field->s_name[i_len]; i_len++)
+            s_field[i_len] = toupper((unsigned char)pst_field->s_name[i_len]);
+
+        s_field[i_len] = '\0';
+
+        if(0 != strcmp(s_name, s_field))
+            continue;
+
+        switch(toupper(pst_field->u8_type))
+        {
+            case 'C':
+                if(pst_tag->u16_key_len == pst_field->u8_len)
+                    pst_tag->e_key = b_upper?(DB_TAG_KEY_UPPER):(DB_TAG_KEY_RAW);
+                break;
+            case 'N':
+            case 'F':
+                if((false == b_upper) && (8 == pst_tag->u16_key_len))
+                    pst_tag->e_key = DB_TAG_KEY_NUM;
+                break;
+            case 'D':
+                if((false == b_upper) && (8 == pst_tag->u16_key_len))
+                    pst_tag->e_key = DB_TAG_KEY_DATE;
+                break;
+            case 'I':
+                if((false == b_upper) && (4 == pst_tag->u16_key_len))
+                    pst_tag->e_key = DB_TAG_KEY_INT;
+                break;
+            default:
+                break;
+        }
+
+        if(DB_TAG_KEY_NONE != pst_tag->e_key)
+            pst_tag->i16_field_idx = idx;
+
+        break;
+    }
+}
+
+/* encode a key given as field data (see db_field_view) into tag order */
+static bool _db_tag_key_encode(
+        const struct db_tag *pst_tag,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len,
+        uint8_t *pu8_out)
+{
+    switch(pst_tag->e_key)
+    {
+        case DB_TAG_KEY_RAW:
+        case DB_TAG_KEY_UPPER:
+            if(u32_key_len > pst_tag->u16_key_len)
+                return false;
+
+            for(uint32_t idx=0; idx<u32_key_len; idx++)
+                pu8_out[idx] = (DB_TAG_KEY_UPPER == pst_tag->e_key)?(toupper(pu8_key[idx])):(pu8_key[idx]);
+
+            memset((void *)&pu8_out[u32_key_len], ' ', pst_tag->u16_key_len-u32_key_len);
+            return true;
+        case DB_TAG_KEY_NUM:
+        case DB_TAG_KEY_DATE:
+            {
+                char s_num[64];
+                double d_val;
+                uint64_t u64_val;
+
+                if((0 == u32_key_len) || (u32_key_len >= sizeof(s_num)))
+                    return false;
+
+                memcpy((void *)s_num, (void *)pu8_key, u32_key_len);
+                s_num[u32_key_len] = '\0';
+
+                if(DB_TAG_KEY_DATE == pst_tag->e_key)
+                {
+                    if(8 != u32_key_len)
+                        return false;
+
+                    d_val = _db_date_to_JD(
+                            (s_num[0]-'0')*1000+(s_num[1]-'0')*100+(s_num[2]-'0')*10+(s_num[3]-'0'),
+                            (s_num[4]-'0')*10+(s_num[5]-'0'),
+                            (s_num[6]-'0')*10+(s_num[7]-'0'));
+                }
+                else
+                {
+                    d_val = strtod(s_num, NULL);
+                }
+
+                /* big endian double, positive with sign set, negative inverted */
+                memcpy((void *)&u64_val, (void *)&d_val, sizeof(u64_val));
+                u64_val = (u64_val>>63)?(~u64_val):(u64_val|(1ull<<63));
+
+                for(int idx=7; idx>=0; idx--, u64_val>>=8)
+                    pu8_out[idx] = u64_val&0xff;
+
+                return true;
+            }
+        case DB_TAG_KEY_INT:
+            {
+                uint32_t u32_val;
+
+                if(4 != u32_key_len)
+                    return false;
+
+                u32_val = _db_get_le32(pu8_key)^0x80000000;
+                pu8_out[0] = u32_val>>24;
+                pu8_out[1] = u32_val>>16;
+                pu8_out[2] = u32_val>>8;
+                pu8_out[3] = u32_val;
+                return true;
+            }
+        default:
+            return false;
+    }
+}
+
+/* a .CDX tag without a collation name, or named MACHINE, sorts keys by
+ * their bytes; any other collation (GENERAL, ...) is not understood */
+static bool _db_tag_is_machine(const uint8_t *pu8_hdr)
+{
+    const uint8_t *pu8_name = &pu8_hdr[DB_IXF_COLLATE_OFF];
+
+    if(0 == memcmp((void *)pu8_name, (void *)"MACHINE", 7))
+        pu8_name += 7;
+
+    for(; pu8_name<&pu8_hdr[DB_IXF_COLLATE_OFF+DB_IXF_COLLATE_LEN]; pu8_name++)
+    {
+        if(('\0' != *pu8_name) && (' ' != *pu8_name))
+            return false;
+    }
+
+    return true;
+}
+
+static bool _db_tag_add(
+        struct db *pst_db,
+        struct db_ixf *pst_ixf,
+        const char *s_name,
+        uint32_t u32_hdr_off)
+{
+    const uint8_t *pu8_hdr;
+    struct db_tag *pst_tag;
+    const char *s_pool;
+    size_t t_pool_len;
+
+    if((size_t)u32_hdr_off+DB_IXF_NODE_SIZE > pst_ixf->t_map_len)
+        return false;
+
+    pst_tag = (struct db_tag *)realloc(pst_db->ast_tag, (pst_db->u16_tag_num+1)*sizeof(struct db_tag));
+    if(!pst_tag)
+        return false;
+
+    pst_db->ast_tag = pst_tag;
+    pst_tag = &pst_db->ast_tag[pst_db->u16_tag_num];
+    memset((void *)pst_tag, 0, sizeof(struct db_tag));
+
+    pu8_hdr = &pst_ixf->pu8_map[u32_hdr_off];
+
+    strncpy(pst_tag->s_name, s_name, sizeof(pst_tag->s_name)-1);
+    pst_tag->pst_ixf = pst_ixf;
+    pst_tag->u32_root = _db_get_le32(&pu8_hdr[0]);
+    pst_tag->u16_key_len = pu8_hdr[12] | pu8_hdr[13]<<8;
+    pst_tag->u8_option = pu8_hdr[14];
+    pst_tag->b_compact = (pst_tag->u8_option & DB_IXF_OPT_COMPACT)?(true):(false);
+
+    if(true == pst_tag->b_compact)
+    {
+        /* key and FOR expression pool follows the 512 bytes header */
+        if((size_t)u32_hdr_off+2*DB_IXF_NODE_SIZE > pst_ixf->t_map_len)
+            return false;
+
+        pst_tag->b_desc = (0 != (pu8_hdr[502] | pu8_hdr[503]<<8));
+        pst_tag->b_machine = _db_tag_is_machine(pu8_hdr);
+        s_pool = (const char *)&pu8_hdr[DB_IXF_NODE_SIZE];
+        t_pool_len = DB_IXF_NODE_SIZE;
+
+        pst_tag->s_expr = strndup(s_pool, t_pool_len);
+        if((pst_tag->u8_option & DB_IXF_OPT_FOR) && pst_tag->s_expr)
+        {
+            size_t t_expr_len = strlen(pst_tag->s_expr)+1;
+
+            if(t_expr_len < t_pool_len)
+                pst_tag->s_for = strndup(s_pool+t_expr_len, t_pool_len-t_expr_len);
+        }
+    }
+    else
+    {
+        /* .IDX keys are always in machine order */
+        pst_tag->b_machine = true;
+        pst_tag->s_expr = strndup((const char *)&pu8_hdr[16], 220);
+        if(pst_tag->u8_option & DB_IXF_OPT_FOR)
+            pst_tag->s_for = strndup((const char *)&pu8_hdr[236], 220);
+    }
+
+    if(!pst_tag->s_expr)
+        return false;
+
+    _db_tag_bind(pst_db, pst_tag);
+
+    if(0 == pst_db->u16_tag_num)
+        pst_db->u32_tag_rec_num = pst_db->st_file_hdr.u32_rec_num;
+
+    pst_db->u16_tag_num++;
+
+    return true;
+}
+
+struct _db_tag_dir
+{
+    struct db *pst_db;
+    struct db_ixf *pst_ixf;
+};
+
+static bool _db_tag_dir_visit(const uint8_t *pu8_key, uint32_t u32_rec_id, void *pv_usr_data)
+{
+    struct _db_tag_dir *pst_dir = (struct _db_tag_dir *)pv_usr_data;
+    char s_name[11];
+    int i_len = 10;
+
+    memcpy((void *)s_name, (void *)pu8_key, 10);
+    while((i_len > 0) && ((' ' == s_name[i_len-1]) || ('\0' == s_name[i_len-1])))
+        i_len--;
+
+    s_name[i_len] = '\0';
+
+    /* the record number of a directory entry is the tag header offset */
+    _db_tag_add(pst_dir->pst_db, pst_dir->pst_ixf, s_name, u32_rec_id+1);
+
+    return true;
+}
+
+static bool _db_ixf_open(struct db *pst_db, const char *s_file_name)
+{
+    struct db_ixf *pst_ixf;
+    struct db_ixf **apst_ixf;
+    struct stat st_stat;
+    struct stat st_db_stat;
+    void *pv_map;
+    int fd;
+
+    fd = open(s_file_name, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    if((0 != fstat(fd, &st_stat)) || (st_stat.st_size < DB_IXF_NODE_SIZE))
+    {
+        close(fd);
+        return false;
+    }
+
+    pv_map = mmap(NULL, st_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(MAP_FAILED == pv_map)
+        return false;
+
+    pst_ixf = (struct db_ixf *)calloc(1, sizeof(struct db_ixf));
+    apst_ixf = (struct db_ixf **)realloc(pst_db->apst_ixf, (pst_db->u8_ixf_num+1)*sizeof(struct db_ixf *));
+
+    if(!pst_ixf || !apst_ixf || (255 == pst_db->u8_ixf_num))
+    {
+        free(pst_ixf);
+        if(apst_ixf)
+            pst_db->apst_ixf = apst_ixf;
+
+        munmap(pv_map, st_stat.st_size);
+        return false;
+    }
+
+    pst_ixf->pu8_map = (uint8_t *)pv_map;
+    pst_ixf->t_map_len = st_stat.st_size;
+
+    /* the table was written after the index, which may miss the change */
+    if(0 == fstat(fileno(pst_db->pf_db), &st_db_stat))
+    {
+        pst_ixf->b_stale = (st_stat.st_mtim.tv_sec < st_db_stat.st_mtim.tv_sec) ||
+                           ((st_stat.st_mtim.tv_sec == st_db_stat.st_mtim.tv_sec) &&
+                            (st_stat.st_mtim.tv_nsec < st_db_stat.st_mtim.tv_nsec));
+    }
+
+    pst_db->apst_ixf = apst_ixf;
+    pst_db->apst_ixf[pst_db->u8_ixf_num++] = pst_ixf;
+
+    if(pst_ixf->pu8_map[14] & DB_IXF_OPT_COMPOUND)
+    {
+        /* the header of a compound file indexes the tags by name */
+        struct db_tag st_dir = {0};
+        struct _db_tag_dir st_ctx = {.pst_db=pst_db,.pst_ixf=pst_ixf};
+
+        st_dir.pst_ixf = pst_ixf;
+        st_dir.u32_root = _db_get_le32(&pst_ixf->pu8_map[0]);
+        st_dir.u16_key_len = pst_ixf->pu8_map[12] | pst_ixf->pu8_map[13]<<8;
+        st_dir.b_compact = true;
+
+        return _db_tag_walk(&st_dir, NULL, _db_tag_dir_visit, &st_ctx);
+    }
+    else
+    {
+        /* single index, the tag is named after the file */
+        const char *s_base = strrchr(s_file_name, '/');
+        char s_name[11] = {0};
+
+        s_base = (s_base)?(s_base+1):(s_file_name);
+        for(int idx=0; (idx < 10) && s_base[idx] && ('.' != s_base[idx]); idx++)
+            s_name[idx] = toupper((unsigned char)s_base[idx]);
+
+        return _db_tag_add(pst_db, pst_ixf, s_name, 0);
+    }
+}
+
+static void _db_ixf_close(struct db *pst_db)
+{
+    for(int idx=0; idx<pst_db->u16_tag_num; idx++)
+    {
+        free(pst_db->ast_tag[idx].s_expr);
+        free(pst_db->ast_tag[idx].s_for);
+    }
+
+    free(pst_db->ast_tag);
+    pst_db->ast_tag = NULL;
+    pst_db->u16_tag_num = 0;
+
+    for(int idx=0; idx<pst_db->u8_ixf_num; idx++)
+    {
+        munmap((void *)pst_db->apst_ixf[idx]->pu8_map, pst_db->apst_ixf[idx]->t_map_len);
+        free(pst_db->apst_ixf[idx]);
+    }
+
+    free(pst_db->apst_ixf);
+    pst_db->apst_ixf = NULL;
+    pst_db->u8_ixf_num = 0;
+}
+
+static bool _db_tag_count_visit(const uint8_t *pu8_key, uint32_t u32_rec_id, void *pv_usr_data)
+{
+    uint32_t *pu32_count = (uint32_t *)pv_usr_data;
+
+    /* pu32_count[0] counts keys of the records pu32_count[1] holds */
+    if(u32_rec_id < pu32_count[1])
+        pu32_count[0]++;
+
+    return true;
+}
+
+/* a tag which orders every record by the plain value of the field, so
+ * a key it misses is not in the records which existed when it was read */
+static int32_t _db_tag_for_field(struct db *pst_db, uint32_t u32_field_idx)
+{
+    for(int idx=0; idx<pst_db->u16_tag_num; idx++)
+    {
+        struct db_tag *pst_tag = &pst_db->ast_tag[idx];
+
+        if((pst_tag->i16_field_idx != u32_field_idx) ||
+           (DB_TAG_KEY_UPPER == pst_tag->e_key) ||
+           (pst_tag->u8_option & (DB_IXF_OPT_FOR|DB_IXF_OPT_UNIQUE)) ||
+           (true == pst_tag->pst_ixf->b_stale))
+            continue;
+
+        /* count the keys once, a tag missing records is of no use */
+        if(DB_TAG_UNCHECKED == pst_tag->u8_complete)
+        {
+            uint32_t au32_count[2] = {0, pst_db->u32_tag_rec_num};
+
+            pst_tag->u8_complete = DB_TAG_PARTIAL;
+            if((true == _db_tag_walk(pst_tag, NULL, _db_tag_count_visit, au32_count)) &&
+               (au32_count[0] == pst_db->u32_tag_rec_num))
+                pst_tag->u8_complete = DB_TAG_COMPLETE;
+        }
+
+        if(DB_TAG_COMPLETE == pst_tag->u8_complete)
+            return idx;
+    }
+
+    return -1;
+}
+
+static void _db_order_free(struct db_order *pst_order)
+{
+    if(!pst_order)
+        return;
+
+    if(pst_order->b_mapped)
+    {
+        free(pst_order);
+        return;
+    }
+
+    free(pst_order->pi64_key);
+    free(pst_order->pu32_rec_id);
+    free(pst_order);
+}
+
+/* derive the name of a file next to the table with another extension */
+static char *_db_sidecar_name(const char *s_file_name, const char *s_ext)
+{
+    char *s_name;
+    char *s_dot;
+
+    s_name = (char *)malloc(strlen(s_file_name)+strlen(s_ext)+1);
+    if(!s_name)
+        return NULL;
+
+    strcpy(s_name, s_file_name);
+
+    s_dot = strrchr(s_name, '.');
+    if((NULL == s_dot) || (NULL != strchr(s_dot, '/')))
+        s_dot = s_name+strlen(s_name);
+
+    strcpy(s_dot, s_ext);
+
+    return s_name;
+}
+
+hdb db_open(char *s_file_name)
+{
+    return db_open_ex(s_file_name, NULL);
+}
+
+hdb db_open_ex(char *s_file_name, const struct db_config *pst_config)
+{
+    struct db *pst_db = NULL;
+    uint8_t u8_code_page = 0;
+    bool b_encode = (pst_config) && (pst_config->s_encode);
+
+    do
+    {
+        /* open db file (.dbf) */
+        if(!s_file_name)
+            break;
+
+        if((true == b_encode) && (false == db_cp_find(pst_config->s_encode, &u8_code_page)))
+            break;
+
+        pst_db = (struct db *)calloc(sizeof(struct db), 1);
+        if(!pst_db)
+            break;
+
+        pthread_mutex_init(&pst_db->st_memo_aio_lock, NULL);
+
+        pst_db->s_db_name = strdup(s_file_name);
+        pst_db->u8_access = (pst_config)?(pst_config->u8_access):(DB_ACCESS_CACHE);
+
+        pst_db->pf_db = fopen(s_file_name, "rb");
+        if(NULL == pst_db->pf_db)
+            break;
+
+        _db_read_file_header(pst_db);
+
+        pst_db->u8_code_page = (true == b_encode)?(u8_code_page):(pst_db->st_file_hdr.u8_code_page);
+
+        /* open memo file (.fpt) if available */
+        if(pst_db->st_file_hdr.u8_flag & 0x02)
+        {
+            pst_db->s_memo_name = strdup(s_file_name);
+            sprintf(strchr(pst_db->s_memo_name, '.'), ".FPT");
+
+            pst_db->pf_memo = fopen(pst_db->s_memo_name, "rb");
+            if(NULL == pst_db->pf_memo)
+            {
+                printf("warning: memo file missing.\n");
+            }
+            else
+            {
+                _db_read_memo_header(pst_db);
+                _db_memo_map_init(pst_db);
+            }
+        }
+
+        /* parsing field description */
+        _db_read_field_desc(pst_db);
+
+        _db_rec_cache_init(pst_db, pst_config);
+
+        /* open structural index file (.cdx) if available */
+        if(pst_db->st_file_hdr.u8_flag & 0x01)
+        {
+            const char *as_ext[] = {".CDX", ".cdx"};
+
+            for(int idx=0; idx<2; idx++)
+            {
+                char *s_cdx_name = _db_sidecar_name(s_file_name, as_ext[idx]);
+                bool b_open = (s_cdx_name) && (true == _db_ixf_open(pst_db, s_cdx_name));
+
+                free(s_cdx_name);
+                if(true == b_open)
+                    break;
+            }
+        }
+
+        /* attach persisted indexes (.hix) if still valid */
+        pst_db->s_hix_name = _db_sidecar_name(s_file_name, ".HIX");
+        if(pst_db->s_hix_name)
+            _db_index_attach(pst_db);
+
+        return (hdb)pst_db;
+    }while(0);
+
+    return INVALID_DB_HANDLE;
+}
+
+bool db_close(hdb h_db)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if(pst_db->s_db_name)
+        free(pst_db->s_db_name);
+
+    if(pst_db->s_memo_name)
+        free(pst_db->s_memo_name);
+
+    if(pst_db->pf_db)
+        fclose(pst_db->pf_db);
+
+    /* no memo read may be left in flight on the file */
+    _db_aio_destroy(pst_db->pst_memo_aio);
+    pthread_mutex_destroy(&pst_db->st_memo_aio_lock);
+
+    if(pst_db->pf_memo)
+        fclose(pst_db->pf_memo);
+
+    if(pst_db->pu8_memo_map)
+        munmap((void *)pst_db->pu8_memo_map, pst_db->t_memo_map_len);
+
+    /* free find function buffer */
+    free(pst_db->pu8_find_buf);
+
+    /* free field indexes */
+    if(pst_db->apst_index)
+    {
+        for(int idx=0; idx<pst_db->st_field_info.u8_field_num; idx++)
+            _db_index_free(pst_db->apst_index[idx]);
+
+        free(pst_db->apst_index);
+    }
+
+    if(pst_db->pu8_hix_map)
+        munmap((void *)pst_db->pu8_hix_map, pst_db->t_hix_len);
+
+    /* close FoxPro index files */
+    _db_ixf_close(pst_db);
+
+    /* free ordered indexes */
+    if(pst_db->apst_order)
+    {
+        for(int idx=0; idx<pst_db->st_field_info.u8_field_num; idx++)
+            _db_order_free(pst_db->apst_order[idx]);
+
+        free(pst_db->apst_order);
+    }
+
+    free(pst_db->s_hix_name);
+
+    /* free field info */
+    {
+        struct db_field_info *pst_info = &pst_db->st_field_info;
+        struct db_field *pst_field = pst_info->pst_field;
+        struct db_field *pst_next = pst_info->pst_field->pst_next;
+
+        while(pst_field)
+        {
+            free(pst_field);
+            pst_field = pst_next;
+
+            if(pst_field)
+                pst_next = pst_field->pst_next;
+        }
+
+        free(pst_info->a_field);
+    }
+
+    /* deinit record cache */
+    _db_rec_cache_deinit(pst_db);
+
+    memset((void *)pst_db, 0, sizeof(struct db));
+    free(pst_db);
+
+    return true;
+}
+
+bool db_get_info(hdb h_db, struct db_info *pst_info)
+{
+    struct db_file_hdr *pst_hdr;
+
+    if(INVALID_DB_HANDLE == h_db || NULL == pst_info)
+    {
+        return false;
+    }
+
+    pst_hdr = &((struct db *)(h_db))->st_file_hdr;
+
+    pst_info->u8_type = pst_hdr->u8_type;
+    memcpy((void *)pst_info->au8_last_update, (void *)pst_hdr->au8_last_update, 3);
+    pst_info->u16_hdr_len = pst_hdr->u16_hdr_len;
+    pst_info->u32_rec_num = pst_hdr->u32_rec_num;
+    pst_info->u16_rec_len = pst_hdr->u16_rec_len;
+    pst_info->u8_enc = pst_hdr->u8_enc;
+    pst_info->u8_code_page = ((struct db *)(h_db))->u8_code_page;
+
+    return true;
+}
+
+bool db_prefetch(hdb h_db, uint32_t u32_first_id, uint32_t u32_num)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    uint32_t u32_last_blk;
+    bool b_ret = true;
+
+    if(u32_first_id >= pst_hdr->u32_rec_num)
+        return false;
+
+    if(u32_num > pst_hdr->u32_rec_num-u32_first_id)
+        u32_num = pst_hdr->u32_rec_num-u32_first_id;
+
+    if(0 == u32_num)
+        return true;
+
+    if(NULL != pst_db->pu8_map)
+    {
+        size_t t_page = sysconf(_SC_PAGESIZE);
+        size_t t_start = pst_hdr->u16_hdr_len+(size_t)u32_first_id*pst_hdr->u16_rec_len;
+        size_t t_end = t_start+(size_t)u32_num*pst_hdr->u16_rec_len;
+
+        t_start -= t_start%t_page;
+
+        return (0 == madvise((void *)&pst_db->pu8_map[t_start], t_end-t_start, MADV_WILLNEED));
+    }
+
+    /* records already in memory */
+    if(NULL == pst_cache)
+        return (NULL != pst_db->pu8_rec_cache);
+
+    u32_last_blk = (u32_first_id+u32_num-1)/pst_cache->u32_blk_rec_num;
+
+    pthread_mutex_lock(&pst_cache->st_lock);
+
+    for(uint32_t u32_blk_idx=u32_first_id/pst_cache->u32_blk_rec_num; u32_blk_idx<=u32_last_blk; u32_blk_idx++)
+    {
+        if(DB_PAGE_NONE != pst_cache->pu32_blk_map[u32_blk_idx])
+            continue;
+
+        /* a bounded cache keeps only the tail of a longer range */
+        if(false == _db_page_load(pst_db, u32_blk_idx, u32_last_blk-u32_blk_idx+1))
+        {
+            b_ret = false;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&pst_cache->st_lock);
+
+    return b_ret;
+}
+
+uint8_t db_field_get_num(hdb h_db)
+{
+    return ((struct db *)h_db)->st_field_info.u8_field_num;
+}
+
+int16_t db_field_get_idx(hdb h_db, char *s_name)
+{
+    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
+    struct db_field *pst_field;
+    uint8_t u8_idx = 0;
+
+    pst_field = pst_info->pst_field;
+    while(pst_field)
+    {
+        if(0 == strcmp(s_name, pst_field->s_name))
+        {
+            return u8_idx;
+        }
+
+        u8_idx++;
+        pst_field = pst_field->pst_next;
+    }
+
+    return -1;
+}
+
+hdb_arena db_arena_create(uint32_t u32_blk_size)
+{
+    struct db_arena *pst_arena = (struct db_arena *)calloc(1, sizeof(struct db_arena));
+
+    if(!pst_arena)
+        return NULL;
+
+    pst_arena->t_blk_size = (0 != u32_blk_size)?(u32_blk_size):(DB_ARENA_DEF_BLK_SIZE);
+
+    return pst_arena;
+}
+
+void *db_arena_alloc(hdb_arena h_arena, uint32_t u32_len)
+{
+    if(NULL == h_arena)
+        return NULL;
+
+    return _db_arena_alloc((struct db_arena *)h_arena, u32_len);
+}
+
+void db_arena_reset(hdb_arena h_arena)
+{
+    struct db_arena *pst_arena = (struct db_arena *)h_arena;
+    struct db_arena_blk **ppst_blk;
+
+    if(NULL == pst_arena)
+        return;
+
+    /* blocks of the usual size are kept, those of a single large
+     * value are not */
+    ppst_blk = &pst_arena->pst_head;
+    while(NULL != *ppst_blk)
+    {
+        struct db_arena_blk *pst_blk = *ppst_blk;
+
+        if(pst_blk->t_size > pst_arena->t_blk_size)
+        {
+            *ppst_blk = pst_blk->pst_next;
+            free(pst_blk);
+        }
+        else
+        {
+            ppst_blk = &pst_blk->pst_next;
+        }
+    }
+
+    pst_arena->pst_cur = NULL;
+    pst_arena->t_used = 0;
+}
+
+void db_arena_free(hdb_arena h_arena)
+{
+    struct db_arena *pst_arena = (struct db_arena *)h_arena;
+
+    if(NULL == pst_arena)
+        return;
+
+    while(NULL != pst_arena->pst_head)
+    {
+        struct db_arena_blk *pst_blk = pst_arena->pst_head;
+
+        pst_arena->pst_head = pst_blk->pst_next;
+        free(pst_blk);
+    }
+
+    free(pst_arena);
+}
+
+/* value of db_field_map_data, from the arena when there is one */
+static void *_db_map_alloc(struct db_arena *pst_arena, uint32_t u32_len, bool b_zero)
+{
+    void *pv_data;
+
+    if(NULL == pst_arena)
+        return (true == b_zero)?(calloc(1, u32_len)):(malloc(u32_len));
+
+    pv_data = _db_arena_alloc(pst_arena, u32_len);
+    if((NULL != pv_data) && (true == b_zero))
+        memset(pv_data, 0, u32_len);
+
+    return pv_data;
+}
+
+/* I, B, Y and T fields hold binary values of 4 (I) or 8 bytes; a dBase
+ * B field is a 10 bytes memo pointer and is text like others */
+static bool _db_bin_len_ok(const struct db_field *pst_field)
+{
+    switch(toupper(pst_field->u8_type))
+    {
+        case 'I':
+            return (4 == pst_field->u8_len);
+        case 'B':
+        case 'Y':
+        case 'T':
+            return (8 == pst_field->u8_len);
+        default:
+            return false;
+    }
+}
+
+static struct db_var _db_field_map(
+        struct db *pst_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        struct db_arena *pst_arena)
+{
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    struct db_field *pst_field;
+    char *s_map_data = NULL;
+    uint32_t u32_len = 0;
+    uint8_t u8_type;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return (struct db_var){0};
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    pu8_rec_data = pu8_rec_data + pst_field->u32_acc_len;
+
+    /* binary fields of an unexpected width are mapped as text */
+    u8_type = toupper(pst_field->u8_type);
+    if((('I' == u8_type) || ('B' == u8_type) || ('Y' == u8_type) || ('T' == u8_type)) &&
+       (false == _db_bin_len_ok(pst_field)))
+        u8_type = 'C';
+
+    switch(u8_type)
+    {
+        case 'C':
+            {
+                size_t t_len;
+
+                u32_len = pst_field->u8_len+2;
+                s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, true);
+                if(!s_map_data)
+                    break;
+
+                memcpy(
+                    (void *)s_map_data,
+                    (void *)pu8_rec_data,
+                    pst_field->u8_len);
+
+                _remove_trailing_space(s_map_data);
+
+                t_len = strlen(s_map_data);
+                if(t_len > 1)
+                {
+                    s_map_data[t_len] = ' ';
+                    s_map_data[t_len+1] = '\0';
+                }
+            }
+            break;
+        case 'N':
+        case 'F':
+            if(0x20 != pu8_rec_data[pst_field->u8_len-1])
+            {
+                u32_len = pst_field->u8_len+1;
+                s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+                if(!s_map_data)
+                    break;
+
+                memcpy((void *)s_map_data, (void *)pu8_rec_data, pst_field->u8_len);
+                s_map_data[pst_field->u8_len] = '\0';
+            }
+            break;
+        case 'D':
+            if(0x20 != pu8_rec_data[0])
+            {
+                u32_len = 11;
+                s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+                if(!s_map_data)
+                    break;
+
+                sprintf(s_map_data, "%c%c%c%c/%c%c/%c%c", pu8_rec_data[0], pu8_rec_data[1], pu8_rec_data[2], pu8_rec_data[3], pu8_rec_data[4], pu8_rec_data[5], pu8_rec_data[6], pu8_rec_data[7]);
+                s_map_data[10] = '\0';
+            }
+            break;
+        case 'L':
+            u32_len = 2;
+            s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+            if(!s_map_data)
+                break;
+
+            s_map_data[0] = toupper(pu8_rec_data[0]);
+            s_map_data[1] = '\0';
+            break;
+        case 'I':
+            u32_len = 12;
+            s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+            if(!s_map_data)
+                break;
+
+            sprintf(s_map_data, "%d", (int32_t)_db_get_le32(pu8_rec_data));
+            break;
+        case 'B':
+            {
+                uint64_t u64_val = _db_get_le64(pu8_rec_data);
+                double d_val;
+
+                memcpy((void *)&d_val, (void *)&u64_val, sizeof(d_val));
+
+                u32_len = 32;
+                s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+                if(!s_map_data)
+                    break;
+
+                if(pst_field->u8_dec)
+                    snprintf(s_map_data, u32_len, "%.*f", pst_field->u8_dec, d_val);
+                else
+                    snprintf(s_map_data, u32_len, "%.15g", d_val);
+            }
+            break;
+        case 'Y':
+            {
+                int64_t i64_val = (int64_t)_db_get_le64(pu8_rec_data);
+                uint64_t u64_abs = (i64_val < 0)?(-(uint64_t)i64_val):((uint64_t)i64_val);
+
+                u32_len = 24;
+                s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+                if(!s_map_data)
+                    break;
+
+                sprintf(
+                    s_map_data,
+                    "%s%llu.%04llu",
+                    (i64_val < 0)?("-"):(""),
+                    (unsigned long long)(u64_abs/10000),
+                    (unsigned long long)(u64_abs%10000));
+            }
+            break;
+        case 'T':
+            {
+                struct db_date st_date;
+
+                if(false == _db_time_is_blank(pu8_rec_data))
+                {
+                    u32_len = 20;
+                    s_map_data = (char *)_db_map_alloc(pst_arena, u32_len, false);
+                    if(!s_map_data)
+                        break;
+
+                    _db_JD_to_date(pu8_rec_data, &st_date);
+                    sprintf(
+                        s_map_data,
+                        "%d/%02d/%02d %02d:%02d:%02d",
+                        st_date.u16_year,
+                        st_date.u8_month,
+                        st_date.u8_day,
+                        st_date.u8_hour,
+                        st_date.u8_min,
+                        st_date.u8_sec);
+
+                    s_map_data[19] = '\0';
+                }
+            }
+            break;
+        case 'M':
+            {
+                uint32_t u32_blk_idx;
+
+                u32_blk_idx = (uint32_t)(pu8_rec_data[3]<<24) |
+                                pu8_rec_data[2]<<16 |
+                                pu8_rec_data[1]<<8 |
+                                pu8_rec_data[0];
+
+                if(0 == u32_blk_idx)
+                {
+                    s_map_data = NULL;
+                    break;
+                }
+
+                if(NULL != pst_arena)
+                    s_map_data = (char *)_db_memo_load_arena(pst_db, u32_blk_idx, 2, &u32_len, pst_arena);
+                else
+                    s_map_data = (char *)_db_memo_load(pst_db, u32_blk_idx, 2, &u32_len);
+
+                if(NULL == s_map_data)
+                {
+                    u32_len = 0;
+                    break;
+                }
+
+                u32_len += 2;
+                s_map_data[u32_len-2] = ' ';
+                s_map_data[u32_len-1] = '\0';
+            }
+            break;
+        default:
+            s_map_data = NULL;
+            break;
+    }
+
+    if(NULL == s_map_data)
+        u32_len = 0;
+
+    return (struct db_var){.u8_type=pst_field->u8_type,.u32_data_len=u32_len,.pv_data=(void *)s_map_data};
+}
+
+struct db_var db_field_map_data(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx)
+{
+    return _db_field_map((struct db *)h_db, pu8_rec_data, u32_field_idx, NULL);
+}
+
+struct db_var db_field_map_data_arena(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        hdb_arena h_arena)
+{
+    if(NULL == h_arena)
+        return (struct db_var){0};
+
+    return _db_field_map((struct db *)h_db, pu8_rec_data, u32_field_idx, (struct db_arena *)h_arena);
+}
+
+
+bool db_field_unmap_data(hdb h_db, struct db_var *pst_var)
+{
+    free(pst_var->pv_data);
+
+    pst_var->u8_type = 0;
+    pst_var->u32_data_len = 0;
+    pst_var->pv_data = NULL;
+
+    return true;
+}
+
+static uint8_t *_db_fmt_num(uint8_t *pu8_buf, uint32_t u32_val, uint8_t u8_width)
+{
+    for(int idx=u8_width-1; idx>=0; idx--)
+    {
+        pu8_buf[idx] = '0'+(u32_val%10);
+        u32_val /= 10;
+    }
+
+    return pu8_buf+u8_width;
+}
+
+bool db_field_view(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        struct db_view *pst_view,
+        uint8_t *pu8_scratch,
+        uint32_t u32_scratch_len)
+{
+    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
+    struct db_field *pst_field;
+    const uint8_t *pu8_data;
+    uint32_t u32_len;
+
+    if((u32_field_idx >= pst_info->u8_field_num) || (NULL == pst_view))
+        return false;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    pu8_data = _db_field_trim(pst_field, pu8_rec_data+pst_field->u32_acc_len, &u32_len);
+
+    pst_view->u8_type = pst_field->u8_type;
+
+    switch(toupper(pst_field->u8_type))
+    {
+        case 'T':
+            {
+                struct db_date st_date;
+                uint8_t *pu8_buf = pu8_scratch;
+
+                if(true == _db_time_is_blank(pu8_data))
+                {
+                    u32_len = 0;
+                    break;
+                }
+
+                if((NULL == pu8_scratch) || (u32_scratch_len < 19))
+                    return false;
+
+                _db_JD_to_date(pu8_data, &st_date);
+
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u16_year, 4);
+                *pu8_buf++ = '/';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_month, 2);
+                *pu8_buf++ = '/';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_day, 2);
+                *pu8_buf++ = ' ';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_hour, 2);
+                *pu8_buf++ = ':';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_min, 2);
+                *pu8_buf++ = ':';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_sec, 2);
+
+                pu8_data = pu8_scratch;
+                u32_len = pu8_buf-pu8_scratch;
+            }
+            break;
+        case 'M':
+            {
+                uint32_t u32_blk_idx;
+
+                u32_blk_idx = (uint32_t)(pu8_data[3]<<24) |
+                                pu8_data[2]<<16 |
+                                pu8_data[1]<<8 |
+                                pu8_data[0];
+
+                uint32_t u32_memo_len = 0;
+
+                /* mapped memos are viewed in place, others are read
+                 * into the scratch buffer */
+                pu8_data = (uint8_t *)_db_memo_fetch(
+                        (struct db *)h_db,
+                        u32_blk_idx,
+                        pu8_scratch,
+                        u32_scratch_len,
+                        &u32_memo_len,
+                        &u32_len);
+
+                if(NULL == pu8_data)
+                    u32_len = 0;
+            }
+            break;
+        default:
+            break;
+    }
+
+    pst_view->u32_data_len = u32_len;
+    pst_view->pu8_data = pu8_data;
+
+    return true;
+}
+
+bool db_memo_open(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        struct db_memo *pst_memo)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    struct db_field *pst_field;
+    uint32_t u32_avail;
+    uint8_t u8_none;
+
+    if((u32_field_idx >= pst_info->u8_field_num) || (NULL == pst_memo))
+        return false;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    if('M' != toupper(pst_field->u8_type))
+        return false;
+
+    pst_memo->u32_blk_idx = _db_get_le32(pu8_rec_data+pst_field->u32_acc_len);
+    pst_memo->u32_len = 0;
+
+    /* blank memo */
+    if(0 == pst_memo->u32_blk_idx)
+        return true;
+
+    /* only the block header is read when the memo is not mapped */
+    if(NULL == _db_memo_fetch(pst_db, pst_memo->u32_blk_idx, &u8_none, 0, &pst_memo->u32_len, &u32_avail))
+        return false;
+
+    /* mapped memos are cut at the end of a truncated file */
+    if(NULL != pst_db->pu8_memo_map)
+        pst_memo->u32_len = u32_avail;
+
+    return true;
+}
+
+uint32_t db_memo_read(
+        hdb h_db,
+        const struct db_memo *pst_memo,
+        uint32_t u32_offset,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len)
+{
+    struct db *pst_db = (struct db *)h_db;
+    off_t t_offset;
+    ssize_t t_read;
+
+    if((NULL == pst_memo) || (NULL == pu8_buf) || (u32_offset >= pst_memo->u32_len))
+        return 0;
+
+    if(u32_buf_len > pst_memo->u32_len-u32_offset)
+        u32_buf_len = pst_memo->u32_len-u32_offset;
+
+    t_offset = (off_t)pst_memo->u32_blk_idx*pst_db->st_memo_hdr.u16_blk_size+8+u32_offset;
+
+    if(NULL != pst_db->pu8_memo_map)
+    {
+        memcpy((void *)pu8_buf, (void *)&pst_db->pu8_memo_map[t_offset], u32_buf_len);
+        return u32_buf_len;
+    }
+
+    if(NULL == pst_db->pf_memo)
+        return 0;
+
+    t_read = pread(fileno(pst_db->pf_memo), (void *)pu8_buf, u32_buf_len, t_offset);
+
+    return (t_read > 0)?(t_read):(0);
+}
+
+const uint8_t *db_memo_ptr(hdb h_db, const struct db_memo *pst_memo)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if((NULL == pst_memo) || (0 == pst_memo->u32_len) || (NULL == pst_db->pu8_memo_map))
+        return NULL;
+
+    return &pst_db->pu8_memo_map[(size_t)pst_memo->u32_blk_idx*pst_db->st_memo_hdr.u16_blk_size+8];
+}
+
+bool db_memo_stream(
+        hdb h_db,
+        const struct db_memo *pst_memo,
+        uint32_t u32_chunk_size,
+        db_pf_memo_writer pf_writer,
+        void *pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_aio *pst_aio;
+    const uint8_t *pu8_memo;
+    uint8_t *pu8_buf;
+    int32_t ai32_slot[2];
+    uint32_t u32_offset = 0;
+    uint32_t u32_next = 0;
+    off_t t_offset;
+    bool b_ret = true;
+
+    if((NULL == pst_memo) || (NULL == pf_writer))
+        return false;
+
+    if(0 == u32_chunk_size)
+        u32_chunk_size = DB_MEMO_READ_SIZE;
+
+    /* mapped memos are handed out in place */
+    pu8_memo = db_memo_ptr(h_db, pst_memo);
+    if(NULL != pu8_memo)
+    {
+        for(; u32_offset<pst_memo->u32_len; u32_offset+=u32_chunk_size)
+        {
+            uint32_t u32_len = pst_memo->u32_len-u32_offset;
+
+            if(u32_len > u32_chunk_size)
+                u32_len = u32_chunk_size;
+
+            if(false == pf_writer(&pu8_memo[u32_offset], u32_len, pv_usr_data))
+                break;
+        }
+
+        return true;
+    }
+
+    if(0 == pst_memo->u32_len)
+        return true;
+
+    /* a single chunk is not worth a second buffer */
+    if(pst_memo->u32_len <= u32_chunk_size)
+    {
+        pu8_buf = (uint8_t *)malloc(pst_memo->u32_len);
+        if(!pu8_buf)
+            return false;
+
+        if(pst_memo->u32_len == db_memo_read(h_db, pst_memo, 0, pu8_buf, pst_memo->u32_len))
+            pf_writer(pu8_buf, pst_memo->u32_len, pv_usr_data);
+        else
+            b_ret = false;
+
+        free(pu8_buf);
+
+        return b_ret;
+    }
+
+    if(NULL == pst_db->pf_memo)
+        return false;
+
+    pu8_buf = (uint8_t *)malloc(2*(size_t)u32_chunk_size);
+    if(!pu8_buf)
+        return false;
+
+    /* the read ahead context of the handle serves one stream, streams
+     * running beside it read chunk by chunk */
+    pst_aio = NULL;
+    if(0 == pthread_mutex_trylock(&pst_db->st_memo_aio_lock))
+    {
+        if(NULL == pst_db->pst_memo_aio)
+            pst_db->pst_memo_aio = _db_aio_create(fileno(pst_db->pf_memo));
+
+        pst_aio = pst_db->pst_memo_aio;
+        if(NULL == pst_aio)
+            pthread_mutex_unlock(&pst_db->st_memo_aio_lock);
+    }
+
+    if(NULL == pst_aio)
+    {
+        for(; u32_offset<pst_memo->u32_len; u32_offset+=u32_chunk_size)
+        {
+            uint32_t u32_len = pst_memo->u32_len-u32_offset;
+
+            if(u32_len > u32_chunk_size)
+                u32_len = u32_chunk_size;
+
+            if(u32_len != db_memo_read(h_db, pst_memo, u32_offset, pu8_buf, u32_len))
+            {
+                b_ret = false;
+                break;
+            }
+
+            if(false == pf_writer(pu8_buf, u32_len, pv_usr_data))
+                break;
+        }
+
+        free(pu8_buf);
+
+        return b_ret;
+    }
+
+    /* double buffered, the next chunk is read while the writer runs */
+    t_offset = (off_t)pst_memo->u32_blk_idx*pst_db->st_memo_hdr.u16_blk_size+8;
+
+    for(uint32_t idx=0; idx<2; idx++)
+    {
+        uint32_t u32_len = pst_memo->u32_len-u32_next;
+
+        if(u32_len > u32_chunk_size)
+            u32_len = u32_chunk_size;
+
+        ai32_slot[idx] = _db_aio_submit(pst_aio, &pu8_buf[idx*u32_chunk_size], u32_len, t_offset+u32_next);
+        u32_next += u32_len;
+    }
+
+    for(uint32_t idx=0; u32_offset<pst_memo->u32_len; idx^=1)
+    {
+        uint32_t u32_len = pst_memo->u32_len-u32_offset;
+
+        if(u32_len > u32_chunk_size)
+            u32_len = u32_chunk_size;
+
+        if((ai32_slot[idx] < 0) ||
+           (_db_aio_wait(pst_aio, ai32_slot[idx]) < (ssize_t)u32_len))
+        {
+            ai32_slot[idx] = -1;
+            b_ret = false;
+            break;
+        }
+
+        ai32_slot[idx] = -1;
+
+        if(false == pf_writer(&pu8_buf[idx*u32_chunk_size], u32_len, pv_usr_data))
+            break;
+
+        u32_offset += u32_len;
+
+        /* refill the buffer just handed out */
+        if(u32_next < pst_memo->u32_len)
+        {
+            u32_len = pst_memo->u32_len-u32_next;
+
+            if(u32_len > u32_chunk_size)
+                u32_len = u32_chunk_size;
+
+            ai32_slot[idx] = _db_aio_submit(pst_aio, &pu8_buf[idx*u32_chunk_size], u32_len, t_offset+u32_next);
+            u32_next += u32_len;
+        }
+    }
+
+    /* reads still in flight complete before their buffer goes */
+    for(uint32_t idx=0; idx<2; idx++)
+    {
+        if(ai32_slot[idx] >= 0)
+            _db_aio_wait(pst_aio, ai32_slot[idx]);
+    }
+
+    pthread_mutex_unlock(&pst_db->st_memo_aio_lock);
+    free(pu8_buf);
+
+    return b_ret;
+}
+
+bool db_field_cmp(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_cmp_data,
+        uint8_t u8_len)
+{
+    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
+    struct db_field *pst_field;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return false;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    pu8_rec_data = pu8_rec_data + pst_field->u32_acc_len;
+
+    if(u8_len > pst_field->u8_len)
+        return false;
+
+    if(0 == memcmp((void *)pu8_rec_data, (void *)pu8_cmp_data, u8_len))
+        return true;
+
+    return false;
+}
+
+bool db_index_build(hdb h_db, uint32_t u32_field_idx)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    struct db_field *pst_field;
+    struct db_index *pst_index;
+    uint32_t u32_bucket_num = 16;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return false;
+
+    if(NULL == pst_db->apst_index)
+    {
+        pst_db->apst_index = (struct db_index **)calloc(pst_info->u8_field_num, sizeof(struct db_index *));
+        if(!pst_db->apst_index)
+            return false;
+    }
+
+    if(NULL != pst_db->apst_index[u32_field_idx])
+        return true;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+
+    /* keep the load factor at or below one half */
+    while(u32_bucket_num < 2*u32_rec_num)
+        u32_bucket_num <<= 1;
+
+    pst_index = (struct db_index *)calloc(1, sizeof(struct db_index));
+    if(!pst_index)
+        return false;
+
+    pst_index->u32_field_idx = u32_field_idx;
+    pst_index->u32_rec_num = u32_rec_num;
+    pst_index->u32_bucket_mask = u32_bucket_num-1;
+    pst_index->pu32_bucket = (uint32_t *)calloc(u32_bucket_num, sizeof(uint32_t));
+    pst_index->pu32_next = (uint32_t *)malloc((u32_rec_num+1)*sizeof(uint32_t));
+    pst_index->pu32_hash = (uint32_t *)malloc((u32_rec_num+1)*sizeof(uint32_t));
+
+    if(!pst_index->pu32_bucket || !pst_index->pu32_next || !pst_index->pu32_hash)
+    {
+        _db_index_free(pst_index);
+        return false;
+    }
+
+    /* hash every key in file order */
+    for(uint32_t idx=0, u32_num=0; idx<u32_rec_num; idx+=u32_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+
+        if(NULL == pu8_data)
+        {
+            _db_index_free(pst_index);
+            return false;
+        }
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++, pu8_data+=u16_rec_len)
+        {
+            const uint8_t *pu8_key;
+            uint32_t u32_key_len;
+
+            pu8_key = _db_field_trim(pst_field, pu8_data+pst_field->u32_acc_len, &u32_key_len);
+            pst_index->pu32_hash[idx+u32_off] = _db_hash(pu8_key, u32_key_len);
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    /* chain backwards so every bucket lists record ids ascending */
+    for(uint32_t idx=u32_rec_num; idx>0; idx--)
+    {
+        uint32_t u32_bucket = pst_index->pu32_hash[idx-1]&pst_index->u32_bucket_mask;
+
+        pst_index->pu32_next[idx-1] = pst_index->pu32_bucket[u32_bucket];
+        pst_index->pu32_bucket[u32_bucket] = idx;
+    }
+
+    pst_db->apst_index[u32_field_idx] = pst_index;
+    pst_db->b_index_dirty = true;
+
+    return true;
+}
+
+bool db_index_drop(hdb h_db, uint32_t u32_field_idx)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if((u32_field_idx >= pst_db->st_field_info.u8_field_num) || (NULL == pst_db->apst_index))
+        return false;
+
+    if(pst_db->apst_index[u32_field_idx])
+        pst_db->b_index_dirty = true;
+
+    _db_index_free(pst_db->apst_index[u32_field_idx]);
+    pst_db->apst_index[u32_field_idx] = NULL;
+
+    return true;
+}
+
+bool db_index_save(hdb h_db)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    struct db_hix_hdr st_hix = {0};
+    struct db_hix_entry st_entry = {0};
+    uint64_t u64_offset;
+    char *s_tmp_name;
+    FILE *fp;
+    bool b_ret = true;
+
+    if(false == pst_db->b_index_dirty)
+        return true;
+
+    if(NULL == pst_db->s_hix_name)
+        return false;
+
+    st_hix.u32_magic = DB_HIX_MAGIC;
+    st_hix.u32_version = DB_HIX_VERSION;
+    memcpy((void *)st_hix.au8_last_update, (void *)pst_db->st_file_hdr.au8_last_update, 3);
+    st_hix.u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    st_hix.u64_file_size = _db_file_size(pst_db);
+
+    for(int idx=0; idx<pst_info->u8_field_num; idx++)
+    {
+        if((pst_db->apst_index) && (pst_db->apst_index[idx]))
+            st_hix.u32_index_num++;
+
+        if((pst_db->apst_order) && (pst_db->apst_order[idx]))
+            st_hix.u32_order_num++;
+    }
+
+    /* write aside and rename so a mapped sidecar stays intact */
+    s_tmp_name = (char *)malloc(strlen(pst_db->s_hix_name)+5);
+    if(!s_tmp_name)
+        return false;
+
+    sprintf(s_tmp_name, "%s.tmp", pst_db->s_hix_name);
+
+    fp = fopen(s_tmp_name, "wb");
+    if(!fp)
+    {
+        free(s_tmp_name);
+        return false;
+    }
+
+    b_ret &= (1 == fwrite((void *)&st_hix, sizeof(st_hix), 1, fp));
+
+    u64_offset = sizeof(st_hix)+
+                 (uint64_t)st_hix.u32_index_num*sizeof(struct db_hix_entry)+
+                 (uint64_t)st_hix.u32_order_num*sizeof(struct db_hix_order);
+
+    for(int idx=0; (st_hix.u32_index_num) && (idx<pst_info->u8_field_num); idx++)
+    {
+        struct db_index *pst_index = pst_db->apst_index[idx];
+
+        if(!pst_index)
+            continue;
+
+        st_entry.u32_field_idx = idx;
+        st_entry.u32_acc_len = pst_info->a_field[idx]->u32_acc_len;
+        st_entry.u32_field_len = pst_info->a_field[idx]->u8_len;
+        st_entry.u32_bucket_mask = pst_index->u32_bucket_mask;
+        st_entry.u64_offset = u64_offset;
+
+        b_ret &= (1 == fwrite((void *)&st_entry, sizeof(st_entry), 1, fp));
+
+        u64_offset += ((uint64_t)pst_index->u32_bucket_mask+1+2*(uint64_t)st_hix.u32_rec_num)*sizeof(uint32_t);
+    }
+
+    for(int idx=0; (st_hix.u32_order_num) && (idx<pst_info->u8_field_num); idx++)
+    {
+        struct db_order *pst_order = pst_db->apst_order[idx];
+        struct db_hix_order st_order = {0};
+
+        if(!pst_order)
+            continue;
+
+        /* keys are mapped in place as int64_t */
+        u64_offset = (u64_offset+sizeof(int64_t)-1)&~(uint64_t)(sizeof(int64_t)-1);
+
+        st_order.u32_field_idx = idx;
+        st_order.u32_acc_len = pst_info->a_field[idx]->u32_acc_len;
+        st_order.u32_field_len = pst_info->a_field[idx]->u8_len;
+        st_order.u32_num = pst_order->u32_num;
+        st_order.u64_offset = u64_offset;
+
+        b_ret &= (1 == fwrite((void *)&st_order, sizeof(st_order), 1, fp));
+
+        u64_offset += (uint64_t)pst_order->u32_num*(sizeof(int64_t)+sizeof(uint32_t));
+    }
+
+    for(int idx=0; (st_hix.u32_index_num) && (idx<pst_info->u8_field_num); idx++)
+    {
+        struct db_index *pst_index = pst_db->apst_index[idx];
+
+        if(!pst_index)
+            continue;
+
+        b_ret &= ((pst_index->u32_bucket_mask+1) == fwrite((void *)pst_index->pu32_bucket, sizeof(uint32_t), pst_index->u32_bucket_mask+1, fp));
+        b_ret &= (st_hix.u32_rec_num == fwrite((void *)pst_index->pu32_next, sizeof(uint32_t), st_hix.u32_rec_num, fp));
+        b_ret &= (st_hix.u32_rec_num == fwrite((void *)pst_index->pu32_hash, sizeof(uint32_t), st_hix.u32_rec_num, fp));
+    }
+
+    for(int idx=0; (st_hix.u32_order_num) && (idx<pst_info->u8_field_num); idx++)
+    {
+        struct db_order *pst_order = pst_db->apst_order[idx];
+        static const uint8_t au8_pad[sizeof(int64_t)] = {0};
+        long l_pad;
+
+        if(!pst_order)
+            continue;
+
+        l_pad = (sizeof(int64_t)-ftell(fp)%sizeof(int64_t))%sizeof(int64_t);
+        b_ret &= (l_pad == fwrite((void *)au8_pad, 1, l_pad, fp));
+        b_ret &= (pst_order->u32_num == fwrite((void *)pst_order->pi64_key, sizeof(int64_t), pst_order->u32_num, fp));
+        b_ret &= (pst_order->u32_num == fwrite((void *)pst_order->pu32_rec_id, sizeof(uint32_t), pst_order->u32_num, fp));
+    }
+
+    b_ret &= (0 == fclose(fp));
+
+    if((true == b_ret) && (0 == rename(s_tmp_name, pst_db->s_hix_name)))
+        pst_db->b_index_dirty = false;
+    else
+    {
+        remove(s_tmp_name);
+        b_ret = false;
+    }
+
+    free(s_tmp_name);
+
+    return b_ret;
+}
+
+struct _db_tag_match
+{
+    struct db *pst_db;
+    const struct db_tag *pst_tag;
+    const uint8_t *pu8_key;
+    uint8_t *pu8_buf;
+    /* key as given to db_record_find and db_index_find, a hit must also
+     * match it as by a scan; NULL for the tag order of db_tag_seek */
+    const uint8_t *pu8_field_key;
+    uint32_t u32_field_key_len;
+    uint32_t u32_start_idx;
+    uint32_t u32_rec_id;
+    uint32_t *pu32_rec_id;
+    uint32_t u32_max;
+    uint32_t u32_num;
+    bool b_all;
+
+    /* every hit of a lookup of all records, sorted once the walk ends */
+    uint32_t *pu32_hit;
+    uint32_t u32_hit_cap;
+    bool b_fail;
+    bool b_stale; /* a key of the tag is not the key of its record */
+};
+
+/* a tag may be stale, a hit counts only if the record still holds the key */
+static bool _db_tag_hit_check(struct _db_tag_match *pst_match, uint32_t u32_rec_id)
+{
+    const struct db_tag *pst_tag = pst_match->pst_tag;
+    const struct db_field *pst_field = pst_match->pst_db->st_field_info.a_field[pst_tag->i16_field_idx];
+    uint8_t au8_key[256];
+    uint8_t *pu8_data;
+
+    if((u32_rec_id >= pst_match->pst_db->st_file_hdr.u32_rec_num) ||
+       (u32_rec_id >= pst_match->pst_db->u32_tag_rec_num))
+    {
+        pst_match->b_stale = true;
+        return false;
+    }
+
+    pu8_data = _db_rec_fetch(pst_match->pst_db, u32_rec_id, pst_match->pu8_buf);
+    if(NULL == pu8_data)
+        return false;
+
+    if((false == _db_tag_key_encode(pst_tag, &pu8_data[pst_field->u32_acc_len], pst_field->u8_len, au8_key)) ||
+       (0 != memcmp((void *)au8_key, (void *)pst_match->pu8_key, pst_tag->u16_key_len)))
+    {
+        pst_match->b_stale = true;
+        return false;
+    }
+
+    /* N/F tags hold the value, "1.0" and "1.00" match the same key */
+    return (NULL == pst_match->pu8_field_key) ||
+           (true == _db_key_match(pst_field, pu8_data, pst_match->pu8_field_key, pst_match->u32_field_key_len));
+}
+
+static bool _db_tag_match_visit(const uint8_t *pu8_key, uint32_t u32_rec_id, void *pv_usr_data)
+{
+    struct _db_tag_match *pst_match = (struct _db_tag_match *)pv_usr_data;
+
+    if(0 != memcmp((void *)pu8_key, (void *)pst_match->pu8_key, pst_match->pst_tag->u16_key_len))
+        return false;
+
+    if(true == pst_match->b_all)
+    {
+        if(false == _db_tag_hit_check(pst_match, u32_rec_id))
+            return true;
+
+        if(pst_match->u32_num == pst_match->u32_hit_cap)
+        {
+            uint32_t u32_cap = (pst_match->u32_hit_cap)?(2*pst_match->u32_hit_cap):(64);
+            uint32_t *pu32_hit = (uint32_t *)realloc(pst_match->pu32_hit, u32_cap*sizeof(uint32_t));
+
+            if(!pu32_hit)
+            {
+                pst_match->b_fail = true;
+                return false;
+            }
+
+            pst_match->pu32_hit = pu32_hit;
+            pst_match->u32_hit_cap = u32_cap;
+        }
+
+        pst_match->pu32_hit[pst_match->u32_num++] = u32_rec_id;
+    }
+    else if((u32_rec_id >= pst_match->u32_start_idx) && (u32_rec_id < pst_match->u32_rec_id) &&
+            (true == _db_tag_hit_check(pst_match, u32_rec_id)))
+    {
+        pst_match->u32_rec_id = u32_rec_id;
+    }
+
+    return true;
+}
+
+static int _db_cmp_rec_id(const void *pv_a, const void *pv_b)
+{
+    uint32_t u32_a = *(const uint32_t *)pv_a;
+    uint32_t u32_b = *(const uint32_t *)pv_b;
+
+    return (u32_a > u32_b) - (u32_a < u32_b);
+}
+
+/* lookup a key through a FoxPro tag, either the first record from
+ * u32_start_idx or, with b_all, every record with the lowest
+ * u32_max ids returned in id order; pu8_buf holds records read */
+static bool _db_tag_lookup(
+        struct db *pst_db,
+        uint16_t u16_tag_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len,
+        uint8_t *pu8_buf,
+        struct _db_tag_match *pst_match)
+{
+    struct db_tag *pst_tag = &pst_db->ast_tag[u16_tag_idx];
+    uint8_t au8_key[256];
+    bool b_ret;
+
+    if((pst_tag->u16_key_len > sizeof(au8_key)) || (pst_tag->i16_field_idx < 0) ||
+       (false == _db_tag_key_encode(pst_tag, pu8_key, u32_key_len, au8_key)))
+        return false;
+
+    pst_match->pst_db = pst_db;
+    pst_match->pst_tag = pst_tag;
+    pst_match->pu8_key = au8_key;
+    pst_match->pu8_buf = pu8_buf;
+    pst_match->u32_rec_id = DB_PAGE_NONE;
+    pst_match->u32_num = 0;
+    pst_match->b_stale = false;
+
+    b_ret = _db_tag_walk(pst_tag, au8_key, _db_tag_match_visit, pst_match) && !pst_match->b_fail;
+
+    if((true == b_ret) && (NULL != pst_match->pu32_rec_id))
+    {
+        qsort((void *)pst_match->pu32_hit, pst_match->u32_num, sizeof(uint32_t), _db_cmp_rec_id);
+        memcpy(
+            (void *)pst_match->pu32_rec_id,
+            (void *)pst_match->pu32_hit,
+            ((pst_match->u32_num < pst_match->u32_max)?(pst_match->u32_num):(pst_match->u32_max))*sizeof(uint32_t));
+    }
+
+    free(pst_match->pu32_hit);
+    pst_match->pu32_hit = NULL;
+
+    return b_ret;
+}
+
+uint32_t db_index_find_all(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len,
+        uint32_t *pu32_rec_id,
+        uint32_t u32_max)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_index *pst_index = NULL;
+    struct db_field *pst_field;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_hash;
+    uint32_t u32_rec_id = DB_PAGE_NONE;
+    uint32_t u32_num = 0;
+    uint8_t *pu8_data;
+
+    if(u32_field_idx >= pst_db->st_field_info.u8_field_num)
+        return 0;
+
+    if(!pst_db->pu8_find_buf)
+    {
+        pst_db->pu8_find_buf = (uint8_t *)malloc(u16_rec_len);
+        if(!pst_db->pu8_find_buf)
+            return 0;
+    }
+
+    if(pst_db->apst_index)
+        pst_index = pst_db->apst_index[u32_field_idx];
+
+    pst_field = pst_db->st_field_info.a_field[u32_field_idx];
+
+    if(NULL == pst_index)
+    {
+        int32_t i32_tag = _db_tag_for_field(pst_db, u32_field_idx);
+        struct _db_tag_match st_match = {
+            .pu8_field_key=pu8_key,.u32_field_key_len=u32_key_len,.pu32_rec_id=pu32_rec_id,.u32_max=u32_max,.b_all=true};
+        uint32_t u32_first_id = 0;
+
+        /* only records appended after the tags were read are scanned,
+         * unless the tag turns out to be stale */
+        if((i32_tag >= 0) &&
+           (true == _db_tag_lookup(pst_db, i32_tag, pu8_key, u32_key_len, pst_db->pu8_find_buf, &st_match)) &&
+           (false == st_match.b_stale))
+        {
+            u32_num = st_match.u32_num;
+            u32_first_id = pst_db->u32_tag_rec_num;
+        }
+
+        for(uint32_t idx=u32_first_id, u32_blk_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_blk_num)
+        {
+            pu8_data = _db_rec_acquire(pst_db, idx, &u32_blk_num);
+            if(NULL == pu8_data)
+                break;
+
+            for(uint32_t u32_off=0; u32_off<u32_blk_num; u32_off++, pu8_data+=u16_rec_len)
+            {
+                if(false == _db_key_match(pst_field, pu8_data, pu8_key, u32_key_len))
+                    continue;
+
+                if(u32_num < u32_max)
+                    pu32_rec_id[u32_num] = idx+u32_off;
+
+                u32_num++;
+            }
+
+            _db_rec_release(pst_db, idx);
+        }
+
+        return u32_num;
+    }
+
+    u32_hash = _db_hash(pu8_key, u32_key_len);
+
+    while(DB_PAGE_NONE != (u32_rec_id = _db_index_next(pst_index, u32_hash, u32_rec_id)))
+    {
+        pu8_data = _db_rec_fetch(pst_db, u32_rec_id, pst_db->pu8_find_buf);
+        if(NULL == pu8_data)
+            continue;
+
+        if(false == _db_key_match(pst_field, pu8_data, pu8_key, u32_key_len))
+            continue;
+
+        if(u32_num < u32_max)
+            pu32_rec_id[u32_num] = u32_rec_id;
+
+        u32_num++;
+    }
+
+    return u32_num;
+}
+
+/* first record from u32_start_idx whose trimmed field data equals the key */
+static struct db_record _db_record_find_key(
+        struct db *pst_db,
+        uint32_t u32_start_idx,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len,
+        uint8_t *pu8_buf)
+{
+    struct db_field *pst_field = pst_db->st_field_info.a_field[u32_field_idx];
+    struct db_index *pst_index = NULL;
+    uint16_t u16_data_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_scan_idx = u32_start_idx;
+    uint8_t *pu8_data;
+
+    if(pst_db->apst_index)
+        pst_index = pst_db->apst_index[u32_field_idx];
+
+    if(pst_index)
+    {
+        uint32_t u32_hash = _db_hash(pu8_key, u32_key_len);
+        uint32_t u32_rec_id = DB_PAGE_NONE;
+
+        while(DB_PAGE_NONE != (u32_rec_id = _db_index_next(pst_index, u32_hash, u32_rec_id)))
+        {
+            if(u32_rec_id < u32_start_idx)
+                continue;
+
+            pu8_data = _db_rec_fetch(pst_db, u32_rec_id, pu8_buf);
+            if((NULL != pu8_data) && (true == _db_key_match(pst_field, pu8_data, pu8_key, u32_key_len)))
+                return (struct db_record){.u32_rec_id=u32_rec_id,.u32_data_len=u16_data_len,.pu8_data=pu8_data};
+        }
+
+        return (struct db_record){0};
+    }
+    else
+    {
+        int32_t i32_tag = _db_tag_for_field(pst_db, u32_field_idx);
+        struct _db_tag_match st_match = {.pu8_field_key=pu8_key,.u32_field_key_len=u32_key_len,.u32_start_idx=u32_start_idx};
+
+        if((i32_tag >= 0) &&
+           (true == _db_tag_lookup(pst_db, i32_tag, pu8_key, u32_key_len, pu8_buf, &st_match)) &&
+           (false == st_match.b_stale))
+        {
+            if(DB_PAGE_NONE != st_match.u32_rec_id)
+            {
+                pu8_data = _db_rec_fetch(pst_db, st_match.u32_rec_id, pu8_buf);
+                if(NULL != pu8_data)
+                    return (struct db_record){.u32_rec_id=st_match.u32_rec_id,.u32_data_len=u16_data_len,.pu8_data=pu8_data};
+            }
+            else if(u32_scan_idx < pst_db->u32_tag_rec_num)
+            {
+                /* a tag miss still leaves the records appended since */
+                u32_scan_idx = pst_db->u32_tag_rec_num;
+            }
+        }
+    }
+
+    for(uint32_t idx=u32_scan_idx, u32_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_num)
+    {
+        bool b_pinned;
+
+        pu8_data = _db_rec_acquire_any(pst_db, idx, &u32_num, pu8_buf, &b_pinned);
+        if(NULL == pu8_data)
+            break;
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++, pu8_data+=u16_data_len)
+        {
+            if(false == _db_key_match(pst_field, pu8_data, pu8_key, u32_key_len))
+                continue;
+
+            if(true == b_pinned)
+            {
+                if(NULL == pst_db->pu8_rec_cache)
+                {
+                    _db_rec_read(pst_db, idx+u32_off, pu8_buf);
+                    pu8_data = pu8_buf;
+                }
+
+                _db_rec_release(pst_db, idx);
+            }
+
+            return (struct db_record){.u32_rec_id=idx+u32_off,.u32_data_len=u16_data_len,.pu8_data=pu8_data};
+        }
+
+        if(true == b_pinned)
+            _db_rec_release(pst_db, idx);
+    }
+
+    return (struct db_record){0};
+}
+
+struct db_record db_index_find(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if(u32_field_idx >= pst_db->st_field_info.u8_field_num)
+        return (struct db_record){0};
+
+    if(!pst_db->pu8_find_buf)
+    {
+        pst_db->pu8_find_buf = (uint8_t *)malloc(pst_db->st_file_hdr.u16_rec_len);
+        if(!pst_db->pu8_find_buf)
+            return (struct db_record){0};
+    }
+
+    return _db_record_find_key(pst_db, 0, u32_field_idx, pu8_key, u32_key_len, pst_db->pu8_find_buf);
+}
+
+/* state of db_join, the build side is the hashed one and the probe
+ * side is scanned */
+struct db_join
+{
+    struct db *pst_build;
+    struct db *pst_probe;
+    const struct db_field *pst_build_field;
+    const struct db_field *pst_probe_field;
+    const struct db_index *pst_index;
+    uint8_t u8_type;
+    bool b_left_build;
+
+    /* build side records with a match, DB_JOIN_LEFT with b_left_build only */
+    uint64_t *pu64_hit;
+
+    db_pf_join pf_join;
+    void *pv_usr_data;
+};
+
+/* pass the pairs of one probe record on, false when pf_join stops */
+static bool _db_join_probe(
+        struct db_join *pst_join,
+        const struct db_record *pst_probe,
+        uint8_t *pu8_build_buf)
+{
+    struct db_record st_build = {.u32_data_len=pst_join->pst_build->st_file_hdr.u16_rec_len};
+    const uint8_t *pu8_key;
+    uint32_t u32_key_len;
+    uint32_t u32_hash;
+    uint32_t u32_rec_id = DB_PAGE_NONE;
+    bool b_match = false;
+
+    pu8_key = _db_field_trim(pst_join->pst_probe_field, pst_probe->pu8_data+pst_join->pst_probe_field->u32_acc_len, &u32_key_len);
+    u32_hash = _db_hash(pu8_key, u32_key_len);
+
+    while(DB_PAGE_NONE != (u32_rec_id = _db_index_next(pst_join->pst_index, u32_hash, u32_rec_id)))
+    {
+        bool b_next;
+
+        st_build.pu8_data = _db_rec_fetch(pst_join->pst_build, u32_rec_id, pu8_build_buf);
+        if((NULL == st_build.pu8_data) || (false == _db_key_match(pst_join->pst_build_field, st_build.pu8_data, pu8_key, u32_key_len)))
+            continue;
+
+        st_build.u32_rec_id = u32_rec_id;
+        b_match = true;
+
+        if(NULL != pst_join->pu64_hit)
+            pst_join->pu64_hit[u32_rec_id/64] |= (uint64_t)1<<(u32_rec_id%64);
+
+        if(true == pst_join->b_left_build)
+            b_next = pst_join->pf_join(&st_build, pst_probe, pst_join->pv_usr_data);
+        else
+            b_next = pst_join->pf_join(pst_probe, &st_build, pst_join->pv_usr_data);
+
+        if(false == b_next)
+            return false;
+    }
+
+    if((DB_JOIN_LEFT == pst_join->u8_type) && (false == pst_join->b_left_build) && (false == b_match))
+        return pst_join->pf_join(pst_probe, NULL, pst_join->pv_usr_data);
+
+    return true;
+}
+
+bool db_join(
+        hdb h_left,
+        uint32_t u32_left_field,
+        hdb h_right,
+        uint32_t u32_right_field,
+        uint8_t u8_type,
+        db_pf_join pf_join,
+        void *pv_usr_data)
+{
+    struct db *pst_left = (struct db *)h_left;
+    struct db *pst_right = (struct db *)h_right;
+    struct db_join st_join = {.u8_type=u8_type,.pf_join=pf_join,.pv_usr_data=pv_usr_data};
+    struct db_record st_probe;
+    uint32_t u32_build_field;
+    uint8_t *pu8_probe_buf;
+    uint8_t *pu8_build_buf;
+    bool b_ret = true;
+
+    if((NULL == pst_left) || (NULL == pst_right) || (NULL == pf_join) ||
+       ((DB_JOIN_INNER != u8_type) && (DB_JOIN_LEFT != u8_type)) ||
+       (u32_left_field >= pst_left->st_field_info.u8_field_num) ||
+       (u32_right_field >= pst_right->st_field_info.u8_field_num))
+        return false;
+
+    /* hash an indexed side, otherwise the smaller one */
+    if((NULL != pst_right->apst_index) && (NULL != pst_right->apst_index[u32_right_field]))
+        st_join.b_left_build = false;
+    else if((NULL != pst_left->apst_index) && (NULL != pst_left->apst_index[u32_left_field]))
+        st_join.b_left_build = true;
+    else
+        st_join.b_left_build = (pst_left->st_file_hdr.u32_rec_num < pst_right->st_file_hdr.u32_rec_num);
+
+    st_join.pst_build = (true == st_join.b_left_build)?(pst_left):(pst_right);
+    st_join.pst_probe = (true == st_join.b_left_build)?(pst_right):(pst_left);
+    u32_build_field = (true == st_join.b_left_build)?(u32_left_field):(u32_right_field);
+    st_join.pst_build_field = st_join.pst_build->st_field_info.a_field[u32_build_field];
+    st_join.pst_probe_field = st_join.pst_probe->st_field_info.a_field[(true == st_join.b_left_build)?(u32_right_field):(u32_left_field)];
+
+    if(false == db_index_build((hdb)st_join.pst_build, u32_build_field))
+        return false;
+
+    st_join.pst_index = st_join.pst_build->apst_index[u32_build_field];
+
+    pu8_probe_buf = (uint8_t *)malloc(st_join.pst_probe->st_file_hdr.u16_rec_len);
+    pu8_build_buf = (uint8_t *)malloc(st_join.pst_build->st_file_hdr.u16_rec_len);
+
+    if((DB_JOIN_LEFT == u8_type) && (true == st_join.b_left_build))
+        st_join.pu64_hit = (uint64_t *)calloc(st_join.pst_build->st_file_hdr.u32_rec_num/64+1, sizeof(uint64_t));
+
+    do
+    {
+        if(!pu8_probe_buf || !pu8_build_buf || ((DB_JOIN_LEFT == u8_type) && (true == st_join.b_left_build) && !st_join.pu64_hit))
+        {
+            b_ret = false;
+            break;
+        }
+
+        st_probe.u32_data_len = st_join.pst_probe->st_file_hdr.u16_rec_len;
+
+        for(uint32_t idx=0, u32_num=0; (true == b_ret) && (idx<st_join.pst_probe->st_file_hdr.u32_rec_num); idx+=u32_num)
+        {
+            bool b_pinned;
+            uint8_t *pu8_data = _db_rec_acquire_any(st_join.pst_probe, idx, &u32_num, pu8_probe_buf, &b_pinned);
+
+            if(NULL == pu8_data)
+            {
+                b_ret = false;
+                break;
+            }
+
+            for(uint32_t u32_off=0; u32_off<u32_num; u32_off++)
+            {
+                st_probe.pu8_data = &pu8_data[u32_off*st_probe.u32_data_len];
+                st_probe.u32_rec_id = idx+u32_off;
+
+                if(false == _db_join_probe(&st_join, &st_probe, pu8_build_buf))
+                {
+                    b_ret = false;
+                    break;
+                }
+            }
+
+            if(true == b_pinned)
+                _db_rec_release(st_join.pst_probe, idx);
+        }
+
+        if((false == b_ret) || (NULL == st_join.pu64_hit))
+            break;
+
+        /* left records never matched by the right side */
+        for(uint32_t idx=0; idx<pst_left->st_file_hdr.u32_rec_num; idx++)
+        {
+            struct db_record st_left = {.u32_rec_id=idx,.u32_data_len=pst_left->st_file_hdr.u16_rec_len};
+
+            if(st_join.pu64_hit[idx/64] & ((uint64_t)1<<(idx%64)))
+                continue;
+
+            st_left.pu8_data = _db_rec_fetch(pst_left, idx, pu8_build_buf);
+            if((NULL == st_left.pu8_data) || (false == pf_join(&st_left, NULL, pv_usr_data)))
+            {
+                b_ret = false;
+                break;
+            }
+        }
+    }while(0);
+
+    free(st_join.pu64_hit);
+    free(pu8_build_buf);
+    free(pu8_probe_buf);
+
+    return b_ret;
+}
+
+struct db_record db_record_find(
+        hdb h_db,
+        uint32_t u32_start_idx,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_cmp_data,
+        db_pf_cmp pf_cmp,
+        void *pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_var st_id;
+    uint16_t u16_data_len;
+    uint8_t *pu8_data;
+    bool b_equal;
+
+    u16_data_len = pst_db->st_file_hdr.u16_rec_len;
+
+    if(!pst_db->pu8_find_buf)
+    {
+        pst_db->pu8_find_buf = (uint8_t *)malloc(u16_data_len);
+    }
+
+    if(NULL == pf_cmp)
+    {
+        uint32_t u32_key_len;
+
+        if((u32_field_idx >= pst_db->st_field_info.u8_field_num) || (NULL == pu8_cmp_data))
+            return (struct db_record){0};
+
+        /* trailing spaces of the key are padding as in the field */
+        u32_key_len = strlen((char *)pu8_cmp_data);
+        while((u32_key_len > 0) && (' ' == pu8_cmp_data[u32_key_len-1]))
+            u32_key_len--;
+
+        return _db_record_find_key(pst_db, u32_start_idx, u32_field_idx, pu8_cmp_data, u32_key_len, pst_db->pu8_find_buf);
+    }
+
+    for(uint32_t idx=u32_start_idx, u32_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_num)
+    {
+        pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+        if(NULL == pu8_data)
+            break;
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++, pu8_data+=u16_data_len)
+        {
+            st_id = db_field_map_data(
+                    h_db,
+                    pu8_data,
+                    u32_field_idx);
+
+            b_equal = pf_cmp(h_db, st_id.pv_data, pu8_cmp_data, pv_usr_data);
+
+            db_field_unmap_data(h_db, &st_id);
+
+            if(true == b_equal)
+            {
+                /* a cache block may be evicted once released, keep a copy */
+                if(NULL == pst_db->pu8_rec_cache)
+                {
+                    _db_rec_read(pst_db, idx+u32_off, pst_db->pu8_find_buf);
+                    pu8_data = pst_db->pu8_find_buf;
+                }
+
+                _db_rec_release(pst_db, idx);
+
+                return (struct db_record){.u32_rec_id=idx+u32_off,.u32_data_len=u16_data_len,.pu8_data=pu8_data};
+            }
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    return (struct db_record){0};
+}
+
+uint16_t db_tag_get_num(hdb h_db)
+{
+    return ((struct db *)h_db)->u16_tag_num;
+}
+
+bool db_tag_get_info(hdb h_db, uint16_t u16_tag_idx, struct db_tag_info *pst_info)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_tag *pst_tag;
+
+    if((u16_tag_idx >= pst_db->u16_tag_num) || (NULL == pst_info))
+        return false;
+
+    pst_tag = &pst_db->ast_tag[u16_tag_idx];
+
+    memcpy((void *)pst_info->s_name, (void *)pst_tag->s_name, sizeof(pst_info->s_name));
+    pst_info->s_expr = pst_tag->s_expr;
+    pst_info->s_for = pst_tag->s_for;
+    pst_info->u16_key_len = pst_tag->u16_key_len;
+    pst_info->b_unique = (pst_tag->u8_option & 0x01)?(true):(false);
+    pst_info->b_desc = pst_tag->b_desc;
+    pst_info->i16_field_idx = pst_tag->i16_field_idx;
+
+    return true;
+}
+
+int16_t db_tag_get_idx(hdb h_db, const char *s_name)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    for(int idx=0; idx<pst_db->u16_tag_num; idx++)
+    {
+        if(0 == strcasecmp(s_name, pst_db->ast_tag[idx].s_name))
+            return idx;
+    }
+
+    return -1;
+}
+
+bool db_tag_attach(hdb h_db, const char *s_file_name)
+{
+    if((INVALID_DB_HANDLE == h_db) || (NULL == s_file_name))
+        return false;
+
+    return _db_ixf_open((struct db *)h_db, s_file_name);
+}
+
+struct db_record db_tag_seek(
+        hdb h_db,
+        uint16_t u16_tag_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct _db_tag_match st_match = {0};
+    uint8_t *pu8_data;
+
+    if((u16_tag_idx >= pst_db->u16_tag_num) || (NULL == pu8_key))
+        return (struct db_record){0};
+
+    if(!pst_db->pu8_find_buf)
+    {
+        pst_db->pu8_find_buf = (uint8_t *)malloc(pst_db->st_file_hdr.u16_rec_len);
+        if(!pst_db->pu8_find_buf)
+            return (struct db_record){0};
+    }
+
+    if((false == _db_tag_lookup(pst_db, u16_tag_idx, pu8_key, u32_key_len, pst_db->pu8_find_buf, &st_match)) ||
+       (DB_PAGE_NONE == st_match.u32_rec_id))
+        return (struct db_record){0};
+
+    pu8_data = _db_rec_fetch(pst_db, st_match.u32_rec_id, pst_db->pu8_find_buf);
+    if(NULL == pu8_data)
+        return (struct db_record){0};
+
+    return (struct db_record){.u32_rec_id=st_match.u32_rec_id,.u32_data_len=pst_db->st_file_hdr.u16_rec_len,.pu8_data=pu8_data};
+}
+
+struct _db_tag_range
+{
+    struct db *pst_db;
+    const uint8_t *pu8_hi;
+    uint16_t u16_key_len;
+    uint8_t *pu8_buf;
+
+    db_pf_itor pf_itor;
+    void *pv_usr_data;
+    bool b_ret;
+};
+
+static bool _db_tag_range_visit(const uint8_t *pu8_key, uint32_t u32_rec_id, void *pv_usr_data)
+{
+    struct _db_tag_range *pst_range = (struct _db_tag_range *)pv_usr_data;
+    struct db_record st_record;
+
+    if((NULL != pst_range->pu8_hi) && (memcmp((void *)pu8_key, (void *)pst_range->pu8_hi, pst_range->u16_key_len) > 0))
+        return false;
+
+    st_record.u32_rec_id = u32_rec_id;
+    st_record.u32_data_len = pst_range->pst_db->st_file_hdr.u16_rec_len;
+    st_record.pu8_data = _db_rec_fetch(pst_range->pst_db, u32_rec_id, pst_range->pu8_buf);
+
+    if(NULL == st_record.pu8_data)
+        return true;
+
+    if(false == pst_range->pf_itor((hdb)pst_range->pst_db, &st_record, pst_range->pv_usr_data))
+    {
+        pst_range->b_ret = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool db_tag_range(
+        hdb h_db,
+        uint16_t u16_tag_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len,
+        db_pf_itor pf_itor,
+        void *pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct _db_tag_range st_range = {0};
+    struct db_tag *pst_tag;
+    uint8_t au8_lo[256];
+    uint8_t au8_hi[256];
+    bool b_ret;
+
+    if((u16_tag_idx >= pst_db->u16_tag_num) || (NULL == pf_itor))
+        return false;
+
+    pst_tag = &pst_db->ast_tag[u16_tag_idx];
+    if((pst_tag->u16_key_len > sizeof(au8_lo)) || (true == pst_tag->b_desc))
+        return false;
+
+    if((NULL != pu8_lo) && (false == _db_tag_key_encode(pst_tag, pu8_lo, u32_lo_len, au8_lo)))
+        return false;
+
+    if((NULL != pu8_hi) && (false == _db_tag_key_encode(pst_tag, pu8_hi, u32_hi_len, au8_hi)))
+        return false;
+
+    st_range.pst_db = pst_db;
+    st_range.pu8_hi = (pu8_hi)?(au8_hi):(NULL);
+    st_range.u16_key_len = pst_tag->u16_key_len;
+    st_range.pf_itor = pf_itor;
+    st_range.pv_usr_data = pv_usr_data;
+    st_range.b_ret = true;
+
+    /* records handed to the callback outlive nested finds */
+    st_range.pu8_buf = (uint8_t *)malloc(pst_db->st_file_hdr.u16_rec_len);
+    if(!st_range.pu8_buf)
+        return false;
+
+    b_ret = _db_tag_walk(pst_tag, (pu8_lo)?(au8_lo):(NULL), _db_tag_range_visit, &st_range);
+
+    free(st_range.pu8_buf);
+
+    return b_ret && st_range.b_ret;
+}
+
+#define DB_MS_PER_DAY (86400000ll)
+
+/* order key of D and T fields in milliseconds since julian day 0,
+ * false for blank data */
+static bool _db_order_key(const struct db_field *pst_field, const uint8_t *pu8_data, int64_t *pi64_key)
+{
+    pu8_data += pst_field->u32_acc_len;
+
+    if('D' == toupper(pst_field->u8_type))
+    {
+        for(int idx=0; idx<8; idx++)
+        {
+            if(!isdigit(pu8_data[idx]))
+                return false;
+        }
+
+        *pi64_key = DB_MS_PER_DAY*_db_date_to_JD(
+                (pu8_data[0]-'0')*1000+(pu8_data[1]-'0')*100+(pu8_data[2]-'0')*10+(pu8_data[3]-'0'),
+                (pu8_data[4]-'0')*10+(pu8_data[5]-'0'),
+                (pu8_data[6]-'0')*10+(pu8_data[7]-'0'));
+        return true;
+    }
+
+    if(true == _db_time_is_blank(pu8_data))
+        return false;
+
+    *pi64_key = DB_MS_PER_DAY*_db_get_le32(pu8_data)+_db_get_le32(&pu8_data[4]);
+    return true;
+}
+
+/* parse a bound given as YYYYMMDD[hhmmss[mmm]], separators are
+ * skipped so "YYYY/MM/DD hh:mm:ss" works too; a missing time is the
+ * start of the day for a lower bound and its end for an upper bound.
+ * More digits or a date or time out of range are refused. */
+static bool _db_order_bound(const uint8_t *pu8_data, uint32_t u32_len, bool b_upper, int64_t *pi64_key)
+{
+    uint8_t au8_digit[17];
+    uint32_t u32_num = 0;
+    int64_t i64_ms = 0;
+    uint16_t u16_year;
+    uint8_t u8_month;
+    uint8_t u8_day;
+
+    for(uint32_t idx=0; idx<u32_len; idx++)
+    {
+        if(!isdigit(pu8_data[idx]))
+            continue;
+
+        if(u32_num == sizeof(au8_digit))
+            return false;
+
+        au8_digit[u32_num++] = pu8_data[idx]-'0';
+    }
+
+    if((u32_num != 8) && (u32_num != 14) && (u32_num != 17))
+        return false;
+
+    u16_year = au8_digit[0]*1000+au8_digit[1]*100+au8_digit[2]*10+au8_digit[3];
+    u8_month = au8_digit[4]*10+au8_digit[5];
+    u8_day = au8_digit[6]*10+au8_digit[7];
+
+    if(false == _db_date_valid(u16_year, u8_month, u8_day))
+        return false;
+
+    *pi64_key = DB_MS_PER_DAY*_db_date_to_JD(u16_year, u8_month, u8_day);
+
+    if(8 == u32_num)
+    {
+        *pi64_key += (b_upper)?(DB_MS_PER_DAY-1):(0);
+        return true;
+    }
+
+    if((au8_digit[8]*10+au8_digit[9] > 23) || (au8_digit[10] > 5) || (au8_digit[12] > 5))
+        return false;
+
+    i64_ms = ((au8_digit[8]*10+au8_digit[9])*3600+(au8_digit[10]*10+au8_digit[11])*60+au8_digit[12]*10+au8_digit[13])*1000ll;
+
+    if(17 == u32_num)
+        i64_ms += au8_digit[14]*100+au8_digit[15]*10+au8_digit[16];
+    else if(true == b_upper)
+        i64_ms += 999;
+
+    *pi64_key += i64_ms;
+    return true;
+}
+
+struct _db_order_ent
+{
+    int64_t i64_key;
+    uint32_t u32_rec_id;
+};
+
+static int _db_cmp_order_ent(const void *pv_a, const void *pv_b)
+{
+    const struct _db_order_ent *pst_a = (const struct _db_order_ent *)pv_a;
+    const struct _db_order_ent *pst_b = (const struct _db_order_ent *)pv_b;
+
+    if(pst_a->i64_key != pst_b->i64_key)
+        return (pst_a->i64_key > pst_b->i64_key)?(1):(-1);
+
+    return (pst_a->u32_rec_id > pst_b->u32_rec_id) - (pst_a->u32_rec_id < pst_b->u32_rec_id);
+}
+
+bool db_order_build(hdb h_db, uint32_t u32_field_idx)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    struct _db_order_ent *ast_ent;
+    struct db_order *pst_order;
+    struct db_field *pst_field;
+    uint32_t u32_num = 0;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return false;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    if(('D' != toupper(pst_field->u8_type)) && ('T' != toupper(pst_field->u8_type)))
+        return false;
+
+    if(NULL == pst_db->apst_order)
+    {
+        pst_db->apst_order = (struct db_order **)calloc(pst_info->u8_field_num, sizeof(struct db_order *));
+        if(!pst_db->apst_order)
+            return false;
+    }
+
+    if(NULL != pst_db->apst_order[u32_field_idx])
+        return true;
+
+    ast_ent = (struct _db_order_ent *)malloc((u32_rec_num+1)*sizeof(struct _db_order_ent));
+    pst_order = (struct db_order *)calloc(1, sizeof(struct db_order));
+
+    if(!ast_ent || !pst_order)
+    {
+        free(ast_ent);
+        free(pst_order);
+        return false;
+    }
+
+    /* collect the keys of every record, blank ones are left out */
+    for(uint32_t idx=0, u32_blk_num=0; idx<u32_rec_num; idx+=u32_blk_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_blk_num);
+
+        if(NULL == pu8_data)
+            break;
+
+        for(uint32_t u32_off=0; u32_off<u32_blk_num; u32_off++, pu8_data+=u16_rec_len)
+        {
+            if(true == _db_order_key(pst_field, pu8_data, &ast_ent[u32_num].i64_key))
+                ast_ent[u32_num++].u32_rec_id = idx+u32_off;
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    qsort((void *)ast_ent, u32_num, sizeof(struct _db_order_ent), _db_cmp_order_ent);
+
+    pst_order->u32_field_idx = u32_field_idx;
+    pst_order->u32_num = u32_num;
+    pst_order->pi64_key = (int64_t *)malloc((u32_num+1)*sizeof(int64_t));
+    pst_order->pu32_rec_id = (uint32_t *)malloc((u32_num+1)*sizeof(uint32_t));
+
+    if(!pst_order->pi64_key || !pst_order->pu32_rec_id)
+    {
+        free(ast_ent);
+        _db_order_free(pst_order);
+        return false;
+    }
+
+    for(uint32_t idx=0; idx<u32_num; idx++)
+    {
+        pst_order->pi64_key[idx] = ast_ent[idx].i64_key;
+        pst_order->pu32_rec_id[idx] = ast_ent[idx].u32_rec_id;
+    }
+
+    free(ast_ent);
+
+    pst_db->apst_order[u32_field_idx] = pst_order;
+    pst_db->b_index_dirty = true;
+
+    return true;
+}
+
+bool db_order_drop(hdb h_db, uint32_t u32_field_idx)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if((u32_field_idx >= pst_db->st_field_info.u8_field_num) || (NULL == pst_db->apst_order))
+        return false;
+
+    if(pst_db->apst_order[u32_field_idx])
+        pst_db->b_index_dirty = true;
+
+    _db_order_free(pst_db->apst_order[u32_field_idx]);
+    pst_db->apst_order[u32_field_idx] = NULL;
+
+    return true;
+}
+
+/* first position whose key is not less (b_upper: greater) than i64_key */
+static uint32_t _db_order_search(const struct db_order *pst_order, int64_t i64_key, bool b_upper)
+{
+    uint32_t u32_lo = 0;
+    uint32_t u32_hi = pst_order->u32_num;
+
+    while(u32_lo < u32_hi)
+    {
+        uint32_t u32_mid = u32_lo+(u32_hi-u32_lo)/2;
+        int64_t i64_mid = pst_order->pi64_key[u32_mid];
+
+        if((i64_mid < i64_key) || ((true == b_upper) && (i64_mid == i64_key)))
+            u32_lo = u32_mid+1;
+        else
+            u32_hi = u32_mid;
+    }
+
+    return u32_lo;
+}
+
+uint32_t db_order_slice(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len,
+        const uint32_t **ppu32_rec_id)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_order *pst_order;
+    uint32_t u32_first = 0;
+    uint32_t u32_last;
+    int64_t i64_key;
+
+    if((u32_field_idx >= pst_db->st_field_info.u8_field_num) || (NULL == pst_db->apst_order))
+        return 0;
+
+    pst_order = pst_db->apst_order[u32_field_idx];
+    if(NULL == pst_order)
+        return 0;
+
+    u32_last = pst_order->u32_num;
+
+    if(NULL != pu8_lo)
+    {
+        if(false == _db_order_bound(pu8_lo, u32_lo_len, false, &i64_key))
+            return 0;
+
+        u32_first = _db_order_search(pst_order, i64_key, false);
+    }
+
+    if(NULL != pu8_hi)
+    {
+        if(false == _db_order_bound(pu8_hi, u32_hi_len, true, &i64_key))
+            return 0;
+
+        u32_last = _db_order_search(pst_order, i64_key, true);
+    }
+
+    if(u32_last <= u32_first)
+        return 0;
+
+    if(ppu32_rec_id)
+        *ppu32_rec_id = &pst_order->pu32_rec_id[u32_first];
+
+    return u32_last-u32_first;
+}
+
+bool db_order_range(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len,
+        db_pf_itor pf_itor,
+        void *pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_record st_record;
+    const uint32_t *pu32_rec_id = NULL;
+    uint32_t u32_num;
+    uint8_t *pu8_buf;
+    bool b_ret = true;
+
+    if((NULL == pf_itor) || (NULL == pst_db->apst_order) ||
+       (u32_field_idx >= pst_db->st_field_info.u8_field_num) ||
+       (NULL == pst_db->apst_order[u32_field_idx]))
+        return false;
+
+    u32_num = db_order_slice(h_db, u32_field_idx, pu8_lo, u32_lo_len, pu8_hi, u32_hi_len, &pu32_rec_id);
+    if(0 == u32_num)
+        return true;
+
+    /* records handed to the callback outlive nested finds */
+    pu8_buf = (uint8_t *)malloc(pst_db->st_file_hdr.u16_rec_len);
+    if(!pu8_buf)
+        return false;
+
+    st_record.u32_data_len = pst_db->st_file_hdr.u16_rec_len;
+
+    for(uint32_t idx=0; idx<u32_num; idx++)
+    {
+        st_record.u32_rec_id = pu32_rec_id[idx];
+        st_record.pu8_data = _db_rec_fetch(pst_db, st_record.u32_rec_id, pu8_buf);
+
+        if(NULL == st_record.pu8_data)
+            continue;
+
+        if(false == pf_itor(h_db, &st_record, pv_usr_data))
+        {
+            b_ret = false;
+            break;
+        }
+    }
+
+    free(pu8_buf);
+
+    return b_ret;
+}
+
+/* follow a grown table, resident blocks are kept except the old last
+ * one which may have been read short */
+static bool _db_page_cache_grow(struct db *pst_db, uint32_t u32_rec_num)
+{
+    struct db_page_cache *pst_cache = pst_db->pst_page_cache;
+    uint32_t u32_blk_len = pst_cache->u32_blk_rec_num*pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_blk_num = ((uint64_t)u32_rec_num+pst_cache->u32_blk_rec_num-1)/pst_cache->u32_blk_rec_num;
+    uint32_t u32_page_num;
+    uint32_t *pu32_blk_map;
+
+    _db_page_drain(pst_db);
+
+    for(uint32_t idx=0; idx<pst_cache->u32_page_num; idx++)
+    {
+        if(pst_cache->ast_page[idx].u16_pin)
+            return false;
+    }
+
+    if(pst_cache->u32_blk_num > 0)
+    {
+        uint32_t u32_last_blk = pst_cache->u32_blk_num-1;
+        uint32_t u32_page_idx = pst_cache->pu32_blk_map[u32_last_blk];
+
+        if(DB_PAGE_NONE != u32_page_idx)
+        {
+            pst_cache->ast_page[u32_page_idx].u32_blk_idx = DB_PAGE_NONE;
+            pst_cache->ast_page[u32_page_idx].u32_rec_num = 0;
+            pst_cache->pu32_blk_map[u32_last_blk] = DB_PAGE_NONE;
+        }
+    }
+
+    if(u32_blk_num <= pst_cache->u32_blk_num)
+        return true;
+
+    pu32_blk_map = (uint32_t *)realloc(pst_cache->pu32_blk_map, u32_blk_num*sizeof(uint32_t));
+    if(!pu32_blk_map)
+        return false;
+
+    memset((void *)&pu32_blk_map[pst_cache->u32_blk_num], 0xff, (u32_blk_num-pst_cache->u32_blk_num)*sizeof(uint32_t));
+    pst_cache->pu32_blk_map = pu32_blk_map;
+
+    /* lazy access needs a page for every block, paged up to its budget */
+    u32_page_num = u32_blk_num;
+    if((DB_ACCESS_LAZY != pst_db->u8_access) && (u32_page_num > pst_cache->u32_page_max))
+        u32_page_num = pst_cache->u32_page_max;
+
+    if(u32_page_num > pst_cache->u32_page_num)
+    {
+        struct db_page *ast_page;
+        uint8_t *pu8_data;
+
+        ast_page = (struct db_page *)realloc(pst_cache->ast_page, u32_page_num*sizeof(struct db_page));
+        if(!ast_page)
+            return false;
+
+        pst_cache->ast_page = ast_page;
+
+        if(NULL != pst_cache->pu8_data)
+        {
+            pu8_data = (uint8_t *)realloc(pst_cache->pu8_data, (size_t)u32_page_num*u32_blk_len);
+            if(!pu8_data)
+                return false;
+
+            pst_cache->pu8_data = pu8_data;
+        }
+
+        for(uint32_t idx=0; idx<u32_page_num; idx++)
+        {
+            if(idx >= pst_cache->u32_page_num)
+            {
+                memset((void *)&ast_page[idx], 0, sizeof(struct db_page));
+                ast_page[idx].u32_blk_idx = DB_PAGE_NONE;
+                ast_page[idx].i8_aio_slot = -1;
+            }
+
+            if(NULL != pst_cache->pu8_data)
+                ast_page[idx].pu8_data = &pst_cache->pu8_data[(size_t)idx*u32_blk_len];
+        }
+
+        pst_cache->u32_page_num = u32_page_num;
+    }
+
+    if(pst_cache->u8_read_ahead >= pst_cache->u32_page_num)
+        pst_cache->u8_read_ahead = (pst_cache->u32_page_num > 1)?(pst_cache->u32_page_num-1):(0);
+
+    pst_cache->u32_blk_num = u32_blk_num;
+
+    return true;
+}
+
+/* make records up to u32_rec_num readable in the current access mode */
+static bool _db_rec_cache_grow(struct db *pst_db, uint32_t u32_rec_num)
+{
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    uint32_t u32_old_num = pst_hdr->u32_rec_num;
+
+    if(NULL != pst_db->pu8_map)
+    {
+        uint8_t *pu8_old_map = pst_db->pu8_map;
+        size_t t_old_len = pst_db->t_map_len;
+
+        /* map the grown file before letting go of the old mapping */
+        pst_hdr->u32_rec_num = u32_rec_num;
+        if(false == _db_rec_map_init(pst_db))
+        {
+            pst_hdr->u32_rec_num = u32_old_num;
+            return false;
+        }
+
+        munmap((void *)pu8_old_map, t_old_len);
+        return true;
+    }
+
+    if(NULL != pst_db->pu8_rec_cache)
+    {
+        size_t t_old_len = (size_t)u32_old_num*pst_hdr->u16_rec_len;
+        size_t t_new_len = (size_t)u32_rec_num*pst_hdr->u16_rec_len;
+        uint8_t *pu8_cache = (uint8_t *)realloc(pst_db->pu8_rec_cache, t_new_len);
+        ssize_t t_read;
+
+        if(!pu8_cache)
+            return false;
+
+        pst_db->pu8_rec_cache = pu8_cache;
+
+        t_read = pread(
+                fileno(pst_db->pf_db),
+                (void *)&pu8_cache[t_old_len],
+                t_new_len-t_old_len,
+                pst_hdr->u16_hdr_len+(off_t)t_old_len);
+
+        if(t_read < 0)
+            t_read = 0;
+
+        pst_hdr->u32_rec_num = u32_old_num+t_read/pst_hdr->u16_rec_len;
+        return true;
+    }
+
+    if(NULL == pst_db->pst_page_cache)
+        return false;
+
+    if(false == _db_page_cache_grow(pst_db, u32_rec_num))
+        return false;
+
+    pst_hdr->u32_rec_num = u32_rec_num;
+    return true;
+}
+
+/* hash the records appended after the index was built and link them at
+ * the end of their buckets */
+static bool _db_index_extend(struct db *pst_db, struct db_index *pst_index)
+{
+    struct db_field *pst_field = pst_db->st_field_info.a_field[pst_index->u32_field_idx];
+    uint32_t u32_old_num = pst_index->u32_rec_num;
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_bucket_num = pst_index->u32_bucket_mask+1;
+    uint32_t *pu32_next;
+    uint32_t *pu32_hash;
+
+    /* arrays of an attached sidecar index are read-only, copy them */
+    if(true == pst_index->b_mapped)
+    {
+        uint32_t *pu32_bucket = (uint32_t *)malloc(u32_bucket_num*sizeof(uint32_t));
+
+        pu32_next = (uint32_t *)malloc((u32_old_num+1)*sizeof(uint32_t));
+        pu32_hash = (uint32_t *)malloc((u32_old_num+1)*sizeof(uint32_t));
+
+        if(!pu32_bucket || !pu32_next || !pu32_hash)
+        {
+            free(pu32_bucket);
+            free(pu32_next);
+            free(pu32_hash);
+            return false;
+        }
+
+        memcpy((void *)pu32_bucket, (void *)pst_index->pu32_bucket, u32_bucket_num*sizeof(uint32_t));
+        memcpy((void *)pu32_next, (void *)pst_index->pu32_next, u32_old_num*sizeof(uint32_t));
+        memcpy((void *)pu32_hash, (void *)pst_index->pu32_hash, u32_old_num*sizeof(uint32_t));
+
+        pst_index->pu32_bucket = pu32_bucket;
+        pst_index->pu32_next = pu32_next;
+        pst_index->pu32_hash = pu32_hash;
+        pst_index->b_mapped = false;
+    }
+
+    pu32_next = (uint32_t *)realloc(pst_index->pu32_next, (u32_rec_num+1)*sizeof(uint32_t));
+    if(!pu32_next)
+        return false;
+
+    pst_index->pu32_next = pu32_next;
+
+    pu32_hash = (uint32_t *)realloc(pst_index->pu32_hash, (u32_rec_num+1)*sizeof(uint32_t));
+    if(!pu32_hash)
+        return false;
+
+    pst_index->pu32_hash = pu32_hash;
+
+    for(uint32_t idx=u32_old_num, u32_num=0; idx<u32_rec_num; idx+=u32_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+
+        if(NULL == pu8_data)
+            return false;
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++, pu8_data+=u16_rec_len)
+        {
+            const uint8_t *pu8_key;
+            uint32_t u32_key_len;
+
+            pu8_key = _db_field_trim(pst_field, pu8_data+pst_field->u32_acc_len, &u32_key_len);
+            pu32_hash[idx+u32_off] = _db_hash(pu8_key, u32_key_len);
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    if(u32_bucket_num < 2*u32_rec_num)
+    {
+        uint32_t *pu32_bucket;
+
+        /* load factor above one half, rehash from the stored hashes */
+        while(u32_bucket_num < 2*u32_rec_num)
+            u32_bucket_num <<= 1;
+
+        pu32_bucket = (uint32_t *)calloc(u32_bucket_num, sizeof(uint32_t));
+        if(!pu32_bucket)
+            return false;
+
+        free(pst_index->pu32_bucket);
+        free(pst_index->pu32_tail);
+        pst_index->pu32_bucket = pu32_bucket;
+        pst_index->pu32_tail = NULL;
+        pst_index->u32_bucket_mask = u32_bucket_num-1;
+
+        for(uint32_t idx=u32_rec_num; idx>0; idx--)
+        {
+            uint32_t u32_bucket = pu32_hash[idx-1]&pst_index->u32_bucket_mask;
+
+            pu32_next[idx-1] = pu32_bucket[u32_bucket];
+            pu32_bucket[u32_bucket] = idx;
+        }
+    }
+    else
+    {
+        if(NULL == pst_index->pu32_tail)
+        {
+            pst_index->pu32_tail = (uint32_t *)calloc(u32_bucket_num, sizeof(uint32_t));
+            if(!pst_index->pu32_tail)
+                return false;
+
+            for(uint32_t idx=0; idx<u32_old_num; idx++)
+                pst_index->pu32_tail[pu32_hash[idx]&pst_index->u32_bucket_mask] = idx+1;
+        }
+
+        /* appended ids are the largest, chains stay ascending */
+        for(uint32_t idx=u32_old_num; idx<u32_rec_num; idx++)
+        {
+            uint32_t u32_bucket = pu32_hash[idx]&pst_index->u32_bucket_mask;
+
+            pu32_next[idx] = 0;
+
+            if(pst_index->pu32_tail[u32_bucket])
+                pu32_next[pst_index->pu32_tail[u32_bucket]-1] = idx+1;
+            else
+                pst_index->pu32_bucket[u32_bucket] = idx+1;
+
+            pst_index->pu32_tail[u32_bucket] = idx+1;
+        }
+    }
+
+    pst_index->u32_rec_num = u32_rec_num;
+
+    return true;
+}
+
+/* merge the keys of records from u32_old_num on into an ordered index */
+static bool _db_order_extend(struct db *pst_db, struct db_order *pst_order, uint32_t u32_old_num)
+{
+    struct db_field *pst_field = pst_db->st_field_info.a_field[pst_order->u32_field_idx];
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    struct _db_order_ent *ast_ent;
+    uint32_t u32_num = 0;
+    int64_t *pi64_key;
+    uint32_t *pu32_rec_id;
+    int64_t i64_old;
+    int64_t i64_new;
+
+    /* arrays of an attached sidecar index are read-only, copy them */
+    if(true == pst_order->b_mapped)
+    {
+        pi64_key = (int64_t *)malloc((pst_order->u32_num+1)*sizeof(int64_t));
+        pu32_rec_id = (uint32_t *)malloc((pst_order->u32_num+1)*sizeof(uint32_t));
+
+        if(!pi64_key || !pu32_rec_id)
+        {
+            free(pi64_key);
+            free(pu32_rec_id);
+            return false;
+        }
+
+        memcpy((void *)pi64_key, (void *)pst_order->pi64_key, pst_order->u32_num*sizeof(int64_t));
+        memcpy((void *)pu32_rec_id, (void *)pst_order->pu32_rec_id, pst_order->u32_num*sizeof(uint32_t));
+
+        pst_order->pi64_key = pi64_key;
+        pst_order->pu32_rec_id = pu32_rec_id;
+        pst_order->b_mapped = false;
+    }
+
+    ast_ent = (struct _db_order_ent *)malloc((u32_rec_num-u32_old_num+1)*sizeof(struct _db_order_ent));
+    if(!ast_ent)
+        return false;
+
+    for(uint32_t idx=u32_old_num, u32_blk_num=0; idx<u32_rec_num; idx+=u32_blk_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_blk_num);
+
+        if(NULL == pu8_data)
+        {
+            free(ast_ent);
+            return false;
+        }
+
+        for(uint32_t u32_off=0; u32_off<u32_blk_num; u32_off++, pu8_data+=u16_rec_len)
+        {
+            if(true == _db_order_key(pst_field, pu8_data, &ast_ent[u32_num].i64_key))
+                ast_ent[u32_num++].u32_rec_id = idx+u32_off;
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    qsort((void *)ast_ent, u32_num, sizeof(struct _db_order_ent), _db_cmp_order_ent);
+
+    pi64_key = (int64_t *)realloc(pst_order->pi64_key, (pst_order->u32_num+u32_num+1)*sizeof(int64_t));
+    if(pi64_key)
+        pst_order->pi64_key = pi64_key;
+
+    pu32_rec_id = (uint32_t *)realloc(pst_order->pu32_rec_id, (pst_order->u32_num+u32_num+1)*sizeof(uint32_t));
+    if(pu32_rec_id)
+        pst_order->pu32_rec_id = pu32_rec_id;
+
+    if(!pi64_key || !pu32_rec_id)
+    {
+        free(ast_ent);
+        return false;
+    }
+
+    /* merge from the back, new ids sort after old ones of the same key
+     * so keys appended in order move nothing */
+    for(int64_t i64_dst=(int64_t)pst_order->u32_num+u32_num-1, i64_src=(int64_t)pst_order->u32_num-1, i64_ent=(int64_t)u32_num-1;
+        i64_ent>=0;
+        i64_dst--)
+    {
+        i64_new = ast_ent[i64_ent].i64_key;
+        i64_old = (i64_src >= 0)?(pi64_key[i64_src]):(INT64_MIN);
+
+        if((i64_src >= 0) && (i64_old > i64_new))
+        {
+            pi64_key[i64_dst] = i64_old;
+            pu32_rec_id[i64_dst] = pu32_rec_id[i64_src--];
+        }
+        else
+        {
+            pi64_key[i64_dst] = i64_new;
+            pu32_rec_id[i64_dst] = ast_ent[i64_ent--].u32_rec_id;
+        }
+    }
+
+    pst_order->u32_num += u32_num;
+
+    free(ast_ent);
+
+    return true;
+}
+
+bool db_refresh(hdb h_db, uint32_t *pu32_first_id, uint32_t *pu32_num)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    uint32_t u32_old_num = pst_hdr->u32_rec_num;
+    uint32_t u32_rec_num;
+    uint32_t u32_rec_avail;
+    uint64_t u64_size;
+    uint8_t au8_hdr[32];
+
+    if(pu32_first_id)
+        *pu32_first_id = u32_old_num;
+
+    if(pu32_num)
+        *pu32_num = 0;
+
+    /* bypass stdio, its buffer may hold the header as first read */
+    if(sizeof(au8_hdr) != pread(fileno(pst_db->pf_db), (void *)au8_hdr, sizeof(au8_hdr), 0))
+        return false;
+
+    /* a rewritten table needs to be opened again */
+    if(((uint16_t)(au8_hdr[9]<<8 | au8_hdr[8]) != pst_hdr->u16_hdr_len) ||
+       ((uint16_t)(au8_hdr[11]<<8 | au8_hdr[10]) != pst_hdr->u16_rec_len))
+        return false;
+
+    u32_rec_num = _db_get_le32(&au8_hdr[4]);
+
+    /* the header may count records still being written */
+    u64_size = _db_file_size(pst_db);
+    u32_rec_avail = (u64_size > pst_hdr->u16_hdr_len)?((u64_size-pst_hdr->u16_hdr_len)/pst_hdr->u16_rec_len):(0);
+    if(u32_rec_num > u32_rec_avail)
+        u32_rec_num = u32_rec_avail;
+
+    /* records are only ever appended, fewer means a packed table */
+    if(u32_rec_num < u32_old_num)
+        return false;
+
+    if(u32_rec_num == u32_old_num)
+        return true;
+
+    if(false == _db_rec_cache_grow(pst_db, u32_rec_num))
+        return false;
+
+    memcpy((void *)pst_hdr->au8_last_update, (void *)&au8_hdr[1], 3);
+
+    /* memos of new records may lie beyond the old memo mapping */
+    if(NULL != pst_db->pu8_memo_map)
+    {
+        struct stat st_stat;
+
+        if((0 == fstat(fileno(pst_db->pf_memo), &st_stat)) && ((size_t)st_stat.st_size > pst_db->t_memo_map_len))
+        {
+            munmap((void *)pst_db->pu8_memo_map, pst_db->t_memo_map_len);
+            pst_db->pu8_memo_map = NULL;
+            _db_memo_map_init(pst_db);
+        }
+    }
+
+    /* indexes that can not follow are dropped, lookups then scan */
+    for(uint32_t idx=0; idx<pst_info->u8_field_num; idx++)
+    {
+        if((NULL != pst_db->apst_index) && (NULL != pst_db->apst_index[idx]))
+        {
+            if(false == _db_index_extend(pst_db, pst_db->apst_index[idx]))
+            {
+                _db_index_free(pst_db->apst_index[idx]);
+                pst_db->apst_index[idx] = NULL;
+            }
+
+            pst_db->b_index_dirty = true;
+        }
+
+        if((NULL != pst_db->apst_order) && (NULL != pst_db->apst_order[idx]))
+        {
+            if(false == _db_order_extend(pst_db, pst_db->apst_order[idx], u32_old_num))
+            {
+                _db_order_free(pst_db->apst_order[idx]);
+                pst_db->apst_order[idx] = NULL;
+            }
+
+            pst_db->b_index_dirty = true;
+        }
+    }
+
+    if(pu32_num)
+        *pu32_num = pst_hdr->u32_rec_num-u32_old_num;
+
+    return true;
+}
+
+bool db_follow(hdb h_db, uint32_t u32_poll_ms, db_pf_follow pf_follow, void *pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct pollfd st_poll = {.fd=-1,.events=POLLIN};
+    uint32_t u32_first_id;
+    uint32_t u32_num;
+    bool b_ret = true;
+
+    if(NULL == pf_follow)
+        return false;
+
+#ifdef __linux__
+    /* wake on writes to the table, network file systems may never
+     * report them so the poll timeout still applies */
+    st_poll.fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    if((st_poll.fd >= 0) && (inotify_add_watch(st_poll.fd, pst_db->s_db_name, IN_MODIFY|IN_CLOSE_WRITE) < 0))
+    {
+        close(st_poll.fd);
+        st_poll.fd = -1;
+    }
+#endif
+
+    for(;;)
+    {
+        if(false == db_refresh(h_db, &u32_first_id, &u32_num))
+        {
+            b_ret = false;
+            break;
+        }
+
+        if(false == pf_follow(h_db, u32_first_id, u32_num, pv_usr_data))
+            break;
+
+        /* poll without descriptors is a plain sleep */
+        if(poll(&st_poll, (st_poll.fd >= 0)?(1):(0), u32_poll_ms) > 0)
+        {
+            uint8_t au8_event[4096];
+
+            while(read(st_poll.fd, (void *)au8_event, sizeof(au8_event)) > 0);
+        }
+    }
+
+    if(st_poll.fd >= 0)
+        close(st_poll.fd);
+
+    return b_ret;
+}
+
+static void _db_filter_put_u64(uint64_t u64_val, uint8_t *pu8_out)
+{
+    for(int idx=7; idx>=0; idx--, u64_val>>=8)
+        pu8_out[idx] = u64_val&0xff;
+}
+
+/* store a signed value big endian with the sign bit flipped */
+static void _db_filter_put_i64(int64_t i64_val, uint8_t *pu8_out)
+{
+    _db_filter_put_u64((uint64_t)i64_val^(1ull<<63), pu8_out);
+}
+
+/* store a double big endian, positive with sign set, negative inverted */
+static void _db_filter_put_dbl(const uint8_t *pu8_dbl, uint8_t *pu8_out)
+{
+    uint64_t u64_val;
+
+    memcpy((void *)&u64_val, (void *)pu8_dbl, sizeof(u64_val));
+    u64_val = (u64_val>>63)?(~u64_val):(u64_val|(1ull<<63));
+    _db_filter_put_u64(u64_val, pu8_out);
+}
+
+/* parse a N/F field text into a fixed point value with u8_dec decimals,
+ * *pi8_rest tells the sign of digits beyond them; fails on overflow */
+static bool _db_filter_num_parse(
+        const uint8_t *pu8_data,
+        uint32_t u32_len,
+        uint8_t u8_dec,
+        int64_t *pi64_val,
+        int8_t *pi8_rest)
+{
+    uint32_t idx = 0;
+    uint32_t u32_digit = 0;
+    uint8_t u8_frac = 0;
+    bool b_neg = false;
+    bool b_rest = false;
+    int64_t i64_val = 0;
+
+    while((idx < u32_len) && (' ' == pu8_data[idx]))
+        idx++;
+
+    if((idx < u32_len) && (('-' == pu8_data[idx]) || ('+' == pu8_data[idx])))
+        b_neg = ('-' == pu8_data[idx++]);
+
+    for(; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_digit++)
+    {
+        if(i64_val > (INT64_MAX-(pu8_data[idx]-'0'))/10)
+            return false;
+
+        i64_val = i64_val*10+(pu8_data[idx]-'0');
+    }
+
+    if((idx < u32_len) && ('.' == pu8_data[idx]))
+    {
+        for(idx++; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_digit++)
+        {
+            if(u8_frac < u8_dec)
+            {
+                if(i64_val > (INT64_MAX-(pu8_data[idx]-'0'))/10)
+                    return false;
+
+                i64_val = i64_val*10+(pu8_data[idx]-'0');
+                u8_frac++;
+            }
+            else if('0' != pu8_data[idx])
+            {
+                b_rest = true;
+            }
+        }
+    }
+
+    while((idx < u32_len) && ((' ' == pu8_data[idx]) || (0 == pu8_data[idx])))
+        idx++;
+
+    if((0 == u32_digit) || (idx != u32_len))
+        return false;
+
+    for(; u8_frac<u8_dec; u8_frac++)
+    {
+        if(i64_val > INT64_MAX/10)
+            return false;
+
+        i64_val *= 10;
+    }
+
+    *pi64_val = (b_neg)?(-i64_val):(i64_val);
+    *pi8_rest = (b_rest)?((b_neg)?(-1):(1)):(0);
+
+    return true;
+}
+
+/* powers of ten exactly representable as double */
+static const double ad_db_pow10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* parse N/F field text, including an exponent, into a double */
+static bool _db_num_parse_double(const uint8_t *pu8_data, uint32_t u32_len, double *pd_val)
+{
+    uint32_t idx = 0;
+    uint32_t u32_digit = 0;
+    uint64_t u64_mant = 0;
+    int32_t i32_exp = 0;
+    bool b_neg = false;
+    double d_val;
+
+    while((idx < u32_len) && (' ' == pu8_data[idx]))
+        idx++;
+
+    if((idx < u32_len) && (('-' == pu8_data[idx]) || ('+' == pu8_data[idx])))
+        b_neg = ('-' == pu8_data[idx++]);
+
+    for(; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_digit++)
+    {
+        if(u64_mant < 100000000000000000ull)
+            u64_mant = u64_mant*10+(pu8_data[idx]-'0');
+        else
+            i32_exp++;
+    }
+
+    if((idx < u32_len) && ('.' == pu8_data[idx]))
+    {
+        uint32_t u32_zero = 0;
+
+        /* trailing zeros of the fraction would only grow the mantissa */
+        for(idx++; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_digit++)
+        {
+            if('0' == pu8_data[idx])
+            {
+                u32_zero++;
+                continue;
+            }
+
+            for(; u32_zero && (u64_mant < 100000000000000000ull); u32_zero--, i32_exp--)
+                u64_mant *= 10;
+
+            if((0 == u32_zero) && (u64_mant < 100000000000000000ull))
+            {
+                u64_mant = u64_mant*10+(pu8_data[idx]-'0');
+                i32_exp--;
+            }
+        }
+    }
+
+    if((0 != u32_digit) && (idx < u32_len) && (('E' == pu8_data[idx]) || ('e' == pu8_data[idx])))
+    {
+        int32_t i32_val = 0;
+        bool b_neg_exp = false;
+
+        idx++;
+        if((idx < u32_len) && (('-' == pu8_data[idx]) || ('+' == pu8_data[idx])))
+            b_neg_exp = ('-' == pu8_data[idx++]);
+
+        if((idx >= u32_len) || !isdigit(pu8_data[idx]))
+            return false;
+
+        for(; (idx < u32_len) && isdigit(pu8_data[idx]) && (i32_val < 10000); idx++)
+            i32_val = i32_val*10+(pu8_data[idx]-'0');
+
+        i32_exp += (b_neg_exp)?(-i32_val):(i32_val);
+    }
+
+    while((idx < u32_len) && ((' ' == pu8_data[idx]) || (0 == pu8_data[idx])))
+        idx++;
+
+    if((0 == u32_digit) || (idx != u32_len))
+        return false;
+
+    /* exact when the mantissa and the power of ten both fit a double */
+    d_val = (double)u64_mant;
+
+    for(; i32_exp < -22; i32_exp += 22)
+        d_val /= 1e22;
+
+    for(; i32_exp > 22; i32_exp -= 22)
+        d_val *= 1e22;
+
+    d_val = (i32_exp < 0)?(d_val/ad_db_pow10[-i32_exp]):(d_val*ad_db_pow10[i32_exp]);
+
+    *pd_val = (b_neg)?(-d_val):(d_val);
+
+    return true;
+}
+
+/* turn field bytes into the compared key, NULL when there is no value */
+static const uint8_t *_db_filter_value(
+        const struct db_filter *pst_filter,
+        const uint8_t *pu8_data,
+        uint8_t *pu8_out)
+{
+    switch(pst_filter->e_val)
+    {
+        case DB_FILTER_VAL_RAW:
+            return pu8_data;
+        case DB_FILTER_VAL_DATE:
+            return ((' ' == pu8_data[0]) || (0 == pu8_data[0]))?(NULL):(pu8_data);
+        case DB_FILTER_VAL_NUM:
+            {
+                int64_t i64_val;
+                int8_t i8_rest;
+
+                if(false == _db_filter_num_parse(pu8_data, pst_filter->u8_len, pst_filter->u8_dec, &i64_val, &i8_rest))
+                    return NULL;
+
+                _db_filter_put_i64(i64_val, pu8_out);
+                return pu8_out;
+            }
+        case DB_FILTER_VAL_NUM_DBL:
+            {
+                double d_val;
+
+                if(false == _db_num_parse_double(pu8_data, pst_filter->u8_len, &d_val))
+                    return NULL;
+
+                /* -0 and 0 are the same number */
+                d_val = (0 == d_val)?(0):(d_val);
+                _db_filter_put_dbl((const uint8_t *)&d_val, pu8_out);
+                return pu8_out;
+            }
+        case DB_FILTER_VAL_INT:
+            _db_filter_put_i64((int32_t)_db_get_le32(pu8_data), pu8_out);
+            return pu8_out;
+        case DB_FILTER_VAL_CUR:
+            {
+                int64_t i64_val;
+
+                memcpy((void *)&i64_val, (void *)pu8_data, sizeof(i64_val));
+                _db_filter_put_i64(i64_val, pu8_out);
+                return pu8_out;
+            }
+        case DB_FILTER_VAL_DBL:
+            _db_filter_put_dbl(pu8_data, pu8_out);
+            return pu8_out;
+        case DB_FILTER_VAL_TIME:
+            {
+                uint32_t u32_day = _db_get_le32(pu8_data);
+                uint32_t u32_ms = _db_get_le32(&pu8_data[4]);
+
+                if(true == _db_time_is_blank(pu8_data))
+                    return NULL;
+
+                pu8_out[0] = u32_day>>24;
+                pu8_out[1] = u32_day>>16;
+                pu8_out[2] = u32_day>>8;
+                pu8_out[3] = u32_day;
+                pu8_out[4] = u32_ms>>24;
+                pu8_out[5] = u32_ms>>16;
+                pu8_out[6] = u32_ms>>8;
+                pu8_out[7] = u32_ms;
+                return pu8_out;
+            }
+        default:
+            return NULL;
+    }
+}
+
+/* compile a key given in the field format, i8_bound is -1 for a lowest,
+ * 1 for a highest and 0 for an exact key; returns 0 when no field value
+ * can be equal to the key and -1 on a malformed key */
+static int _db_filter_key(
+        const struct db_filter *pst_filter,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len,
+        int8_t i8_bound,
+        uint8_t *pu8_out)
+{
+    int64_t i64_val;
+    int8_t i8_rest;
+
+    switch(pst_filter->e_val)
+    {
+        case DB_FILTER_VAL_RAW:
+        case DB_FILTER_VAL_DATE:
+            if(u32_key_len > pst_filter->u8_len)
+                return -1;
+
+            if((DB_FILTER_VAL_DATE == pst_filter->e_val) && (u32_key_len != pst_filter->u8_len))
+                return -1;
+
+            memcpy((void *)pu8_out, (void *)pu8_key, u32_key_len);
+            memset((void *)&pu8_out[u32_key_len], ' ', pst_filter->u8_len-u32_key_len);
+            return 1;
+        case DB_FILTER_VAL_NUM:
+            if(false == _db_filter_num_parse(pu8_key, u32_key_len, pst_filter->u8_dec, &i64_val, &i8_rest))
+                return -1;
+
+            /* round a bound with more decimals than the field inwards */
+            if(0 != i8_rest)
+            {
+                if(0 == i8_bound)
+                    return 0;
+
+                if((i8_bound < 0) && (i8_rest > 0))
+                    i64_val++;
+                else if((i8_bound > 0) && (i8_rest < 0))
+                    i64_val--;
+            }
+
+            _db_filter_put_i64(i64_val, pu8_out);
+            return 1;
+        case DB_FILTER_VAL_NUM_DBL:
+            {
+                double d_val;
+
+                if(false == _db_num_parse_double(pu8_key, u32_key_len, &d_val))
+                    return -1;
+
+                d_val = (0 == d_val)?(0):(d_val);
+                _db_filter_put_dbl((const uint8_t *)&d_val, pu8_out);
+                return 1;
+            }
+        default:
+            if(u32_key_len != pst_filter->u8_len)
+                return -1;
+
+            return (NULL == _db_filter_value(pst_filter, pu8_key, pu8_out))?(-1):(1);
+    }
+}
+
+static struct db_filter *_db_filter_leaf(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        enum db_filter_op e_op,
+        uint32_t u32_key_num)
+{
+    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
+    struct db_field *pst_field;
+    struct db_filter *pst_filter;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return NULL;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+
+    pst_filter = (struct db_filter *)calloc(1, sizeof(struct db_filter));
+    if(!pst_filter)
+        return NULL;
+
+    pst_filter->e_op = e_op;
+    pst_filter->u32_offset = pst_field->u32_acc_len;
+    pst_filter->u8_len = pst_field->u8_len;
+    pst_filter->u8_dec = pst_field->u8_dec;
+
+    switch(toupper(pst_field->u8_type))
+    {
+        case 'D':
+            pst_filter->e_val = DB_FILTER_VAL_DATE;
+            break;
+        case 'N':
+        case 'F':
+            /* every digit and the padded decimals must fit in int64 */
+            pst_filter->e_val = (pst_field->u8_len+pst_field->u8_dec <= 18)?(DB_FILTER_VAL_NUM):(DB_FILTER_VAL_NUM_DBL);
+            break;
+        case 'I':
+            pst_filter->e_val = (4 == pst_field->u8_len)?(DB_FILTER_VAL_INT):(DB_FILTER_VAL_RAW);
+            break;
+        case 'Y':
+            pst_filter->e_val = (8 == pst_field->u8_len)?(DB_FILTER_VAL_CUR):(DB_FILTER_VAL_RAW);
+            break;
+        case 'B':
+            pst_filter->e_val = (8 == pst_field->u8_len)?(DB_FILTER_VAL_DBL):(DB_FILTER_VAL_RAW);
+            break;
+        case 'T':
+            pst_filter->e_val = (8 == pst_field->u8_len)?(DB_FILTER_VAL_TIME):(DB_FILTER_VAL_RAW);
+            break;
+        default:
+            pst_filter->e_val = DB_FILTER_VAL_RAW;
+            break;
+    }
+
+    /* prefixes are compared on the bytes as they are */
+    if(DB_FILTER_OP_PREFIX == e_op)
+        pst_filter->e_val = DB_FILTER_VAL_RAW;
+
+    switch(pst_filter->e_val)
+    {
+        case DB_FILTER_VAL_RAW:
+        case DB_FILTER_VAL_DATE:
+            pst_filter->u32_key_len = pst_field->u8_len;
+            break;
+        default:
+            pst_filter->u32_key_len = 8;
+            break;
+    }
+
+    if(0 != u32_key_num)
+    {
+        pst_filter->pu8_key = (uint8_t *)malloc((size_t)u32_key_num*pst_filter->u32_key_len);
+        if(!pst_filter->pu8_key)
+        {
+            free(pst_filter);
+            return NULL;
+        }
+    }
+
+    return pst_filter;
+}
+
+hdb_filter db_filter_eq(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len)
+{
+    struct db_filter *pst_filter = _db_filter_leaf(h_db, u32_field_idx, DB_FILTER_OP_EQ, 1);
+    int i_ret;
+
+    if(!pst_filter)
+        return NULL;
+
+    i_ret = _db_filter_key(pst_filter, pu8_key, u32_key_len, 0, pst_filter->pu8_key);
+    if(i_ret < 0)
+    {
+        db_filter_free(pst_filter);
+        return NULL;
+    }
+
+    pst_filter->u32_key_num = 1;
+    if(0 == i_ret)
+        pst_filter->e_op = DB_FILTER_OP_NONE;
+
+    return pst_filter;
+}
+
+hdb_filter db_filter_prefix(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len)
+{
+    struct db_filter *pst_filter = _db_filter_leaf(h_db, u32_field_idx, DB_FILTER_OP_PREFIX, 1);
+
+    if(!pst_filter)
+        return NULL;
+
+    if(u32_key_len > pst_filter->u8_len)
+    {
+        db_filter_free(pst_filter);
+        return NULL;
+    }
+
+    memcpy((void *)pst_filter->pu8_key, (void *)pu8_key, u32_key_len);
+    pst_filter->u32_key_len = u32_key_len;
+    pst_filter->u32_key_num = 1;
+
+    return pst_filter;
+}
+
+hdb_filter db_filter_range(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len)
+{
+    struct db_filter *pst_filter = _db_filter_leaf(h_db, u32_field_idx, DB_FILTER_OP_RANGE, 2);
+
+    if(!pst_filter)
+        return NULL;
+
+    pst_filter->u32_key_num = 2;
+    pst_filter->b_lo = (NULL != pu8_lo);
+    pst_filter->b_hi = (NULL != pu8_hi);
+
+    if(((true == pst_filter->b_lo) &&
+        (1 != _db_filter_key(pst_filter, pu8_lo, u32_lo_len, -1, pst_filter->pu8_key))) ||
+       ((true == pst_filter->b_hi) &&
+        (1 != _db_filter_key(pst_filter, pu8_hi, u32_hi_len, 1, &pst_filter->pu8_key[pst_filter->u32_key_len]))))
+    {
+        db_filter_free(pst_filter);
+        return NULL;
+    }
+
+    return pst_filter;
+}
+
+hdb_filter db_filter_in(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t * const *apu8_key,
+        const uint32_t *au32_key_len,
+        uint32_t u32_key_num)
+{
+    struct db_filter *pst_filter = _db_filter_leaf(h_db, u32_field_idx, DB_FILTER_OP_IN, u32_key_num);
+    uint32_t u32_key_len;
+
+    if(!pst_filter)
+        return NULL;
+
+    u32_key_len = pst_filter->u32_key_len;
+
+    /* keep the keys sorted and unique for a binary search */
+    for(uint32_t idx=0; idx<u32_key_num; idx++)
+    {
+        uint8_t *pu8_out = &pst_filter->pu8_key[(size_t)pst_filter->u32_key_num*u32_key_len];
+        uint32_t u32_lo = 0;
+        uint32_t u32_hi = pst_filter->u32_key_num;
+        int i_ret = _db_filter_key(pst_filter, apu8_key[idx], au32_key_len[idx], 0, pu8_out);
+
+        if(i_ret < 0)
+        {
+            db_filter_free(pst_filter);
+            return NULL;
+        }
+
+        if(0 == i_ret)
+            continue;
+
+        while(u32_lo < u32_hi)
+        {
+            uint32_t u32_mid = u32_lo+(u32_hi-u32_lo)/2;
+
+            if(memcmp((void *)&pst_filter->pu8_key[(size_t)u32_mid*u32_key_len], (void *)pu8_out, u32_key_len) < 0)
+                u32_lo = u32_mid+1;
+            else
+                u32_hi = u32_mid;
+        }
+
+        if((u32_lo < pst_filter->u32_key_num) &&
+           (0 == memcmp((void *)&pst_filter->pu8_key[(size_t)u32_lo*u32_key_len], (void *)pu8_out, u32_key_len)))
+            continue;
+
+        if(u32_lo < pst_filter->u32_key_num)
+        {
+            uint8_t au8_key[256];
+
+            memcpy((void *)au8_key, (void *)pu8_out, u32_key_len);
+            memmove(
+                    (void *)&pst_filter->pu8_key[(size_t)(u32_lo+1)*u32_key_len],
+                    (void *)&pst_filter->pu8_key[(size_t)u32_lo*u32_key_len],
+                    (size_t)(pst_filter->u32_key_num-u32_lo)*u32_key_len);
+            memcpy((void *)&pst_filter->pu8_key[(size_t)u32_lo*u32_key_len], (void *)au8_key, u32_key_len);
+        }
+
+        pst_filter->u32_key_num++;
+    }
+
+    return pst_filter;
+}
+
+static hdb_filter _db_filter_node(enum db_filter_op e_op, hdb_filter h_left, hdb_filter h_right)
+{
+    struct db_filter *pst_filter;
+
+    if((NULL == h_left) || ((DB_FILTER_OP_NOT != e_op) && (NULL == h_right)))
+    {
+        db_filter_free(h_left);
+        db_filter_free(h_right);
+        return NULL;
+    }
+
+    pst_filter = (struct db_filter *)calloc(1, sizeof(struct db_filter));
+    if(!pst_filter)
+    {
+        db_filter_free(h_left);
+        db_filter_free(h_right);
+        return NULL;
+    }
+
+    pst_filter->e_op = e_op;
+    pst_filter->pst_left = (struct db_filter *)h_left;
+    pst_filter->pst_right = (struct db_filter *)h_right;
+
+    return pst_filter;
+}
+
+hdb_filter db_filter_and(hdb_filter h_left, hdb_filter h_right)
+{
+    return _db_filter_node(DB_FILTER_OP_AND, h_left, h_right);
+}
+
+hdb_filter db_filter_or(hdb_filter h_left, hdb_filter h_right)
+{
+    return _db_filter_node(DB_FILTER_OP_OR, h_left, h_right);
+}
+
+hdb_filter db_filter_not(hdb_filter h_filter)
+{
+    return _db_filter_node(DB_FILTER_OP_NOT, h_filter, NULL);
+}
+
+void db_filter_free(hdb_filter h_filter)
+{
+    struct db_filter *pst_filter = (struct db_filter *)h_filter;
+
+    if(!pst_filter)
+        return;
+
+    db_filter_free(pst_filter->pst_left);
+    db_filter_free(pst_filter->pst_right);
+    free(pst_filter->pu8_key);
+    free(pst_filter);
+}
+
+bool db_filter_match(hdb_filter h_filter, const uint8_t *pu8_rec_data)
+{
+    const struct db_filter *pst_filter = (const struct db_filter *)h_filter;
+    const uint8_t *pu8_val;
+    uint8_t au8_val[8];
+    uint32_t u32_key_len;
+    uint32_t u32_lo;
+    uint32_t u32_hi;
+
+    switch(pst_filter->e_op)
+    {
+        case DB_FILTER_OP_AND:
+            return db_filter_match(pst_filter->pst_left, pu8_rec_data) &&
+                   db_filter_match(pst_filter->pst_right, pu8_rec_data);
+        case DB_FILTER_OP_OR:
+            return db_filter_match(pst_filter->pst_left, pu8_rec_data) ||
+                   db_filter_match(pst_filter->pst_right, pu8_rec_data);
+        case DB_FILTER_OP_NOT:
+            return !db_filter_match(pst_filter->pst_left, pu8_rec_data);
+        case DB_FILTER_OP_PREFIX:
+            return (0 == memcmp((void *)&pu8_rec_data[pst_filter->u32_offset], (void *)pst_filter->pu8_key, pst_filter->u32_key_len));
+        case DB_FILTER_OP_NONE:
+            return false;
+        default:
+            break;
+    }
+
+    pu8_val = _db_filter_value(pst_filter, &pu8_rec_data[pst_filter->u32_offset], au8_val);
+    if(NULL == pu8_val)
+        return false;
+
+    u32_key_len = pst_filter->u32_key_len;
+
+    switch(pst_filter->e_op)
+    {
+        case DB_FILTER_OP_EQ:
+            return (0 == memcmp((void *)pu8_val, (void *)pst_filter->pu8_key, u32_key_len));
+        case DB_FILTER_OP_RANGE:
+            if((true == pst_filter->b_lo) &&
+               (memcmp((void *)pu8_val, (void *)pst_filter->pu8_key, u32_key_len) < 0))
+                return false;
+
+            if((true == pst_filter->b_hi) &&
+               (memcmp((void *)pu8_val, (void *)&pst_filter->pu8_key[u32_key_len], u32_key_len) > 0))
+                return false;
+
+            return true;
+        case DB_FILTER_OP_IN:
+            u32_lo = 0;
+            u32_hi = pst_filter->u32_key_num;
+
+            while(u32_lo < u32_hi)
+            {
+                uint32_t u32_mid = u32_lo+(u32_hi-u32_lo)/2;
+                int i_cmp = memcmp((void *)pu8_val, (void *)&pst_filter->pu8_key[(size_t)u32_mid*u32_key_len], u32_key_len);
+
+                if(0 == i_cmp)
+                    return true;
+
+                if(i_cmp > 0)
+                    u32_lo = u32_mid+1;
+                else
+                    u32_hi = u32_mid;
+            }
+
+            return false;
+        default:
+            return false;
+    }
+}
+
+/* what a scan kernel compares, keys are already padded */
+struct _db_scan_key
+{
+    uint8_t u8_op;
+    uint32_t u32_offset;
+    uint32_t u32_len;
+    uint8_t au8_key[256];
+
+    /* DB_SCAN_DATE_RANGE bounds as big endian numbers */
+    uint64_t u64_lo;
+    uint64_t u64_hi;
+};
+
+typedef uint32_t (*_db_pf_scan)(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id);
+
+#define _DB_SCAN_SET(pu64_sel, u32_id) ((pu64_sel)[(u32_id)>>6] |= 1ull<<((u32_id)&63))
+
+/* number of leading records whose u32_width bytes from u32_offset can
+ * be loaded without reading past the end of the block */
+static uint32_t _db_scan_safe_num(uint32_t u32_num, uint16_t u16_rec_len, uint32_t u32_offset, uint32_t u32_width)
+{
+    size_t t_end = (size_t)u32_num*u16_rec_len;
+
+    if(t_end < u32_offset+u32_width)
+        return 0;
+
+    return (t_end-u32_offset-u32_width)/u16_rec_len+1;
+}
+
+static uint64_t _db_scan_get_be64(const uint8_t *pu8_data)
+{
+    uint64_t u64_val = 0;
+
+    for(int idx=0; idx<8; idx++)
+        u64_val = (u64_val<<8)|pu8_data[idx];
+
+    return u64_val;
+}
+
+static uint32_t _db_scan_cmp_scalar(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    const uint8_t *pu8_field = &pu8_data[pst_key->u32_offset];
+    uint32_t u32_match = 0;
+
+    for(uint32_t idx=0; idx<u32_num; idx++, pu8_field+=u16_rec_len)
+    {
+        if(0 == memcmp((void *)pu8_field, (void *)pst_key->au8_key, pst_key->u32_len))
+        {
+            _DB_SCAN_SET(pu64_sel, u32_first_id+idx);
+            u32_match++;
+        }
+    }
+
+    return u32_match;
+}
+
+static uint32_t _db_scan_deleted_scalar(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    uint32_t u32_match = 0;
+
+    for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+    {
+        if('*' == pu8_data[0])
+        {
+            _DB_SCAN_SET(pu64_sel, u32_first_id+idx);
+            u32_match++;
+        }
+    }
+
+    return u32_match;
+}
+
+static uint32_t _db_scan_date_scalar(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    const uint8_t *pu8_field = &pu8_data[pst_key->u32_offset];
+    uint32_t u32_match = 0;
+
+    for(uint32_t idx=0; idx<u32_num; idx++, pu8_field+=u16_rec_len)
+    {
+        uint64_t u64_val = _db_scan_get_be64(pu8_field);
+
+        if((u64_val >= pst_key->u64_lo) && (u64_val <= pst_key->u64_hi))
+        {
+            _DB_SCAN_SET(pu64_sel, u32_first_id+idx);
+            u32_match++;
+        }
+    }
+
+    return u32_match;
+}
+
+#ifdef DB_SCAN_X86
+__attribute__((target("sse2")))
+static uint32_t _db_scan_cmp_sse2(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    const uint8_t *pu8_field = &pu8_data[pst_key->u32_offset];
+    uint32_t u32_len = pst_key->u32_len;
+    uint32_t u32_safe = _db_scan_safe_num(u32_num, u16_rec_len, pst_key->u32_offset, (u32_len < 16)?(16):(u32_len));
+    uint32_t u32_mask = (u32_len >= 16)?(0xffff):((1u<<u32_len)-1);
+    __m128i x_key = _mm_loadu_si128((const __m128i *)pst_key->au8_key);
+    __m128i x_tail = _mm_loadu_si128((const __m128i *)&pst_key->au8_key[(u32_len > 16)?(u32_len-16):(0)]);
+    uint32_t u32_match = 0;
+    uint32_t idx;
+
+    for(idx=0; idx<u32_safe; idx++, pu8_field+=u16_rec_len)
+    {
+        uint32_t u32_eq = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)pu8_field), x_key));
+
+        if((u32_eq&u32_mask) != u32_mask)
+            continue;
+
+        /* longer keys, the last 16 bytes may overlap the previous ones */
+        if(u32_len > 16)
+        {
+            uint32_t u32_off;
+
+            for(u32_off=16; u32_off+16<u32_len; u32_off+=16)
+            {
+                if(0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(
+                                _mm_loadu_si128((const __m128i *)&pu8_field[u32_off]),
+                                _mm_loadu_si128((const __m128i *)&pst_key->au8_key[u32_off]))))
+                    break;
+            }
+
+            if((u32_off+16 < u32_len) ||
+               (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(
+                               _mm_loadu_si128((const __m128i *)&pu8_field[u32_len-16]), x_tail))))
+                continue;
+        }
+
+        _DB_SCAN_SET(pu64_sel, u32_first_id+idx);
+        u32_match++;
+    }
+
+    return u32_match+_db_scan_cmp_scalar(
+            &pu8_data[(size_t)idx*u16_rec_len],
+            u32_num-idx,
+            u16_rec_len,
+            pst_key,
+            pu64_sel,
+            u32_first_id+idx);
+}
+
+__attribute__((target("avx2")))
+static uint32_t _db_scan_cmp_avx2(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    const uint8_t *pu8_field = &pu8_data[pst_key->u32_offset];
+    uint32_t u32_len = pst_key->u32_len;
+    uint32_t u32_safe = _db_scan_safe_num(u32_num, u16_rec_len, pst_key->u32_offset, (u32_len < 32)?(32):(u32_len));
+    uint32_t u32_mask = (u32_len >= 32)?(0xffffffff):((1u<<u32_len)-1);
+    __m256i y_key = _mm256_loadu_si256((const __m256i *)pst_key->au8_key);
+    __m256i y_tail = _mm256_loadu_si256((const __m256i *)&pst_key->au8_key[(u32_len > 32)?(u32_len-32):(0)]);
+    uint32_t u32_match = 0;
+    uint32_t idx;
+
+    for(idx=0; idx<u32_safe; idx++, pu8_field+=u16_rec_len)
+    {
+        uint32_t u32_eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)pu8_field), y_key));
+
+        if((u32_eq&u32_mask) != u32_mask)
+            continue;
+
+        if(u32_len > 32)
+        {
+            uint32_t u32_off;
+
+            for(u32_off=32; u32_off+32<u32_len; u32_off+=32)
+            {
+                if(0xffffffff != (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                                _mm256_loadu_si256((const __m256i *)&pu8_field[u32_off]),
+                                _mm256_loadu_si256((const __m256i *)&pst_key->au8_key[u32_off]))))
+                    break;
+            }
+
+            if((u32_off+32 < u32_len) ||
+               (0xffffffff != (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                               _mm256_loadu_si256((const __m256i *)&pu8_field[u32_len-32]), y_tail))))
+                continue;
+        }
+
+        _DB_SCAN_SET(pu64_sel, u32_first_id+idx);
+        u32_match++;
+    }
+
+    return u32_match+_db_scan_cmp_scalar(
+            &pu8_data[(size_t)idx*u16_rec_len],
+            u32_num-idx,
+            u16_rec_len,
+            pst_key,
+            pu64_sel,
+            u32_first_id+idx);
+}
+
+/* deletion flags of 8 records at once by gathering their first bytes */
+__attribute__((target("avx2")))
+static uint32_t _db_scan_deleted_avx2(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    uint32_t u32_safe = _db_scan_safe_num(u32_num, u16_rec_len, 0, 4);
+    __m256i y_idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(u16_rec_len));
+    __m256i y_byte = _mm256_set1_epi32(0xff);
+    __m256i y_flag = _mm256_set1_epi32('*');
+    uint32_t u32_match = 0;
+    uint32_t idx;
+
+    for(idx=0; idx+8<=u32_safe; idx+=8)
+    {
+        __m256i y_val = _mm256_i32gather_epi32((const int *)&pu8_data[(size_t)idx*u16_rec_len], y_idx, 1);
+        uint32_t u32_bits = _mm256_movemask_ps(_mm256_castsi256_ps(
+                    _mm256_cmpeq_epi32(_mm256_and_si256(y_val, y_byte), y_flag)));
+
+        for(; u32_bits; u32_bits&=u32_bits-1)
+        {
+            _DB_SCAN_SET(pu64_sel, u32_first_id+idx+__builtin_ctz(u32_bits));
+            u32_match++;
+        }
+    }
+
+    return u32_match+_db_scan_deleted_scalar(
+            &pu8_data[(size_t)idx*u16_rec_len],
+            u32_num-idx,
+            u16_rec_len,
+            pst_key,
+            pu64_sel,
+            u32_first_id+idx);
+}
+
+/* D field range of 4 records at once, the dates are gathered, turned
+ * big endian and compared as signed numbers with the sign bit flipped */
+__attribute__((target("avx2")))
+static uint32_t _db_scan_date_avx2(
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        const struct _db_scan_key *pst_key,
+        uint64_t *pu64_sel,
+        uint32_t u32_first_id)
+{
+    const uint8_t *pu8_field = &pu8_data[pst_key->u32_offset];
+    __m256i y_idx = _mm256_setr_epi64x(0, u16_rec_len, 2*u16_rec_len, 3*u16_rec_len);
+    __m256i y_swap = _mm256_setr_epi8(
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    __m256i y_sign = _mm256_set1_epi64x(INT64_MIN);
+    __m256i y_lo = _mm256_set1_epi64x(pst_key->u64_lo^(1ull<<63));
+    __m256i y_hi = _mm256_set1_epi64x(pst_key->u64_hi^(1ull<<63));
+    uint32_t u32_match = 0;
+    uint32_t idx;
+
+    for(idx=0; idx+4<=u32_num; idx+=4)
+    {
+        __m256i y_val = _mm256_i64gather_epi64((const long long *)&pu8_field[(size_t)idx*u16_rec_len], y_idx, 1);
+        __m256i y_out;
+        uint32_t u32_bits;
+
+        y_val = _mm256_xor_si256(_mm256_shuffle_epi8(y_val, y_swap), y_sign);
+        y_out = _mm256_or_si256(_mm256_cmpgt_epi64(y_lo, y_val), _mm256_cmpgt_epi64(y_val, y_hi));
+        u32_bits = ~_mm256_movemask_pd(_mm256_castsi256_pd(y_out))&0xf;
+
+        for(; u32_bits; u32_bits&=u32_bits-1)
+        {
+            _DB_SCAN_SET(pu64_sel, u32_first_id+idx+__builtin_ctz(u32_bits));
+            u32_match++;
+        }
+    }
+
+    return u32_match+_db_scan_date_scalar(
+            &pu8_data[(size_t)idx*u16_rec_len],
+            u32_num-idx,
+            u16_rec_len,
+            pst_key,
+            pu64_sel,
+            u32_first_id+idx);
+}
+#endif
+
+/* pick the widest kernel the cpu supports */
+static _db_pf_scan _db_scan_kernel(uint8_t u8_op)
+{
+#ifdef DB_SCAN_X86
+    bool b_avx2 = __builtin_cpu_supports("avx2");
+    bool b_sse2 = __builtin_cpu_supports("sse2");
+#endif
+
+    switch(u8_op)
+    {
+        case DB_SCAN_EQ:
+        case DB_SCAN_PREFIX:
+#ifdef DB_SCAN_X86
+            if(b_avx2)
+                return _db_scan_cmp_avx2;
+            if(b_sse2)
+                return _db_scan_cmp_sse2;
+#endif
+            return _db_scan_cmp_scalar;
+        case DB_SCAN_DATE_RANGE:
+#ifdef DB_SCAN_X86
+            if(b_avx2)
+                return _db_scan_date_avx2;
+#endif
+            return _db_scan_date_scalar;
+        case DB_SCAN_DELETED:
+#ifdef DB_SCAN_X86
+            if(b_avx2)
+                return _db_scan_deleted_avx2;
+#endif
+            return _db_scan_deleted_scalar;
+        default:
+            return NULL;
+    }
+}
+
+/* run a kernel over every record, pu64_sel is cleared first */
+static uint32_t _db_scan_run(struct db *pst_db, const struct _db_scan_key *pst_key, uint64_t *pu64_sel)
+{
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    _db_pf_scan pf_scan = _db_scan_kernel(pst_key->u8_op);
+    uint32_t u32_match = 0;
+
+    memset((void *)pu64_sel, 0, ((u32_rec_num+63)/64)*sizeof(uint64_t));
+
+    if(NULL == pf_scan)
+        return 0;
+
+    for(uint32_t idx=0, u32_num=0; idx<u32_rec_num; idx+=u32_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+
+        if(NULL == pu8_data)
+            break;
+
+        u32_match += pf_scan(pu8_data, u32_num, u16_rec_len, pst_key, pu64_sel, idx);
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    return u32_match;
+}
+
+static bool _db_scan_key_init(struct db *pst_db, const struct db_scan *pst_scan, struct _db_scan_key *pst_key)
+{
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    struct db_field *pst_field;
+
+    memset((void *)pst_key, 0, sizeof(struct _db_scan_key));
+    pst_key->u8_op = pst_scan->u8_op;
+
+    if(DB_SCAN_DELETED == pst_scan->u8_op)
+        return true;
+
+    if(pst_scan->u32_field_idx >= pst_info->u8_field_num)
+        return false;
+
+    pst_field = pst_info->a_field[pst_scan->u32_field_idx];
+    pst_key->u32_offset = pst_field->u32_acc_len;
+
+    switch(pst_scan->u8_op)
+    {
+        case DB_SCAN_EQ:
+        case DB_SCAN_PREFIX:
+            if((NULL == pst_scan->pu8_key) || (pst_scan->u32_key_len > pst_field->u8_len))
+                return false;
+
+            memcpy((void *)pst_key->au8_key, (void *)pst_scan->pu8_key, pst_scan->u32_key_len);
+            pst_key->u32_len = pst_scan->u32_key_len;
+
+            if(DB_SCAN_EQ == pst_scan->u8_op)
+            {
+                memset((void *)&pst_key->au8_key[pst_scan->u32_key_len], ' ', pst_field->u8_len-pst_scan->u32_key_len);
+                pst_key->u32_len = pst_field->u8_len;
+            }
+
+            return true;
+        case DB_SCAN_DATE_RANGE:
+            if(('D' != toupper(pst_field->u8_type)) || (8 != pst_field->u8_len))
+                return false;
+
+            /* blank dates stay below any lowest date */
+            pst_key->u64_lo = _db_scan_get_be64((const uint8_t *)"00000000");
+            pst_key->u64_hi = _db_scan_get_be64((const uint8_t *)"99999999");
+
+            if(NULL != pst_scan->pu8_key)
+            {
+                if(8 != pst_scan->u32_key_len)
+                    return false;
+
+                pst_key->u64_lo = _db_scan_get_be64(pst_scan->pu8_key);
+            }
+
+            if(NULL != pst_scan->pu8_hi)
+            {
+                if(8 != pst_scan->u32_hi_len)
+                    return false;
+
+                pst_key->u64_hi = _db_scan_get_be64(pst_scan->pu8_hi);
+            }
+
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* a single filter condition a scan kernel can evaluate */
+static bool _db_scan_key_from_filter(const struct db_filter *pst_filter, struct _db_scan_key *pst_key)
+{
+    memset((void *)pst_key, 0, sizeof(struct _db_scan_key));
+    pst_key->u32_offset = pst_filter->u32_offset;
+
+    if(((DB_FILTER_OP_EQ == pst_filter->e_op) || (DB_FILTER_OP_PREFIX == pst_filter->e_op)) &&
+       (DB_FILTER_VAL_RAW == pst_filter->e_val))
+    {
+        pst_key->u8_op = DB_SCAN_PREFIX;
+        pst_key->u32_len = pst_filter->u32_key_len;
+        memcpy((void *)pst_key->au8_key, (void *)pst_filter->pu8_key, pst_filter->u32_key_len);
+        return true;
+    }
+
+    if((DB_FILTER_OP_RANGE == pst_filter->e_op) && (DB_FILTER_VAL_DATE == pst_filter->e_val) && (8 == pst_filter->u8_len))
+    {
+        /* blank dates start with a space or NUL, nothing else sorts below '!' */
+        pst_key->u8_op = DB_SCAN_DATE_RANGE;
+        pst_key->u64_lo = (pst_filter->b_lo)?(_db_scan_get_be64(pst_filter->pu8_key)):(0x2100000000000000ull);
+        pst_key->u64_hi = (pst_filter->b_hi)?(_db_scan_get_be64(&pst_filter->pu8_key[8])):(~0ull);
+        return true;
+    }
+
+    return false;
+}
+
+/* list the set bits of a selection bitmap */
+static void _db_scan_ids(const uint64_t *pu64_sel, uint32_t u32_rec_num, uint32_t *pu32_rec_id, uint32_t u32_max_num)
+{
+    uint32_t u32_found = 0;
+
+    if(NULL == pu32_rec_id)
+        return;
+
+    for(uint32_t u32_word=0; (u32_word<(u32_rec_num+63)/64) && (u32_found<u32_max_num); u32_word++)
+    {
+        for(uint64_t u64_bits=pu64_sel[u32_word]; u64_bits && (u32_found<u32_max_num); u64_bits&=u64_bits-1)
+            pu32_rec_id[u32_found++] = u32_word*64+__builtin_ctzll(u64_bits);
+    }
+}
+
+/* first record from u32_start_idx matching the filter, copied into
+ * pu8_buf unless the records are resident */
+static struct db_record _db_filter_find(
+        struct db *pst_db,
+        uint32_t u32_start_idx,
+        struct db_filter *pst_filter,
+        uint8_t *pu8_buf)
+{
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint8_t *pu8_data;
+
+    for(uint32_t idx=u32_start_idx, u32_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_num)
+    {
+        bool b_pinned;
+
+        pu8_data = _db_rec_acquire_any(pst_db, idx, &u32_num, pu8_buf, &b_pinned);
+        if(NULL == pu8_data)
+            break;
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++, pu8_data+=u16_rec_len)
+        {
+            if(false == db_filter_match(pst_filter, pu8_data))
+                continue;
+
+            if(true == b_pinned)
+            {
+                /* a cache block may be evicted once released, keep a copy */
+                if(NULL == pst_db->pu8_rec_cache)
+                {
+                    memcpy((void *)pu8_buf, (void *)pu8_data, u16_rec_len);
+                    pu8_data = pu8_buf;
+                }
+
+                _db_rec_release(pst_db, idx);
+            }
+
+            return (struct db_record){.u32_rec_id=idx+u32_off,.u32_data_len=u16_rec_len,.pu8_data=pu8_data};
+        }
+
+        if(true == b_pinned)
+            _db_rec_release(pst_db, idx);
+    }
+
+    return (struct db_record){0};
+}
+
+struct db_record db_filter_find(hdb h_db, uint32_t u32_start_idx, hdb_filter h_filter)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if(NULL == h_filter)
+        return (struct db_record){0};
+
+    if(!pst_db->pu8_find_buf)
+    {
+        pst_db->pu8_find_buf = (uint8_t *)malloc(pst_db->st_file_hdr.u16_rec_len);
+        if(!pst_db->pu8_find_buf)
+            return (struct db_record){0};
+    }
+
+    return _db_filter_find(pst_db, u32_start_idx, (struct db_filter *)h_filter, pst_db->pu8_find_buf);
+}
+
+uint32_t db_filter_find_all(
+        hdb h_db,
+        hdb_filter h_filter,
+        uint32_t *pu32_rec_id,
+        uint32_t u32_max_num)
+{
+    struct db *pst_db = (struct db *)h_db;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_found = 0;
+
+    struct _db_scan_key st_key;
+    uint64_t *pu64_sel;
+
+    if(NULL == h_filter)
+        return 0;
+
+    /* a single condition on raw bytes goes through the scan kernels */
+    if(true == _db_scan_key_from_filter((const struct db_filter *)h_filter, &st_key))
+    {
+        pu64_sel = (uint64_t *)malloc(((pst_db->st_file_hdr.u32_rec_num+63)/64+1)*sizeof(uint64_t));
+        if(NULL != pu64_sel)
+        {
+            u32_found = _db_scan_run(pst_db, &st_key, pu64_sel);
+            _db_scan_ids(pu64_sel, pst_db->st_file_hdr.u32_rec_num, pu32_rec_id, u32_max_num);
+            free(pu64_sel);
+
+            return u32_found;
+        }
+    }
+
+    for(uint32_t idx=0, u32_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+
+        if(NULL == pu8_data)
+            break;
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++, pu8_data+=u16_rec_len)
+        {
+            if(false == db_filter_match(h_filter, pu8_data))
+                continue;
+
+            if((NULL != pu32_rec_id) && (u32_found < u32_max_num))
+                pu32_rec_id[u32_found] = idx+u32_off;
+
+            u32_found++;
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    return u32_found;
+}
+
+uint32_t db_scan_bitmap(hdb h_db, const struct db_scan *pst_scan, uint64_t *pu64_sel)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct _db_scan_key st_key;
+
+    if((NULL == pst_scan) || (NULL == pu64_sel))
+        return 0;
+
+    if(false == _db_scan_key_init(pst_db, pst_scan, &st_key))
+    {
+        memset((void *)pu64_sel, 0, ((pst_db->st_file_hdr.u32_rec_num+63)/64)*sizeof(uint64_t));
+        return 0;
+    }
+
+    return _db_scan_run(pst_db, &st_key, pu64_sel);
+}
+
+uint32_t db_scan_ids(
+        hdb h_db,
+        const struct db_scan *pst_scan,
+        uint32_t *pu32_rec_id,
+        uint32_t u32_max_num)
+{
+    struct db *pst_db = (struct db *)h_db;
+    uint64_t *pu64_sel;
+    uint32_t u32_found;
+
+    pu64_sel = (uint64_t *)malloc(((pst_db->st_file_hdr.u32_rec_num+63)/64+1)*sizeof(uint64_t));
+    if(!pu64_sel)
+        return 0;
+
+    u32_found = db_scan_bitmap(h_db, pst_scan, pu64_sel);
+    _db_scan_ids(pu64_sel, pst_db->st_file_hdr.u32_rec_num, pu32_rec_id, u32_max_num);
+
+    free(pu64_sel);
+
+    return u32_found;
+}
+
+bool db_itor_set_filter(hdb h_db, hdb_filter h_filter)
+{
+    struct db_itor *pst_itor = ((struct db *)h_db)->pst_itor;
+
+    if(NULL == pst_itor)
+        return false;
+
+    pst_itor->pst_filter = (struct db_filter *)h_filter;
+
+    return true;
+}
+
+static bool _db_column_init(
+        const struct db_field *pst_field,
+        uint32_t u32_field_idx,
+        uint32_t u32_row_num,
+        struct db_column *pst_column)
+{
+    uint8_t u8_type = toupper(pst_field->u8_type);
+
+    memset((void *)pst_column, 0, sizeof(struct db_column));
+    pst_column->u32_field_idx = u32_field_idx;
+    pst_column->u32_row_num = u32_row_num;
+
+    /* binary types of another length are copied as they are */
+    if((('I' == u8_type) || ('B' == u8_type) || ('Y' == u8_type) || ('T' == u8_type)) &&
+       (false == _db_bin_len_ok(pst_field)))
+        u8_type = 0;
+
+    switch(u8_type)
+    {
+        case 'N':
+            pst_column->u8_type = (0 == pst_field->u8_dec)?(DB_COLUMN_INT64):(DB_COLUMN_DOUBLE);
+            pst_column->u32_width = 8;
+            break;
+        case 'F':
+            pst_column->u8_type = DB_COLUMN_DOUBLE;
+            pst_column->u32_width = 8;
+            break;
+        case 'D':
+            pst_column->u8_type = DB_COLUMN_DATE;
+            pst_column->u32_width = 4;
+            break;
+        case 'I':
+        case 'Y':
+            pst_column->u8_type = DB_COLUMN_INT64;
+            pst_column->u32_width = 8;
+            break;
+        case 'B':
+            pst_column->u8_type = DB_COLUMN_DOUBLE;
+            pst_column->u32_width = 8;
+            break;
+        case 'T':
+            pst_column->u8_type = DB_COLUMN_TIME;
+            pst_column->u32_width = 8;
+            break;
+        case 'L':
+            pst_column->u8_type = DB_COLUMN_BOOL;
+            pst_column->u32_width = 1;
+            break;
+        default:
+            pst_column->u8_type = DB_COLUMN_STR;
+            pst_column->u32_width = pst_field->u8_len;
+            break;
+    }
+
+    pst_column->pv_data = malloc((size_t)u32_row_num*pst_column->u32_width+1);
+    pst_column->pu8_null = (uint8_t *)calloc(u32_row_num+1, 1);
+    pst_column->pu8_deleted = (uint8_t *)malloc(u32_row_num+1);
+
+    if(DB_COLUMN_STR == pst_column->u8_type)
+        pst_column->pu16_len = (uint16_t *)malloc((u32_row_num+1)*sizeof(uint16_t));
+
+    return pst_column->pv_data && pst_column->pu8_null && pst_column->pu8_deleted &&
+           ((DB_COLUMN_STR != pst_column->u8_type) || pst_column->pu16_len);
+}
+
+/* decode one field of u32_num records into rows from u32_row */
+static void _db_column_fill(
+        const struct db_field *pst_field,
+        const uint8_t *pu8_data,
+        uint32_t u32_num,
+        uint16_t u16_rec_len,
+        struct db_column *pst_column,
+        uint32_t u32_row)
+{
+    uint8_t *pu8_null = &pst_column->pu8_null[u32_row];
+
+    for(uint32_t idx=0; idx<u32_num; idx++)
+        pst_column->pu8_deleted[u32_row+idx] = ('*' == pu8_data[(size_t)idx*u16_rec_len]);
+
+    pu8_data += pst_field->u32_acc_len;
+
+    switch(pst_column->u8_type)
+    {
+        case DB_COLUMN_STR:
+            {
+                uint8_t *pu8_out = (uint8_t *)pst_column->pv_data+(size_t)u32_row*pst_column->u32_width;
+                uint16_t *pu16_len = &pst_column->pu16_len[u32_row];
+                bool b_text = ('C' == toupper(pst_field->u8_type));
+
+                for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len, pu8_out+=pst_column->u32_width)
+                {
+                    uint32_t u32_len = pst_field->u8_len;
+
+                    memcpy((void *)pu8_out, (void *)pu8_data, u32_len);
+
+                    while((u32_len > 0) && ((' ' == pu8_data[u32_len-1]) || ('\0' == pu8_data[u32_len-1])))
+                        u32_len--;
+
+                    /* only text is trimmed, a blank value of any type is null */
+                    pu8_null[idx] = (0 == u32_len);
+                    pu16_len[idx] = (true == b_text)?(u32_len):(pst_field->u8_len);
+                }
+            }
+            break;
+        case DB_COLUMN_INT64:
+            {
+                int64_t *pi64_out = &((int64_t *)pst_column->pv_data)[u32_row];
+                uint8_t u8_type = toupper(pst_field->u8_type);
+
+                for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+                {
+                    int8_t i8_rest;
+
+                    if('I' == u8_type)
+                        pi64_out[idx] = (int32_t)_db_get_le32(pu8_data);
+                    else if('Y' == u8_type)
+                        pi64_out[idx] = (int64_t)_db_get_le64(pu8_data);
+                    else
+                    {
+                        pi64_out[idx] = 0;
+                        pu8_null[idx] = !_db_filter_num_parse(pu8_data, pst_field->u8_len, 0, &pi64_out[idx], &i8_rest);
+                    }
+                }
+            }
+            break;
+        case DB_COLUMN_DOUBLE:
+            {
+                double *pd_out = &((double *)pst_column->pv_data)[u32_row];
+                bool b_binary = ('B' == toupper(pst_field->u8_type));
+
+                for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+                {
+                    if(true == b_binary)
+                    {
+                        uint64_t u64_val = _db_get_le64(pu8_data);
+
+                        memcpy((void *)&pd_out[idx], (void *)&u64_val, sizeof(double));
+                        continue;
+                    }
+
+                    pd_out[idx] = 0;
+                    pu8_null[idx] = !_db_num_parse_double(pu8_data, pst_field->u8_len, &pd_out[idx]);
+                }
+            }
+            break;
+        case DB_COLUMN_TIME:
+            {
+                int64_t *pi64_out = &((int64_t *)pst_column->pv_data)[u32_row];
+
+                for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+                {
+                    pi64_out[idx] = 0;
+                    pu8_null[idx] = !_db_time_to_epoch_ms(pu8_data, &pi64_out[idx]);
+                }
+            }
+            break;
+        case DB_COLUMN_DATE:
+            {
+                int32_t *pi32_out = &((int32_t *)pst_column->pv_data)[u32_row];
+
+                for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+                {
+                    bool b_valid = (8 == pst_field->u8_len);
+                    uint16_t u16_year = 0;
+                    uint8_t u8_month = 0;
+                    uint8_t u8_day = 0;
+
+                    for(int i=0; (i<8) && (true == b_valid); i++)
+                        b_valid = isdigit(pu8_data[i]);
+
+                    if(true == b_valid)
+                    {
+                        u16_year = (pu8_data[0]-'0')*1000+(pu8_data[1]-'0')*100+(pu8_data[2]-'0')*10+(pu8_data[3]-'0');
+                        u8_month = (pu8_data[4]-'0')*10+(pu8_data[5]-'0');
+                        u8_day = (pu8_data[6]-'0')*10+(pu8_data[7]-'0');
+                        b_valid = _db_date_valid(u16_year, u8_month, u8_day);
+                    }
+
+                    pu8_null[idx] = !b_valid;
+                    pi32_out[idx] = (false == b_valid)?(0):((int32_t)_db_date_to_JD(u16_year, u8_month, u8_day)-DB_JD_EPOCH);
+                }
+            }
+            break;
+        case DB_COLUMN_BOOL:
+            {
+                uint8_t *pu8_out = &((uint8_t *)pst_column->pv_data)[u32_row];
+
+                for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+                {
+                    switch(pu8_data[0])
+                    {
+                        case 'T': case 't': case 'Y': case 'y':
+                            pu8_out[idx] = 1;
+                            break;
+                        case 'F': case 'f': case 'N': case 'n':
+                            pu8_out[idx] = 0;
+                            break;
+                        default:
+                            pu8_out[idx] = 0;
+                            pu8_null[idx] = 1;
+                            break;
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool db_project(
+        hdb h_db,
+        const uint32_t *au32_field_idx,
+        uint32_t u32_column_num,
+        uint32_t u32_first_id,
+        uint32_t u32_row_num,
+        struct db_column *ast_column)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_end;
+
+    if((NULL == au32_field_idx) || (NULL == ast_column) || (u32_first_id > u32_rec_num))
+        return false;
+
+    if((0 == u32_row_num) || (u32_row_num > u32_rec_num-u32_first_id))
+        u32_row_num = u32_rec_num-u32_first_id;
+
+    u32_end = u32_first_id+u32_row_num;
+
+    for(uint32_t idx=0; idx<u32_column_num; idx++)
+    {
+        if(au32_field_idx[idx] >= pst_info->u8_field_num)
+        {
+            db_column_free(ast_column, idx);
+            return false;
+        }
+
+        if(false == _db_column_init(pst_info->a_field[au32_field_idx[idx]], au32_field_idx[idx], u32_row_num, &ast_column[idx]))
+        {
+            db_column_free(ast_column, idx+1);
+            return false;
+        }
+    }
+
+    /* a block at a time, one column after the other while it is hot */
+    for(uint32_t idx=u32_first_id, u32_num=0; idx<u32_end; idx+=u32_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+
+        if(NULL == pu8_data)
+        {
+            db_column_free(ast_column, u32_column_num);
+            return false;
+        }
+
+        if(u32_num > u32_end-idx)
+            u32_num = u32_end-idx;
+
+        for(uint32_t u32_col=0; u32_col<u32_column_num; u32_col++)
+        {
+            _db_column_fill(
+                    pst_info->a_field[au32_field_idx[u32_col]],
+                    pu8_data,
+                    u32_num,
+                    u16_rec_len,
+                    &ast_column[u32_col],
+                    idx-u32_first_id);
+        }
+
+        _db_rec_release(pst_db, idx);
+    }
+
+    return true;
+}
+
+void db_column_free(struct db_column *ast_column, uint32_t u32_column_num)
+{
+    if(!ast_column)
+        return;
+
+    for(uint32_t idx=0; idx<u32_column_num; idx++)
+    {
+        free(ast_column[idx].pv_data);
+        free(ast_column[idx].pu16_len);
+        free(ast_column[idx].pu8_null);
+        free(ast_column[idx].pu8_deleted);
+        memset((void *)&ast_column[idx], 0, sizeof(struct db_column));
+    }
+}
+
+/* N or F field of a record, NULL for other types */
+static const struct db_field *_db_num_field(struct db *pst_db, uint32_t u32_field_idx)
+{
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    const struct db_field *pst_field;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return NULL;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    if(('N' != toupper(pst_field->u8_type)) && ('F' != toupper(pst_field->u8_type)))
+        return NULL;
+
+    return pst_field;
+}
+
+/* field of a binary type with its fixed length, NULL otherwise */
+static const struct db_field *_db_bin_field(struct db *pst_db, uint32_t u32_field_idx, uint8_t u8_type)
+{
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    const struct db_field *pst_field;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return NULL;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    if((u8_type != toupper(pst_field->u8_type)) || (false == _db_bin_len_ok(pst_field)))
+        return NULL;
+
+    return pst_field;
+}
+
+/* C field, NULL otherwise */
+static const struct db_field *_db_str_field(struct db *pst_db, uint32_t u32_field_idx)
+{
+    struct db_field_info *pst_info = &pst_db->st_field_info;
+    const struct db_field *pst_field;
+
+    if(u32_field_idx >= pst_info->u8_field_num)
+        return NULL;
+
+    pst_field = pst_info->a_field[u32_field_idx];
+    if('C' != toupper(pst_field->u8_type))
+        return NULL;
+
+    return pst_field;
+}
+
+bool db_field_get_fixed(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        uint8_t u8_scale,
+        int64_t *pi64_val)
+{
+    const struct db_field *pst_field = _db_num_field((struct db *)h_db, u32_field_idx);
+    int8_t i8_rest;
+
+    if((NULL == pst_field) || (NULL == pu8_rec_data) || (NULL == pi64_val))
+        return false;
+
+    return _db_filter_num_parse(&pu8_rec_data[pst_field->u32_acc_len], pst_field->u8_len, u8_scale, pi64_val, &i8_rest);
+}
+
+bool db_field_get_int64(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int64_t *pi64_val)
+{
+    return db_field_get_fixed(h_db, pu8_rec_data, u32_field_idx, 0, pi64_val);
+}
+
+bool db_field_get_double(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        double *pd_val)
+{
+    const struct db_field *pst_field = _db_bin_field((struct db *)h_db, u32_field_idx, 'B');
+    uint64_t u64_val;
+
+    if((NULL != pst_field) && (NULL != pu8_rec_data) && (NULL != pd_val))
+    {
+        u64_val = _db_get_le64(&pu8_rec_data[pst_field->u32_acc_len]);
+        memcpy((void *)pd_val, (void *)&u64_val, sizeof(double));
+        return true;
+    }
+
+    pst_field = _db_num_field((struct db *)h_db, u32_field_idx);
+
+    if((NULL == pst_field) || (NULL == pu8_rec_data) || (NULL == pd_val))
+        return false;
+
+    return _db_num_parse_double(&pu8_rec_data[pst_field->u32_acc_len], pst_field->u8_len, pd_val);
+}
+
+bool db_field_get_int32(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int32_t *pi32_val)
+{
+    const struct db_field *pst_field = _db_bin_field((struct db *)h_db, u32_field_idx, 'I');
+
+    if((NULL == pst_field) || (NULL == pu8_rec_data) || (NULL == pi32_val))
+        return false;
+
+    *pi32_val = (int32_t)_db_get_le32(&pu8_rec_data[pst_field->u32_acc_len]);
+    return true;
+}
+
+bool db_field_get_currency(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int64_t *pi64_val)
+{
+    const struct db_field *pst_field = _db_bin_field((struct db *)h_db, u32_field_idx, 'Y');
+
+    if((NULL == pst_field) || (NULL == pu8_rec_data) || (NULL == pi64_val))
+        return false;
+
+    *pi64_val = (int64_t)_db_get_le64(&pu8_rec_data[pst_field->u32_acc_len]);
+    return true;
+}
+
+bool db_field_get_time(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int64_t *pi64_ms)
+{
+    const struct db_field *pst_field = _db_bin_field((struct db *)h_db, u32_field_idx, 'T');
+
+    if((NULL == pst_field) || (NULL == pu8_rec_data) || (NULL == pi64_ms))
+        return false;
+
+    return _db_time_to_epoch_ms(&pu8_rec_data[pst_field->u32_acc_len], pi64_ms);
+}
+
+/* decode a N/F field of a record range into caller arrays, a record
+ * block at a time; pi64_val selects fixed point, pd_val double */
+static uint32_t _db_column_get_num(
+        struct db *pst_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        uint8_t u8_scale,
+        int64_t *pi64_val,
+        double *pd_val,
+        uint8_t *pu8_null)
+{
+    const struct db_field *pst_field = _db_num_field(pst_db, u32_field_idx);
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_done = 0;
+
+    if((NULL == pst_field) || (u32_first_id >= u32_rec_num))
+        return 0;
+
+    if(u32_num > u32_rec_num-u32_first_id)
+        u32_num = u32_rec_num-u32_first_id;
+
+    while(u32_done < u32_num)
+    {
+        uint32_t u32_blk_num;
+        const uint8_t *pu8_data = _db_rec_acquire(pst_db, u32_first_id+u32_done, &u32_blk_num);
+
+        if(NULL == pu8_data)
+            break;
+
+        if(u32_blk_num > u32_num-u32_done)
+            u32_blk_num = u32_num-u32_done;
+
+        pu8_data += pst_field->u32_acc_len;
+
+        for(uint32_t idx=u32_done; idx<u32_done+u32_blk_num; idx++, pu8_data+=u16_rec_len)
+        {
+            bool b_valid;
+            int8_t i8_rest;
+
+            if(NULL != pi64_val)
+            {
+                pi64_val[idx] = 0;
+                b_valid = _db_filter_num_parse(pu8_data, pst_field->u8_len, u8_scale, &pi64_val[idx], &i8_rest);
+            }
+            else
+            {
+                pd_val[idx] = 0;
+                b_valid = _db_num_parse_double(pu8_data, pst_field->u8_len, &pd_val[idx]);
+            }
+
+            if(NULL != pu8_null)
+                pu8_null[idx] = !b_valid;
+        }
+
+        _db_rec_release(pst_db, u32_first_id+u32_done);
+        u32_done += u32_blk_num;
+    }
+
+    return u32_done;
+}
+
+uint32_t db_column_get_fixed(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        uint8_t u8_scale,
+        int64_t *pi64_val,
+        uint8_t *pu8_null)
+{
+    if(NULL == pi64_val)
+        return 0;
+
+    return _db_column_get_num((struct db *)h_db, u32_field_idx, u32_first_id, u32_num, u8_scale, pi64_val, NULL, pu8_null);
+}
+
+uint32_t db_column_get_double(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        double *pd_val,
+        uint8_t *pu8_null)
+{
+    if(NULL == pd_val)
+        return 0;
+
+    return _db_column_get_num((struct db *)h_db, u32_field_idx, u32_first_id, u32_num, 0, NULL, pd_val, pu8_null);
+}
+
+bool db_field_get_utf8(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len,
+        uint32_t *pu32_len)
+{
+    struct db *pst_db = (struct db *)h_db;
+    const struct db_field *pst_field = _db_str_field(pst_db, u32_field_idx);
+    const uint8_t *pu8_data;
+    uint32_t u32_len;
+    uint32_t u32_used;
+
+    if((NULL == pst_field) || (NULL == pu8_rec_data) || (NULL == pu8_buf) || (NULL == pu32_len))
+        return false;
+
+    pu8_data = _db_field_trim(pst_field, pu8_rec_data+pst_field->u32_acc_len, &u32_len);
+    *pu32_len = db_cp_to_utf8(pst_db->u8_code_page, pu8_data, u32_len, pu8_buf, u32_buf_len, &u32_used);
+
+    return (u32_used == u32_len);
+}
+
+uint32_t db_column_get_utf8(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len,
+        uint32_t *pu32_offset)
+{
+    struct db *pst_db = (struct db *)h_db;
+    const struct db_field *pst_field = _db_str_field(pst_db, u32_field_idx);
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint16_t u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+    uint32_t u32_done = 0;
+    uint32_t u32_out = 0;
+    bool b_full = false;
+
+    if((NULL == pst_field) || (NULL == pu8_buf) || (NULL == pu32_offset) || (u32_first_id >= u32_rec_num))
+        return 0;
+
+    if(u32_num > u32_rec_num-u32_first_id)
+        u32_num = u32_rec_num-u32_first_id;
+
+    pu32_offset[0] = 0;
+
+    while((u32_done < u32_num) && (false == b_full))
+    {
+        uint32_t u32_blk_num;
+        const uint8_t *pu8_data = _db_rec_acquire(pst_db, u32_first_id+u32_done, &u32_blk_num);
+
+        if(NULL == pu8_data)
+            break;
+
+        if(u32_blk_num > u32_num-u32_done)
+            u32_blk_num = u32_num-u32_done;
+
+        pu8_data += pst_field->u32_acc_len;
+
+        for(uint32_t idx=0; idx<u32_blk_num; idx++, pu8_data+=u16_rec_len)
+        {
+            const uint8_t *pu8_text;
+            uint32_t u32_len;
+            uint32_t u32_used;
+
+            pu8_text = _db_field_trim(pst_field, pu8_data, &u32_len);
+            u32_out += db_cp_to_utf8(pst_db->u8_code_page, pu8_text, u32_len, &pu8_buf[u32_out], u32_buf_len-u32_out, &u32_used);
+
+            /* only whole texts are returned */
+            if(u32_used < u32_len)
+            {
+                u32_blk_num = idx;
+                b_full = true;
+                break;
+            }
+
+            pu32_offset[u32_done+idx+1] = u32_out;
+        }
+
+        _db_rec_release(pst_db, u32_first_id+u32_done);
+        u32_done += u32_blk_num;
+    }
+
+    return u32_done;
+}
+
+bool db_itor_init(hdb h_db, db_pf_itor pf_itor, void * pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_itor *pst_itor = pst_db->pst_itor;
+
+    if(NULL == pst_itor)
+    {
+        pst_itor = (struct db_itor *)malloc(sizeof(struct db_itor));
+        if(!pst_itor)
+            return false;
+
+        pst_itor->u32_buf_len = pst_db->st_file_hdr.u16_rec_len;
+        pst_itor->pu8_buf = (uint8_t *)malloc(pst_itor->u32_buf_len);
+        if(!pst_itor->pu8_buf)
+        {
+            free(pst_itor);
+            return false;
+        }
+
+        pst_itor->pst_filter = NULL;
+
+        pst_db->pst_itor = pst_itor;
+    }
+
+    /* a repeated init replaces the callback of the previous one */
+    pst_itor->pf_itor = pf_itor;
+    pst_itor->pv_usr_data = pv_usr_data;
+
+    return true;
+}
+
+/* pass records from *pu32_pos on to pf_itor, in place when they can be
+ * pinned, otherwise one by one through pu8_buf. *pu32_pos is left at
+ * the record after the last one visited */
+static bool _db_itor_run(
+        struct db *pst_db,
+        uint32_t *pu32_pos,
+        struct db_filter *pst_filter,
+        uint8_t *pu8_buf,
+        db_pf_itor pf_itor,
+        void *pv_usr_data)
+{
+    struct db_record st_record;
+    uint32_t idx = *pu32_pos;
+
+    st_record.u32_data_len = pst_db->st_file_hdr.u16_rec_len;
+
+    for(uint32_t u32_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_num)
+    {
+        bool b_pinned;
+        uint8_t *pu8_data = _db_rec_acquire_any(pst_db, idx, &u32_num, pu8_buf, &b_pinned);
+
+        if(NULL == pu8_data)
+        {
+            *pu32_pos = idx;
+            return false;
+        }
+
+        for(uint32_t u32_off=0; u32_off<u32_num; u32_off++)
+        {
+            st_record.pu8_data = &pu8_data[u32_off*st_record.u32_data_len];
+            st_record.u32_rec_id = idx+u32_off;
+
+            if((NULL != pst_filter) && (false == db_filter_match(pst_filter, st_record.pu8_data)))
+                continue;
+
+            if(false == pf_itor((hdb)pst_db, &st_record, pv_usr_data))
+            {
+                if(true == b_pinned)
+                    _db_rec_release(pst_db, idx);
+
+                *pu32_pos = idx+u32_off+1;
+                return false;
+            }
+        }
+
+        if(true == b_pinned)
+            _db_rec_release(pst_db, idx);
+    }
+
+    *pu32_pos = idx;
+    return true;
+}
+
+bool db_itor_start(hdb h_db)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_itor *pst_itor = pst_db->pst_itor;
+    uint32_t u32_pos = 0;
+
+    if(NULL == pst_itor)
+        return false;
+
+    return _db_itor_run(
+            pst_db,
+            &u32_pos,
+            pst_itor->pst_filter,
+            pst_itor->pu8_buf,
+            pst_itor->pf_itor,
+            pst_itor->pv_usr_data);
+}
+
+bool db_itor_start_batch(hdb h_db, uint32_t u32_max_num, db_pf_batch pf_batch, void *pv_usr_data)
+{
+    struct db *pst_db = (struct db *)h_db;
+
+    if(NULL == pf_batch)
+        return false;
+
+    for(uint32_t idx=0, u32_num=0; idx<pst_db->st_file_hdr.u32_rec_num; idx+=u32_num)
+    {
+        uint8_t *pu8_data = _db_rec_acquire(pst_db, idx, &u32_num);
+        bool b_ret = true;
+
+        if(NULL == pu8_data)
+            return false;
+
+        if((0 != u32_max_num) && (u32_num > u32_max_num))
+            u32_num = u32_max_num;
+
+        b_ret = pf_batch(h_db, pu8_data, u32_num, idx, pv_usr_data);
+
+        _db_rec_release(pst_db, idx);
+
+        if(false == b_ret)
+            return false;
+    }
+
+    return true;
+}
+
+/* callback of the parallel chunk runner, pu8_data holds u32_num
+ * records starting from u32_first_id; u32_num is 0 when none of the
+ * chunk could be read */
+typedef bool (*_db_pf_chunk)(
+        struct db *pst_db,
+        const uint8_t *pu8_data,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        void *pv_usr_data);
+
+struct db_par
+{
+    struct db *pst_db;
+    _db_pf_chunk pf_chunk;
+    void *pv_usr_data;
+
+    uint32_t u32_chunk_rec_num;
+    uint32_t u32_chunk_num;
+
+    /* next chunk to claim and the stop request of any worker */
+    uint32_t u32_next;
+    bool b_stop;
+};
+
+static void *_db_par_worker(void *pv_arg)
+{
+    struct db_par *pst_par = (struct db_par *)pv_arg;
+    struct db *pst_db = pst_par->pst_db;
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    uint8_t *pu8_buf = NULL;
+
+    /* without a resident copy each worker reads its chunks into its
+     * own buffer instead of sharing the block cache */
+    if(NULL == pst_db->pu8_rec_cache)
+    {
+        pu8_buf = (uint8_t *)malloc((size_t)pst_par->u32_chunk_rec_num*pst_hdr->u16_rec_len);
+        if(!pu8_buf)
+        {
+            __atomic_store_n(&pst_par->b_stop, true, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    }
+
+    while(false == __atomic_load_n(&pst_par->b_stop, __ATOMIC_RELAXED))
+    {
+        uint32_t u32_chunk = __atomic_fetch_add(&pst_par->u32_next, 1, __ATOMIC_RELAXED);
+        uint32_t u32_first = u32_chunk*pst_par->u32_chunk_rec_num;
+        uint32_t u32_num = pst_par->u32_chunk_rec_num;
+        const uint8_t *pu8_data;
+
+        if(u32_chunk >= pst_par->u32_chunk_num)
+            break;
+
+        if(u32_num > pst_hdr->u32_rec_num-u32_first)
+            u32_num = pst_hdr->u32_rec_num-u32_first;
+
+        if(NULL != pst_db->pu8_rec_cache)
+        {
+            pu8_data = &pst_db->pu8_rec_cache[(size_t)u32_first*pst_hdr->u16_rec_len];
+        }
+        else
+        {
+            ssize_t t_read = pread(
+                    fileno(pst_db->pf_db),
+                    (void *)pu8_buf,
+                    (size_t)u32_num*pst_hdr->u16_rec_len,
+                    pst_hdr->u16_hdr_len+(off_t)u32_first*pst_hdr->u16_rec_len);
+
+            /* drop records cut off by a truncated file */
+            if((t_read < 0) || ((size_t)t_read < (size_t)u32_num*pst_hdr->u16_rec_len))
+            {
+                u32_num = (t_read > 0)?(t_read/pst_hdr->u16_rec_len):(0);
+                __atomic_store_n(&pst_par->b_stop, true, __ATOMIC_RELAXED);
+            }
+
+            pu8_data = pu8_buf;
+        }
+
+        if(false == pst_par->pf_chunk(pst_db, pu8_data, u32_first, u32_num, pst_par->pv_usr_data))
+            __atomic_store_n(&pst_par->b_stop, true, __ATOMIC_RELAXED);
+    }
+
+    free(pu8_buf);
+
+    return NULL;
+}
+
+/* records of a parallel chunk, a multiple of 64 */
+static uint32_t _db_par_chunk_rec_num(const struct db_file_hdr *pst_hdr)
+{
+    uint32_t u32_num = (pst_hdr->u16_rec_len)?((DB_PAR_CHUNK_SIZE/pst_hdr->u16_rec_len)&~63u):(0);
+
+    return (0 != u32_num)?(u32_num):(64);
+}
+
+/* split the records into chunks and run pf_chunk on them from
+ * u32_worker_num threads, false if any chunk asked to stop */
+static bool _db_par_run(
+        struct db *pst_db,
+        uint32_t u32_worker_num,
+        _db_pf_chunk pf_chunk,
+        void *pv_usr_data)
+{
+    struct db_file_hdr *pst_hdr = &pst_db->st_file_hdr;
+    pthread_t at_thread[DB_PAR_MAX_WORKER];
+    struct db_par st_par;
+    uint32_t u32_started = 0;
+
+    if(0 == pst_hdr->u16_rec_len)
+        return false;
+
+    memset((void *)&st_par, 0, sizeof(st_par));
+    st_par.pst_db = pst_db;
+    st_par.pf_chunk = pf_chunk;
+    st_par.pv_usr_data = pv_usr_data;
+    st_par.u32_chunk_rec_num = _db_par_chunk_rec_num(pst_hdr);
+    st_par.u32_chunk_num = (pst_hdr->u32_rec_num+st_par.u32_chunk_rec_num-1)/st_par.u32_chunk_rec_num;
+
+    if(0 == u32_worker_num)
+    {
+        long l_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+        u32_worker_num = (l_cpu > 0)?(l_cpu):(1);
+    }
+
+    if(u32_worker_num > DB_PAR_MAX_WORKER)
+        u32_worker_num = DB_PAR_MAX_WORKER;
+
+    if(u32_worker_num > st_par.u32_chunk_num)
+        u32_worker_num = st_par.u32_chunk_num;
+
+    /* the calling thread works too */
+    for(; u32_started+1<u32_worker_num; u32_started++)
+    {
+        if(0 != pthread_create(&at_thread[u32_started], NULL, _db_par_worker, (void *)&st_par))
+            break;
+    }
+
+    _db_par_worker((void *)&st_par);
+
+    for(uint32_t idx=0; idx<u32_started; idx++)
+        pthread_join(at_thread[idx], NULL);
+
+    return !st_par.b_stop;
+}
+
+struct _db_par_itor
+{
+    db_pf_itor pf_itor;
+    void *pv_usr_data;
+    struct db_filter *pst_filter;
+
+    /* records selected by the iterator, NULL without merge */
+    uint64_t *pu64_sel;
+};
+
+static bool _db_par_itor_chunk(
+        struct db *pst_db,
+        const uint8_t *pu8_data,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        void *pv_usr_data)
+{
+    struct _db_par_itor *pst_ctx = (struct _db_par_itor *)pv_usr_data;
+    struct db_record st_record;
+
+    st_record.u32_data_len = pst_db->st_file_hdr.u16_rec_len;
+
+    for(uint32_t idx=0; idx<u32_num; idx++)
+    {
+        bool b_ret;
+
+        st_record.pu8_data = (uint8_t *)&pu8_data[(size_t)idx*st_record.u32_data_len];
+        st_record.u32_rec_id = u32_first_id+idx;
+
+        if((NULL != pst_ctx->pst_filter) && (false == db_filter_match(pst_ctx->pst_filter, st_record.pu8_data)))
+            continue;
+
+        b_ret = pst_ctx->pf_itor((hdb)pst_db, &st_record, pst_ctx->pv_usr_data);
+
+        /* chunks start on a word boundary, no other worker shares it */
+        if(NULL != pst_ctx->pu64_sel)
+        {
+            if(true == b_ret)
+                pst_ctx->pu64_sel[st_record.u32_rec_id/64] |= 1ull<<(st_record.u32_rec_id%64);
+        }
+        else if(false == b_ret)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool db_itor_start_parallel(hdb h_db, uint32_t u32_worker_num, db_pf_itor pf_merge)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_itor *pst_itor = pst_db->pst_itor;
+    struct _db_par_itor st_ctx;
+    struct db_record st_record;
+    uint32_t u32_rec_num = pst_db->st_file_hdr.u32_rec_num;
+    uint32_t u32_word_num = (u32_rec_num+63)/64;
+    bool b_ret;
+
+    if(NULL == pst_itor)
+        return false;
+
+    st_ctx.pf_itor = pst_itor->pf_itor;
+    st_ctx.pv_usr_data = pst_itor->pv_usr_data;
+    st_ctx.pst_filter = pst_itor->pst_filter;
+    st_ctx.pu64_sel = NULL;
+
+    if(NULL != pf_merge)
+    {
+        st_ctx.pu64_sel = (uint64_t *)calloc(u32_word_num+1, sizeof(uint64_t));
+        if(!st_ctx.pu64_sel)
+            return false;
+    }
+
+    b_ret = _db_par_run(pst_db, u32_worker_num, _db_par_itor_chunk, (void *)&st_ctx);
+
+    if(NULL == pf_merge)
+        return b_ret;
+
+    /* hand the selected records to the merge callback in record order */
+    st_record.u32_data_len = pst_itor->u32_buf_len;
+
+    for(uint32_t u32_word=0; (true == b_ret) && (u32_word<u32_word_num); u32_word++)
+    {
+        uint64_t u64_bits = st_ctx.pu64_sel[u32_word];
+
+        while(u64_bits)
+        {
+            st_record.u32_rec_id = u32_word*64+__builtin_ctzll(u64_bits);
+            st_record.pu8_data = _db_rec_fetch(pst_db, st_record.u32_rec_id, pst_itor->pu8_buf);
+            u64_bits &= u64_bits-1;
+
+            if(NULL == st_record.pu8_data)
+                continue;
+
+            if(false == pf_merge(h_db, &st_record, st_ctx.pv_usr_data))
+            {
+                b_ret = false;
+                break;
+            }
+        }
+    }
+
+    free(st_ctx.pu64_sel);
+
+    return b_ret;
+}
+
+bool db_itor_deinit(hdb h_db)
+{
+    struct db_itor *pst_itor = ((struct db *)h_db)->pst_itor;
+
+    if(pst_itor)
+    {
+        free(pst_itor->pu8_buf);
+        free(pst_itor);
+        ((struct db *)h_db)->pst_itor = NULL;
+    }
+
+    return true;
+}
+
+hdb_cursor db_cursor_open(hdb h_db)
+{
+    struct db *pst_db = (struct db *)h_db;
+    struct db_cursor *pst_cursor;
+
+    if(INVALID_DB_HANDLE == h_db)
+        return NULL;
+
+    pst_cursor = (struct db_cursor *)calloc(1, sizeof(struct db_cursor));
+    if(!pst_cursor)
+        return NULL;
+
+    pst_cursor->pst_db = pst_db;
+    pst_cursor->u32_buf_len = pst_db->st_file_hdr.u16_rec_len;
+    pst_cursor->pu8_buf = (uint8_t *)malloc(pst_cursor->u32_buf_len);
+    if(!pst_cursor->pu8_buf)
+    {
+        free(pst_cursor);
+        return NULL;
+    }
+
+    return (hdb_cursor)pst_cursor;
+}
+
+bool db_cursor_close(hdb_cursor h_cursor)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+
+    if(NULL == pst_cursor)
+        return false;
+
+    free(pst_cursor->pu8_buf);
+    free(pst_cursor->pu8_batch);
+    free(pst_cursor);
+
+    return true;
+}
+
+bool db_cursor_set_filter(hdb_cursor h_cursor, hdb_filter h_filter)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+
+    if(NULL == pst_cursor)
+        return false;
+
+    pst_cursor->pst_filter = (struct db_filter *)h_filter;
+
+    return true;
+}
+
+bool db_cursor_rewind(hdb_cursor h_cursor)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+
+    if(NULL == pst_cursor)
+        return false;
+
+    pst_cursor->u32_pos = 0;
+
+    return true;
+}
+
+struct db_record db_cursor_find(
+        hdb_cursor h_cursor,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+    struct db_record st_record;
+
+    if((NULL == pst_cursor) || (u32_field_idx >= pst_cursor->pst_db->st_field_info.u8_field_num) || (NULL == pu8_key))
+        return (struct db_record){0};
+
+    /* trailing spaces of the key are padding as in the field */
+    while((u32_key_len > 0) && (' ' == pu8_key[u32_key_len-1]))
+        u32_key_len--;
+
+    for(;;)
+    {
+        st_record = _db_record_find_key(
+                pst_cursor->pst_db,
+                pst_cursor->u32_pos,
+                u32_field_idx,
+                pu8_key,
+                u32_key_len,
+                pst_cursor->pu8_buf);
+
+        if(NULL == st_record.pu8_data)
+        {
+            pst_cursor->u32_pos = pst_cursor->pst_db->st_file_hdr.u32_rec_num;
+            return st_record;
+        }
+
+        pst_cursor->u32_pos = st_record.u32_rec_id+1;
+
+        if((NULL == pst_cursor->pst_filter) || (true == db_filter_match(pst_cursor->pst_filter, st_record.pu8_data)))
+            return st_record;
+    }
+}
+
+struct db_record db_cursor_find_filter(hdb_cursor h_cursor)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+    struct db_record st_record;
+
+    if((NULL == pst_cursor) || (NULL == pst_cursor->pst_filter))
+        return (struct db_record){0};
+
+    st_record = _db_filter_find(
+            pst_cursor->pst_db,
+            pst_cursor->u32_pos,
+            pst_cursor->pst_filter,
+            pst_cursor->pu8_buf);
+
+    pst_cursor->u32_pos = (NULL == st_record.pu8_data)?
+                            (pst_cursor->pst_db->st_file_hdr.u32_rec_num):
+                            (st_record.u32_rec_id+1);
+
+    return st_record;
+}
+
+bool db_cursor_seek(hdb_cursor h_cursor, uint32_t u32_rec_id)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+
+    if((NULL == pst_cursor) || (u32_rec_id > pst_cursor->pst_db->st_file_hdr.u32_rec_num))
+        return false;
+
+    pst_cursor->u32_pos = u32_rec_id;
+
+    return true;
+}
+
+uint32_t db_cursor_tell(hdb_cursor h_cursor)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+
+    if(NULL == pst_cursor)
+        return 0;
+
+    return pst_cursor->u32_pos;
+}
+
+struct db_record db_cursor_next(hdb_cursor h_cursor)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+    struct db *pst_db;
+    uint8_t *pu8_data;
+
+    if(NULL == pst_cursor)
+        return (struct db_record){0};
+
+    pst_db = pst_cursor->pst_db;
+
+    while(pst_cursor->u32_pos < pst_db->st_file_hdr.u32_rec_num)
+    {
+        uint32_t u32_rec_id = pst_cursor->u32_pos++;
+
+        pu8_data = _db_rec_fetch(pst_db, u32_rec_id, pst_cursor->pu8_buf);
+        if(NULL == pu8_data)
+            break;
+
+        if((NULL != pst_cursor->pst_filter) && (false == db_filter_match(pst_cursor->pst_filter, pu8_data)))
+            continue;
+
+        return (struct db_record){.u32_rec_id=u32_rec_id,.u32_data_len=pst_cursor->u32_buf_len,.pu8_data=pu8_data};
+    }
+
+    return (struct db_record){0};
+}
+
+uint32_t db_cursor_next_batch(hdb_cursor h_cursor, struct db_record *pst_record, uint32_t u32_max_num)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+    struct db *pst_db;
+    uint16_t u16_rec_len;
+    uint32_t u32_found = 0;
+
+    if((NULL == pst_cursor) || (NULL == pst_record) || (0 == u32_max_num))
+        return 0;
+
+    pst_db = pst_cursor->pst_db;
+    u16_rec_len = pst_db->st_file_hdr.u16_rec_len;
+
+    /* records of a cache block must outlive its release, keep copies */
+    if((NULL == pst_db->pu8_rec_cache) && (pst_cursor->u32_batch_cap < u32_max_num))
+    {
+        uint8_t *pu8_batch = (uint8_t *)realloc(pst_cursor->pu8_batch, (size_t)u32_max_num*u16_rec_len);
+
+        if(!pu8_batch)
+            return 0;
+
+        pst_cursor->pu8_batch = pu8_batch;
+        pst_cursor->u32_batch_cap = u32_max_num;
+    }
+
+    while((u32_found < u32_max_num) && (pst_cursor->u32_pos < pst_db->st_file_hdr.u32_rec_num))
+    {
+        uint32_t idx = pst_cursor->u32_pos;
+        uint32_t u32_num;
+        uint32_t u32_off;
+        bool b_pinned;
+        uint8_t *pu8_data = _db_rec_acquire_any(pst_db, idx, &u32_num, pst_cursor->pu8_buf, &b_pinned);
+
+        if(NULL == pu8_data)
+            break;
+
+        for(u32_off=0; (u32_off < u32_num) && (u32_found < u32_max_num); u32_off++, pu8_data+=u16_rec_len)
+        {
+            if((NULL != pst_cursor->pst_filter) && (false == db_filter_match(pst_cursor->pst_filter, pu8_data)))
+                continue;
+
+            pst_record[u32_found].u32_rec_id = idx+u32_off;
+            pst_record[u32_found].u32_data_len = u16_rec_len;
+            pst_record[u32_found].pu8_data = pu8_data;
+
+            if(NULL == pst_db->pu8_rec_cache)
+            {
+                pst_record[u32_found].pu8_data = &pst_cursor->pu8_batch[(size_t)u32_found*u16_rec_len];
+                memcpy((void *)pst_record[u32_found].pu8_data, (void *)pu8_data, u16_rec_len);
+            }
+
+            u32_found++;
+        }
+
+        if(true == b_pinned)
+            _db_rec_release(pst_db, idx);
+
+        pst_cursor->u32_pos = idx+u32_off;
+    }
+
+    return u32_found;
+}
+
+bool db_cursor_iterate(hdb_cursor h_cursor, db_pf_itor pf_itor, void *pv_usr_data)
+{
+    struct db_cursor *pst_cursor = (struct db_cursor *)h_cursor;
+
+    if((NULL == pst_cursor) || (NULL == pf_itor))
+        return false;
+
+    return _db_itor_run(
+            pst_cursor->pst_db,
+            &pst_cursor->u32_pos,
+            pst_cursor->pst_filter,
+            pst_cursor->pu8_buf,
+            pf_itor,
+            pv_usr_data);
+}
+
+/* output buffer of db_export, flushed to pf_writer when it is set and
+ * grown otherwise */
+struct db_out
+{
+    uint8_t *pu8_buf;
+    size_t t_len;
+    size_t t_cap;
+
+    db_pf_export_writer pf_writer;
+    void *pv_usr_data;
+    bool b_fail;
+};
+
+/* text of the current record before it is escaped, grown as needed */
+struct db_exp_scratch
+{
+    uint8_t *pu8_raw;
+    uint32_t u32_raw_cap;
+    uint8_t *pu8_text;
+    uint32_t u32_text_cap;
+};
+
+/* output of a parallel chunk waiting for the chunks before it */
+struct db_exp_chunk
+{
+    uint32_t u32_first_id;
+    uint32_t u32_num;
+    uint8_t *pu8_buf;
+    size_t t_len;
+    struct db_exp_chunk *pst_next;
+};
+
+struct db_exp
+{
+    struct db *pst_db;
+    uint8_t u8_format;
+    bool b_deleted;
+    bool b_crlf;
+    struct db_filter *pst_filter;
+
+    /* projected fields and their JSON keys ("NAME":) back to back */
+    uint32_t *pu32_field_idx;
+    const struct db_field **apst_field;
+    uint32_t u32_field_num;
+    uint8_t *pu8_key;
+    uint32_t *pu32_key_off;
+
+    /* parallel chunks are written in record order under the lock,
+     * st_cond tells waiting workers the writer moved on */
+    pthread_mutex_t st_lock;
+    pthread_cond_t st_cond;
+    uint32_t u32_chunk_rec_num;
+    uint32_t u32_emit_id;
+    struct db_exp_chunk *pst_pending;
+    db_pf_export_writer pf_writer;
+    void *pv_usr_data;
+    bool b_fail;
+};
+
+static bool _db_out_flush(struct db_out *pst_out)
+{
+    if((0 != pst_out->t_len) && (false == pst_out->b_fail))
+    {
+        if(false == pst_out->pf_writer(pst_out->pu8_buf, pst_out->t_len, pst_out->pv_usr_data))
+            pst_out->b_fail = true;
+    }
+
+    pst_out->t_len = 0;
+
+    return !pst_out->b_fail;
+}
+
+/* room for t_len more bytes, NULL on failure */
+static uint8_t *_db_out_reserve(struct db_out *pst_out, size_t t_len)
+{
+    if(pst_out->t_len+t_len > pst_out->t_cap)
+    {
+        uint8_t *pu8_buf;
+        size_t t_cap = 2*pst_out->t_cap;
+
+        if((NULL != pst_out->pf_writer) && (false == _db_out_flush(pst_out)))
+            return NULL;
+
+        if(t_cap < pst_out->t_len+t_len)
+            t_cap = pst_out->t_len+t_len;
+
+        if(pst_out->t_len+t_len > pst_out->t_cap)
+        {
+            pu8_buf = (uint8_t *)realloc(pst_out->pu8_buf, t_cap);
+            if(!pu8_buf)
+            {
+                pst_out->b_fail = true;
+                return NULL;
+            }
+
+            pst_out->pu8_buf = pu8_buf;
+            pst_out->t_cap = t_cap;
+        }
+    }
+
+    return &pst_out->pu8_buf[pst_out->t_len];
+}
+
+static void _db_out_put(struct db_out *pst_out, const void *pv_data, size_t t_len)
+{
+    uint8_t *pu8_dst = _db_out_reserve(pst_out, t_len);
+
+    if(NULL == pu8_dst)
+        return;
+
+    memcpy((void *)pu8_dst, pv_data, t_len);
+    pst_out->t_len += t_len;
+}
+
+/* UTF-8 text as a CSV field, quoted only when needed, or a JSON string */
+static void _db_out_text(struct db_out *pst_out, uint8_t u8_format, const uint8_t *pu8_text, uint32_t u32_len)
+{
+    static const char s_hex[] = "0123456789abcdef";
+    uint8_t *pu8_dst;
+    uint8_t *pu8_start;
+    bool b_quote = false;
+
+    if(DB_EXPORT_CSV == u8_format)
+    {
+        for(uint32_t idx=0; (idx<u32_len) && (false == b_quote); idx++)
+            b_quote = (',' == pu8_text[idx]) || ('"' == pu8_text[idx]) || ('\n' == pu8_text[idx]) || ('\r' == pu8_text[idx]);
+
+        if(false == b_quote)
+        {
+            _db_out_put(pst_out, pu8_text, u32_len);
+            return;
+        }
+    }
+
+    pu8_dst = _db_out_reserve(pst_out, 6*(size_t)u32_len+2);
+    if(NULL == pu8_dst)
+        return;
+
+    pu8_start = pu8_dst;
+    *pu8_dst++ = '"';
+
+    for(uint32_t idx=0; idx<u32_len; idx++)
+    {
+        uint8_t u8_ch = pu8_text[idx];
+
+        if(DB_EXPORT_CSV == u8_format)
+        {
+            if('"' == u8_ch)
+                *pu8_dst++ = '"';
+
+            *pu8_dst++ = u8_ch;
+        }
+        else if(('"' == u8_ch) || ('\\' == u8_ch))
+        {
+            *pu8_dst++ = '\\';
+            *pu8_dst++ = u8_ch;
+        }
+        else if(u8_ch < 0x20)
+        {
+            memcpy((void *)pu8_dst, (void *)"\\u00", 4);
+            pu8_dst[4] = s_hex[u8_ch>>4];
+            pu8_dst[5] = s_hex[u8_ch&0x0f];
+            pu8_dst += 6;
+        }
+        else
+        {
+            *pu8_dst++ = u8_ch;
+        }
+    }
+
+    *pu8_dst++ = '"';
+    pst_out->t_len += pu8_dst-pu8_start;
+}
+
+static void _db_out_null(struct db_out *pst_out, uint8_t u8_format)
+{
+    if(DB_EXPORT_JSONL == u8_format)
+        _db_out_put(pst_out, "null", 4);
+}
+
+static uint8_t *_db_exp_grow(uint8_t **ppu8_buf, uint32_t *pu32_cap, uint32_t u32_len)
+{
+    if(u32_len > *pu32_cap)
+    {
+        uint8_t *pu8_buf = (uint8_t *)realloc(*ppu8_buf, u32_len);
+
+        if(!pu8_buf)
+            return NULL;
+
+        *ppu8_buf = pu8_buf;
+        *pu32_cap = u32_len;
+    }
+
+    return *ppu8_buf;
+}
+
+/* N/F field text as a number valid in JSON, 0 when blank or invalid */
+static uint32_t _db_exp_num(const uint8_t *pu8_data, uint32_t u32_len, uint8_t *pu8_buf)
+{
+    uint32_t idx = 0;
+    uint32_t u32_out = 0;
+    uint32_t u32_digit = 0;
+
+    while((u32_len > 0) && (' ' == pu8_data[u32_len-1]))
+        u32_len--;
+
+    while((idx < u32_len) && (' ' == pu8_data[idx]))
+        idx++;
+
+    if((idx < u32_len) && (('-' == pu8_data[idx]) || ('+' == pu8_data[idx])))
+    {
+        if('-' == pu8_data[idx])
+            pu8_buf[u32_out++] = '-';
+
+        idx++;
+    }
+
+    /* no leading zeros but the last one */
+    while((idx+1 < u32_len) && ('0' == pu8_data[idx]) && isdigit(pu8_data[idx+1]))
+        idx++;
+
+    for(; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_digit++)
+        pu8_buf[u32_out++] = pu8_data[idx];
+
+    if(0 == u32_digit)
+        pu8_buf[u32_out++] = '0';
+
+    if((idx < u32_len) && ('.' == pu8_data[idx]))
+    {
+        uint32_t u32_frac = 0;
+
+        pu8_buf[u32_out++] = '.';
+
+        for(idx++; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_frac++)
+            pu8_buf[u32_out++] = pu8_data[idx];
+
+        /* "12." loses its point */
+        if(0 == u32_frac)
+            u32_out--;
+
+        u32_digit += u32_frac;
+    }
+
+    if(0 == u32_digit)
+        return 0;
+
+    if((idx < u32_len) && (('e' == pu8_data[idx]) || ('E' == pu8_data[idx])))
+    {
+        uint32_t u32_exp = 0;
+
+        pu8_buf[u32_out++] = 'e';
+        idx++;
+
+        if((idx < u32_len) && (('-' == pu8_data[idx]) || ('+' == pu8_data[idx])))
+            pu8_buf[u32_out++] = pu8_data[idx++];
+
+        for(; (idx < u32_len) && isdigit(pu8_data[idx]); idx++, u32_exp++)
+            pu8_buf[u32_out++] = pu8_data[idx];
+
+        if(0 == u32_exp)
+            return 0;
+    }
+
+    return (idx == u32_len)?(u32_out):(0);
+}
+
+/* signed integer with u8_dec implied decimals */
+static uint32_t _db_exp_int(int64_t i64_val, uint8_t u8_dec, uint8_t *pu8_buf)
+{
+    uint8_t au8_digit[24];
+    uint64_t u64_val = (i64_val < 0)?(-(uint64_t)i64_val):((uint64_t)i64_val);
+    uint32_t u32_num = 0;
+    uint32_t u32_out = 0;
+
+    do
+    {
+        au8_digit[u32_num++] = '0'+u64_val%10;
+        u64_val /= 10;
+    }while((u64_val > 0) || (u32_num <= u8_dec));
+
+    if(i64_val < 0)
+        pu8_buf[u32_out++] = '-';
+
+    while(u32_num > 0)
+    {
+        if(u32_num == u8_dec)
+            pu8_buf[u32_out++] = '.';
+
+        pu8_buf[u32_out++] = au8_digit[--u32_num];
     }
 
-    return -1;
+    return u32_out;
 }
 
-struct db_var db_field_map_data(
-        hdb h_db,
-        uint8_t *pu8_rec_data,
-        uint32_t u32_field_idx)
+/* transcode text of the table and write it escaped */
+static void _db_exp_text(
+        struct db_exp *pst_exp,
+        struct db_exp_scratch *pst_scratch,
+        struct db_out *pst_out,
+        const uint8_t *pu8_data,
+        uint32_t u32_len)
 {
-    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
-    struct db_field *pst_field;
-    char *s_map_data = NULL;
-    uint32_t u32_len = 0;
+    uint32_t u32_text_len;
 
-    if(u32_field_idx >= pst_info->u8_field_num)
-        return (struct db_var){0};
+    if(NULL == _db_exp_grow(&pst_scratch->pu8_text, &pst_scratch->u32_text_cap, 3*u32_len+1))
+    {
+        pst_out->b_fail = true;
+        return;
+    }
 
-    pst_field = pst_info->a_field[u32_field_idx];
-    pu8_rec_data = pu8_rec_data + pst_field->u32_acc_len;
+    u32_text_len = db_cp_to_utf8(pst_exp->pst_db->u8_code_page, pu8_data, u32_len, pst_scratch->pu8_text, 3*u32_len, NULL);
+    _db_out_text(pst_out, pst_exp->u8_format, pst_scratch->pu8_text, u32_text_len);
+}
+
+static void _db_exp_field(
+        struct db_exp *pst_exp,
+        struct db_exp_scratch *pst_scratch,
+        struct db_out *pst_out,
+        uint32_t u32_field,
+        const uint8_t *pu8_rec_data)
+{
+    const struct db_field *pst_field = pst_exp->apst_field[u32_field];
+    const uint8_t *pu8_data = &pu8_rec_data[pst_field->u32_acc_len];
+    bool b_quote = (DB_EXPORT_JSONL == pst_exp->u8_format);
+    uint8_t au8_buf[300];
+    uint32_t u32_len;
 
     switch(toupper(pst_field->u8_type))
     {
-        case 'C':
-            {
-                size_t t_len;
+        case 'N':
+        case 'F':
+            u32_len = _db_exp_num(pu8_data, pst_field->u8_len, au8_buf);
+            if(0 == u32_len)
+                break;
 
-                u32_len = pst_field->u8_len+2;
-                s_map_data = (char *)calloc(1, u32_len);
+            _db_out_put(pst_out, au8_buf, u32_len);
+            return;
+        case 'D':
+            if((8 != pst_field->u8_len) || (' ' == pu8_data[0]))
+                break;
 
-                memcpy(
-                    (void *)s_map_data,
-                    (void *)pu8_rec_data,
-                    pst_field->u8_len);
+            u32_len = 0;
+            if(true == b_quote)
+                au8_buf[u32_len++] = '"';
 
-                _remove_trailing_space(s_map_data);
+            memcpy((void *)&au8_buf[u32_len], (void *)pu8_data, 4);
+            au8_buf[u32_len+4] = '-';
+            memcpy((void *)&au8_buf[u32_len+5], (void *)&pu8_data[4], 2);
+            au8_buf[u32_len+7] = '-';
+            memcpy((void *)&au8_buf[u32_len+8], (void *)&pu8_data[6], 2);
+            u32_len += 10;
 
-                t_len = strlen(s_map_data);
-                if(t_len > 1)
-                {
-                    s_map_data[t_len] = ' ';
-                    s_map_data[t_len+1] = '\0';
-                }
-            }
-            break;
-        case 'N':
-            if(0x20 != pu8_rec_data[pst_field->u8_len-1])
-            {
-                u32_len = pst_field->u8_len+1;
-                s_map_data = (char *)malloc(u32_len);
+            if(true == b_quote)
+                au8_buf[u32_len++] = '"';
 
-                memcpy((void *)s_map_data, (void *)pu8_rec_data, pst_field->u8_len);
-                s_map_data[pst_field->u8_len] = '\0';
+            _db_out_put(pst_out, au8_buf, u32_len);
+            return;
+        case 'L':
+            switch(pu8_data[0])
+            {
+                case 'T':
+                case 't':
+                case 'Y':
+                case 'y':
+                    _db_out_put(pst_out, "true", 4);
+                    return;
+                case 'F':
+                case 'f':
+                case 'N':
+                case 'n':
+                    _db_out_put(pst_out, "false", 5);
+                    return;
+                default:
+                    break;
             }
             break;
-        case 'D':
-            if(0x20 != pu8_rec_data[0])
+        case 'I':
+            if(4 != pst_field->u8_len)
+                goto text;
+
+            _db_out_put(pst_out, au8_buf, _db_exp_int((int32_t)_db_get_le32(pu8_data), 0, au8_buf));
+            return;
+        case 'Y':
+            if(8 != pst_field->u8_len)
+                goto text;
+
+            _db_out_put(pst_out, au8_buf, _db_exp_int((int64_t)_db_get_le64(pu8_data), 4, au8_buf));
+            return;
+        case 'B':
             {
-                u32_len = 11;
-                s_map_data = (char *)malloc(u32_len);
+                uint64_t u64_val;
+                double d_val;
 
-                sprintf(s_map_data, "%c%c%c%c/%c%c/%c%c", pu8_rec_data[0], pu8_rec_data[1], pu8_rec_data[2], pu8_rec_data[3], pu8_rec_data[4], pu8_rec_data[5], pu8_rec_data[6], pu8_rec_data[7]);
-                s_map_data[10] = '\0';
-            }
-            break;
-        case 'L':
-            u32_len = 2;
-            s_map_data = (char *)malloc(u32_len);
+                if(8 != pst_field->u8_len)
+                    goto text;
 
-            s_map_data[0] = toupper(pu8_rec_data[0]);
-            s_map_data[1] = '\0';
-            break;
+                u64_val = _db_get_le64(pu8_data);
+                memcpy((void *)&d_val, (void *)&u64_val, sizeof(double));
+
+                if(!isfinite(d_val))
+                    break;
+
+                _db_out_put(pst_out, au8_buf, snprintf((char *)au8_buf, sizeof(au8_buf), "%.17g", d_val));
+            }
+            return;
         case 'T':
             {
                 struct db_date st_date;
+                uint8_t *pu8_buf = au8_buf;
 
-                if((0 != pu8_rec_data[0]) && (0x20 != pu8_rec_data[0]))
-                {
-                    u32_len = 20;
-                    s_map_data = (char *)malloc(u32_len);
+                if((8 != pst_field->u8_len) || (true == _db_time_is_blank(pu8_data)))
+                    break;
 
-                    _db_JD_to_date(pu8_rec_data, &st_date);
-                    sprintf(
-                        s_map_data,
-                        "%d/%02d/%02d %02d:%02d:%02d",
-                        st_date.u16_year,
-                        st_date.u8_month,
-                        st_date.u8_day,
-                        st_date.u8_hour,
-                        st_date.u8_min,
-                        st_date.u8_sec);
+                _db_JD_to_date(pu8_data, &st_date);
 
-                    s_map_data[19] = '\0';
-                }
+                if(true == b_quote)
+                    *pu8_buf++ = '"';
+
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u16_year, 4);
+                *pu8_buf++ = '-';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_month, 2);
+                *pu8_buf++ = '-';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_day, 2);
+                *pu8_buf++ = 'T';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_hour, 2);
+                *pu8_buf++ = ':';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_min, 2);
+                *pu8_buf++ = ':';
+                pu8_buf = _db_fmt_num(pu8_buf, st_date.u8_sec, 2);
+
+                if(true == b_quote)
+                    *pu8_buf++ = '"';
+
+                _db_out_put(pst_out, au8_buf, pu8_buf-au8_buf);
             }
-            break;
+            return;
         case 'M':
             {
-                uint32_t u32_blk_idx;
+                hdb h_db = (hdb)pst_exp->pst_db;
+                struct db_memo st_memo;
 
-                u32_blk_idx = (uint32_t)(pu8_rec_data[3]<<24) |
-                                pu8_rec_data[2]<<16 |
-                                pu8_rec_data[1]<<8 |
-                                pu8_rec_data[0];
+                if((false == db_memo_open(h_db, pu8_rec_data, pst_exp->pu32_field_idx[u32_field], &st_memo)) ||
+                   (0 == st_memo.u32_len))
+                    break;
 
-                if(0 == u32_blk_idx)
+                /* mapped memos are transcoded in place */
+                pu8_data = db_memo_ptr(h_db, &st_memo);
+                if(NULL == pu8_data)
                 {
-                    s_map_data = NULL;
-                    break;
+                    if(NULL == _db_exp_grow(&pst_scratch->pu8_raw, &pst_scratch->u32_raw_cap, st_memo.u32_len))
+                    {
+                        pst_out->b_fail = true;
+                        return;
+                    }
+
+                    st_memo.u32_len = db_memo_read(h_db, &st_memo, 0, pst_scratch->pu8_raw, st_memo.u32_len);
+                    pu8_data = pst_scratch->pu8_raw;
                 }
 
-                u32_len = _db_memo_read(
-                        (struct db *)h_db,
-                        u32_blk_idx,
-                        NULL,
-                        0)+2;
-
-                s_map_data = (char *)malloc(u32_len);
-
-                _db_memo_read(
-                        (struct db *)h_db,
-                        u32_blk_idx,
-                        (uint8_t *)s_map_data,
-                        u32_len-2);
-
-                s_map_data[u32_len-2] = ' ';
-                s_map_data[u32_len-1] = '\0';
+                _db_exp_text(pst_exp, pst_scratch, pst_out, pu8_data, st_memo.u32_len);
             }
-            break;
+            return;
         default:
-            s_map_data = NULL;
-            break;
+        text:
+            pu8_data = _db_field_trim(pst_field, pu8_data, &u32_len);
+            _db_exp_text(pst_exp, pst_scratch, pst_out, pu8_data, u32_len);
+            return;
     }
 
-    return (struct db_var){.u8_type=pst_field->u8_type,.u32_data_len=u32_len,.pv_data=(void *)s_map_data};
+    _db_out_null(pst_out, pst_exp->u8_format);
 }
 
-bool db_field_unmap_data(hdb h_db, struct db_var *pst_var)
+/* format the records of a block, false on failure */
+static bool _db_exp_records(
+        struct db_exp *pst_exp,
+        struct db_exp_scratch *pst_scratch,
+        struct db_out *pst_out,
+        const uint8_t *pu8_data,
+        uint32_t u32_num)
 {
-    free(pst_var->pv_data);
+    uint16_t u16_rec_len = pst_exp->pst_db->st_file_hdr.u16_rec_len;
 
-    pst_var->u8_type = 0;
-    pst_var->u32_data_len = 0;
-    pst_var->pv_data = NULL;
+    for(uint32_t idx=0; idx<u32_num; idx++, pu8_data+=u16_rec_len)
+    {
+        if((false == pst_exp->b_deleted) && ('*' == pu8_data[0]))
+            continue;
+
+        if((NULL != pst_exp->pst_filter) && (false == db_filter_match(pst_exp->pst_filter, pu8_data)))
+            continue;
+
+        if(DB_EXPORT_JSONL == pst_exp->u8_format)
+            _db_out_put(pst_out, "{", 1);
+
+        for(uint32_t u32_field=0; u32_field<pst_exp->u32_field_num; u32_field++)
+        {
+            if(DB_EXPORT_JSONL == pst_exp->u8_format)
+            {
+                uint32_t u32_off = pst_exp->pu32_key_off[u32_field];
+
+                _db_out_put(pst_out, &pst_exp->pu8_key[u32_off], pst_exp->pu32_key_off[u32_field+1]-u32_off);
+            }
+            else if(u32_field > 0)
+            {
+                _db_out_put(pst_out, ",", 1);
+            }
+
+            _db_exp_field(pst_exp, pst_scratch, pst_out, u32_field, pu8_data);
+        }
+
+        if(DB_EXPORT_JSONL == pst_exp->u8_format)
+            _db_out_put(pst_out, "}\n", 2);
+        else if(true == pst_exp->b_crlf)
+            _db_out_put(pst_out, "\r\n", 2);
+        else
+            _db_out_put(pst_out, "\n", 1);
+
+        if(true == pst_out->b_fail)
+            return false;
+
+        /* a streamed export hands out full buffers only */
+        if((NULL != pst_out->pf_writer) && (pst_out->t_len >= DB_EXPORT_BUF_SIZE) && (false == _db_out_flush(pst_out)))
+            return false;
+    }
 
     return true;
 }
 
-bool db_field_cmp(
-        hdb h_db,
-        const uint8_t *pu8_rec_data,
-        uint32_t u32_field_idx,
-        const uint8_t *pu8_cmp_data,
-        uint8_t u8_len)
+/* write a parallel chunk, or keep it until the chunks before it are done */
+static bool _db_exp_emit(struct db_exp *pst_exp, struct db_exp_chunk *pst_chunk)
 {
-    struct db_field_info *pst_info = &((struct db *)h_db)->st_field_info;
-    struct db_field *pst_field;
+    struct db_exp_chunk **ppst_pos;
+    bool b_ret;
 
-    if(u32_field_idx >= pst_info->u8_field_num)
-        return false;
+    pthread_mutex_lock(&pst_exp->st_lock);
 
-    pst_field = pst_info->a_field[u32_field_idx];
-    pu8_rec_data = pu8_rec_data + pst_field->u32_acc_len;
+    ppst_pos = &pst_exp->pst_pending;
+    while((NULL != *ppst_pos) && ((*ppst_pos)->u32_first_id < pst_chunk->u32_first_id))
+        ppst_pos = &(*ppst_pos)->pst_next;
 
-    if(u8_len > pst_field->u8_len)
-        return false;
+    pst_chunk->pst_next = *ppst_pos;
+    *ppst_pos = pst_chunk;
 
-    if(0 == memcmp((void *)pu8_rec_data, (void *)pu8_cmp_data, u8_len))
-        return true;
+    while((NULL != pst_exp->pst_pending) && (pst_exp->pst_pending->u32_first_id == pst_exp->u32_emit_id))
+    {
+        pst_chunk = pst_exp->pst_pending;
+        pst_exp->pst_pending = pst_chunk->pst_next;
+        pst_exp->u32_emit_id += pst_chunk->u32_num;
 
-    return false;
+        if((false == pst_exp->b_fail) && (0 != pst_chunk->t_len) &&
+           (false == pst_exp->pf_writer(pst_chunk->pu8_buf, pst_chunk->t_len, pst_exp->pv_usr_data)))
+            pst_exp->b_fail = true;
+
+        free(pst_chunk->pu8_buf);
+        free(pst_chunk);
+    }
+
+    b_ret = !pst_exp->b_fail;
+
+    pthread_cond_broadcast(&pst_exp->st_cond);
+    pthread_mutex_unlock(&pst_exp->st_lock);
+
+    return b_ret;
 }
 
-struct db_record db_record_find(
-        hdb h_db,
-        uint32_t u32_start_idx,
-        uint32_t u32_field_idx,
-        const uint8_t *pu8_cmp_data,
-        db_pf_cmp pf_cmp,
+static bool _db_exp_chunk(
+        struct db *pst_db,
+        const uint8_t *pu8_data,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
         void *pv_usr_data)
 {
-    struct db *pst_db = (struct db *)h_db;
-    struct db_var st_id;
-    uint16_t u16_data_len;
-    uint8_t *pu8_data;
-    bool b_equal;
+    struct db_exp *pst_exp = (struct db_exp *)pv_usr_data;
+    struct db_exp_scratch st_scratch = {0};
+    struct db_out st_out = {0};
+    struct db_exp_chunk *pst_chunk;
+    bool b_ret;
 
-    u16_data_len = pst_db->st_file_hdr.u16_rec_len;
+    /* the chunk the writer waits for never waits, so the window moves;
+     * it counts full chunks, the last one of the table is shorter */
+    pthread_mutex_lock(&pst_exp->st_lock);
 
-    if(!pst_db->pu8_find_buf)
-    {
-        pst_db->pu8_find_buf = (uint8_t *)malloc(u16_data_len);
-    }
+    while((false == pst_exp->b_fail) && (0 != u32_num) &&
+          (u32_first_id-pst_exp->u32_emit_id >= DB_EXPORT_MAX_PENDING*pst_exp->u32_chunk_rec_num))
+        pthread_cond_wait(&pst_exp->st_cond, &pst_exp->st_lock);
 
-    pu8_data = pst_db->pu8_find_buf;
+    b_ret = (false == pst_exp->b_fail) && (0 != u32_num);
+    pthread_mutex_unlock(&pst_exp->st_lock);
 
-    for(int idx=u32_start_idx; idx<pst_db->st_file_hdr.u32_rec_num; idx++)
-    {
-        _db_rec_read(pst_db, idx, pu8_data);
+    if(true == b_ret)
+        b_ret = _db_exp_records(pst_exp, &st_scratch, &st_out, pu8_data, u32_num);
 
-        st_id = db_field_map_data(
-                h_db,
-                pu8_data,
-                u32_field_idx);
+    free(st_scratch.pu8_raw);
+    free(st_scratch.pu8_text);
 
-        b_equal = pf_cmp(h_db, st_id.pv_data, pu8_cmp_data, pv_usr_data);
+    pst_chunk = (struct db_exp_chunk *)malloc(sizeof(struct db_exp_chunk));
+    if((false == b_ret) || !pst_chunk)
+    {
+        free(pst_chunk);
+        free(st_out.pu8_buf);
 
-        db_field_unmap_data(h_db, &st_id);
+        /* chunks after this one would wait for it forever */
+        pthread_mutex_lock(&pst_exp->st_lock);
+        pst_exp->b_fail = true;
+        pthread_cond_broadcast(&pst_exp->st_cond);
+        pthread_mutex_unlock(&pst_exp->st_lock);
 
-        if(true == b_equal)
-            return (struct db_record){.u32_rec_id=idx,.u32_data_len=u16_data_len,.pu8_data=pu8_data};
+        return false;
     }
 
-    return (struct db_record){0};
+    pst_chunk->u32_first_id = u32_first_id;
+    pst_chunk->u32_num = u32_num;
+    pst_chunk->pu8_buf = st_out.pu8_buf;
+    pst_chunk->t_len = st_out.t_len;
+
+    return _db_exp_emit(pst_exp, pst_chunk);
 }
 
-bool db_itor_init(hdb h_db, db_pf_itor pf_itor, void * pv_usr_data)
+/* projected fields and their JSON keys */
+static bool _db_exp_init(struct db_exp *pst_exp, const struct db_export *pst_export)
 {
-    struct db *pst_db = (struct db *)h_db;
-    struct db_itor *pst_itor = NULL;
+    struct db_field_info *pst_info = &pst_exp->pst_db->st_field_info;
+    uint32_t u32_key_len = 0;
+    uint32_t u32_num = 0;
+
+    pst_exp->u32_field_num = (NULL != pst_export->pu32_field_idx)?(pst_export->u32_field_num):(pst_info->u8_field_num);
+    pst_exp->pu32_field_idx = (uint32_t *)malloc((pst_exp->u32_field_num+1)*sizeof(uint32_t));
+    pst_exp->apst_field = (const struct db_field **)malloc((pst_exp->u32_field_num+1)*sizeof(struct db_field *));
+    pst_exp->pu32_key_off = (uint32_t *)malloc((pst_exp->u32_field_num+1)*sizeof(uint32_t));
+    if(!pst_exp->pu32_field_idx || !pst_exp->apst_field || !pst_exp->pu32_key_off)
+        return false;
 
-    if(NULL == pst_db->pst_itor)
+    for(uint32_t idx=0; idx<pst_exp->u32_field_num; idx++)
     {
-        pst_itor = (struct db_itor *)malloc(sizeof(struct db_itor));
-        if(!pst_itor)
+        uint32_t u32_field_idx = (NULL != pst_export->pu32_field_idx)?(pst_export->pu32_field_idx[idx]):(idx);
+        const struct db_field *pst_field;
+
+        if(u32_field_idx >= pst_info->u8_field_num)
             return false;
 
-        pst_itor->u32_buf_len = pst_db->st_file_hdr.u16_rec_len;
-        pst_itor->pu8_buf = (uint8_t *)malloc(pst_itor->u32_buf_len);
+        pst_field = pst_info->a_field[u32_field_idx];
 
-        pst_itor->pf_itor = pf_itor;
-        pst_itor->pv_usr_data = pv_usr_data;
+        /* the hidden null flags of Visual FoxPro are no data */
+        if((NULL == pst_export->pu32_field_idx) && ('0' == pst_field->u8_type))
+            continue;
 
-        pst_db->pst_itor = pst_itor;
+        pst_exp->pu32_field_idx[u32_num] = u32_field_idx;
+        pst_exp->apst_field[u32_num++] = pst_field;
+        u32_key_len += 6*strlen(pst_field->s_name)+3;
     }
 
-    return true;
-}
+    pst_exp->u32_field_num = u32_num;
 
-bool db_itor_start(hdb h_db)
-{
-    struct db *pst_db = (struct db *)h_db;
-    struct db_itor *pst_itor;
-    struct db_record st_record;
-    db_pf_itor pf_itor;
-    void *pv_usr_data;
+    /* keys are escaped once, field names are plain ASCII in practice */
+    pst_exp->pu8_key = (uint8_t *)malloc(u32_key_len+1);
+    if(!pst_exp->pu8_key)
+        return false;
 
-    pst_itor = pst_db->pst_itor;
-    st_record.u32_data_len = pst_itor->u32_buf_len;
-    st_record.pu8_data = pst_itor->pu8_buf;
+    {
+        struct db_out st_key = {.pu8_buf=pst_exp->pu8_key,.t_cap=u32_key_len+1};
 
-    pf_itor = pst_itor->pf_itor;
-    pv_usr_data = pst_itor->pv_usr_data;
+        for(uint32_t idx=0; idx<pst_exp->u32_field_num; idx++)
+        {
+            const char *s_name = pst_exp->apst_field[idx]->s_name;
 
-    for(int idx=0; idx<pst_db->st_file_hdr.u32_rec_num; idx++)
-    {
-        _db_rec_read(pst_db, idx, st_record.pu8_data);
-        st_record.u32_rec_id = idx;
+            pst_exp->pu32_key_off[idx] = st_key.t_len;
+            if(idx > 0)
+                _db_out_put(&st_key, ",", 1);
 
-        if(false == pf_itor(h_db, &st_record, pv_usr_data))
-            return false;
+            _db_out_text(&st_key, DB_EXPORT_JSONL, (const uint8_t *)s_name, strlen(s_name));
+            _db_out_put(&st_key, ":", 1);
+        }
+
+        pst_exp->pu32_key_off[pst_exp->u32_field_num] = st_key.t_len;
+        pst_exp->pu8_key = st_key.pu8_buf;
     }
 
     return true;
 }
 
-bool db_itor_deinit(hdb h_db)
+bool db_export(
+        hdb h_db,
+        const struct db_export *pst_export,
+        db_pf_export_writer pf_writer,
+        void *pv_usr_data)
 {
-    struct db_itor *pst_itor = ((struct db *)h_db)->pst_itor;
+    struct db *pst_db = (struct db *)h_db;
+    struct db_exp st_exp = {0};
+    struct db_exp_scratch st_scratch = {0};
+    struct db_out st_out = {0};
+    uint8_t *pu8_rec_buf = NULL;
+    bool b_ret = false;
+
+    if((INVALID_DB_HANDLE == h_db) || (NULL == pst_export) || (NULL == pf_writer) ||
+       ((DB_EXPORT_CSV != pst_export->u8_format) && (DB_EXPORT_JSONL != pst_export->u8_format)))
+        return false;
 
-    if(pst_itor)
+    st_exp.pst_db = pst_db;
+    st_exp.u8_format = pst_export->u8_format;
+    st_exp.b_deleted = pst_export->b_deleted;
+    st_exp.b_crlf = pst_export->b_crlf;
+    st_exp.pst_filter = (struct db_filter *)pst_export->h_filter;
+    st_exp.pf_writer = pf_writer;
+    st_exp.pv_usr_data = pv_usr_data;
+
+    st_out.pf_writer = pf_writer;
+    st_out.pv_usr_data = pv_usr_data;
+
+    do
     {
-        free(pst_itor->pu8_buf);
-        free(pst_itor);
-        ((struct db *)h_db)->pst_itor = NULL;
-    }
+        if(false == _db_exp_init(&st_exp, pst_export))
+            break;
 
-    return true;
+        st_out.pu8_buf = (uint8_t *)malloc(DB_EXPORT_BUF_SIZE);
+        pu8_rec_buf = (uint8_t *)malloc(pst_db->st_file_hdr.u16_rec_len);
+        if(!st_out.pu8_buf || !pu8_rec_buf)
+            break;
+
+        st_out.t_cap = DB_EXPORT_BUF_SIZE;
+
+        if((DB_EXPORT_CSV == st_exp.u8_format) && (true == pst_export->b_header))
+        {
+            for(uint32_t idx=0; idx<st_exp.u32_field_num; idx++)
+            {
+                const char *s_name = st_exp.apst_field[idx]->s_name;
+
+                if(idx > 0)
+                    _db_out_put(&st_out, ",", 1);
+
+                _db_out_text(&st_out, DB_EXPORT_CSV, (const uint8_t *)s_name, strlen(s_name));
+            }
+
+            if(true == st_exp.b_crlf)
+                _db_out_put(&st_out, "\r\n", 2);
+            else
+                _db_out_put(&st_out, "\n", 1);
+        }
+
+        /* a zeroed struct db_export runs on the calling thread */
+        if(1 < pst_export->u32_worker_num)
+        {
+            /* the header goes out before any chunk */
+            if(false == _db_out_flush(&st_out))
+                break;
+
+            st_exp.u32_chunk_rec_num = _db_par_chunk_rec_num(&pst_db->st_file_hdr);
+            pthread_mutex_init(&st_exp.st_lock, NULL);
+            pthread_cond_init(&st_exp.st_cond, NULL);
+            b_ret = _db_par_run(pst_db, pst_export->u32_worker_num, _db_exp_chunk, (void *)&st_exp);
+            pthread_cond_destroy(&st_exp.st_cond);
+            pthread_mutex_destroy(&st_exp.st_lock);
+
+            /* chunks left behind by a stop */
+            while(NULL != st_exp.pst_pending)
+            {
+                struct db_exp_chunk *pst_chunk = st_exp.pst_pending;
+
+                st_exp.pst_pending = pst_chunk->pst_next;
+                free(pst_chunk->pu8_buf);
+                free(pst_chunk);
+            }
+
+            b_ret = (true == b_ret) && (false == st_exp.b_fail);
+            break;
+        }
+
+        b_ret = true;
+
+        for(uint32_t idx=0, u32_num=0; (true == b_ret) && (idx<pst_db->st_file_hdr.u32_rec_num); idx+=u32_num)
+        {
+            bool b_pinned;
+            uint8_t *pu8_data = _db_rec_acquire_any(pst_db, idx, &u32_num, pu8_rec_buf, &b_pinned);
+
+            if(NULL == pu8_data)
+            {
+                b_ret = false;
+                break;
+            }
+
+            b_ret = _db_exp_records(&st_exp, &st_scratch, &st_out, pu8_data, u32_num);
+
+            if(true == b_pinned)
+                _db_rec_release(pst_db, idx);
+        }
+
+        if(false == _db_out_flush(&st_out))
+            b_ret = false;
+    }while(0);
+
+    free(st_out.pu8_buf);
+    free(pu8_rec_buf);
+    free(st_scratch.pu8_raw);
+    free(st_scratch.pu8_text);
+    free(st_exp.pu32_field_idx);
+    free(st_exp.apst_field);
+    free(st_exp.pu32_key_off);
+    free(st_exp.pu8_key);
+
+    return b_ret;
 }
 
 /* debug function */
@@ -804,7 +9028,7 @@ void db_dump_field_desc(hdb h_db)
     }
 }
 
-static void _db_dump_record(struct db *pst_db, uint8_t *pu8_data)
+static void _db_dump_record(struct db *pst_db, const uint8_t *pu8_data)
 {
     uint8_t u8_field_num;
     struct db_var st_var={};
@@ -13,6 +13,9 @@
 
 #define INVALID_DB_HANDLE (NULL)
 typedef void * hdb;
+typedef void * hdb_filter;
+typedef void * hdb_cursor;
+typedef void * hdb_arena;
 struct db_record;
 struct db_collect;
 
@@ -27,16 +30,88 @@ typedef bool (*db_pf_cmp)(
                     const uint8_t *pu8_data2,
                     void *pv_usr_data);
 
+/* pu8_data holds u32_num records of u16_rec_len bytes back to back,
+ * the first one is record u32_first_id */
+typedef bool (*db_pf_batch)(
+                    hdb,
+                    const uint8_t *pu8_data,
+                    uint32_t u32_num,
+                    uint32_t u32_first_id,
+                    void *pv_usr_data);
+
+/* writer of db_memo_stream, returns false to stop streaming */
+typedef bool (*db_pf_memo_writer)(
+                    const uint8_t *pu8_data,
+                    uint32_t u32_len,
+                    void *pv_usr_data);
+
+/* called by db_follow after each refresh, u32_num is 0 when no
+ * records were appended; returns false to stop following */
+typedef bool (*db_pf_follow)(
+                    hdb,
+                    uint32_t u32_first_id,
+                    uint32_t u32_num,
+                    void *pv_usr_data);
+
+/* called by db_join for each pair of records, pst_right is NULL for a
+ * left record without a match; returns false to stop joining */
+typedef bool (*db_pf_join)(
+                    const struct db_record *pst_left,
+                    const struct db_record *pst_right,
+                    void *pv_usr_data);
+
+/* writer of db_export, returns false to stop exporting */
+typedef bool (*db_pf_export_writer)(
+                    const uint8_t *pu8_data,
+                    uint32_t u32_len,
+                    void *pv_usr_data);
+
+/* join type of db_join */
+#define DB_JOIN_INNER (0) /* pairs of records with equal keys */
+#define DB_JOIN_LEFT (1)  /* as DB_JOIN_INNER, plus every left record without a match */
+
+/* record access mode of struct db_config */
+#define DB_ACCESS_CACHE (0) /* read the whole record area into memory */
+#define DB_ACCESS_MMAP (1)  /* map the file read-only, records are not copied */
+#define DB_ACCESS_PAGED (2) /* keep a bounded number of record blocks in memory */
+#define DB_ACCESS_LAZY (3)  /* read record blocks on first access and keep them */
+
 struct db_config
 {
-    const char *s_encode;
+    const char *s_encode; /* code page of text overriding the header, see db_cp_find */
+    uint8_t u8_access;
+
+    /* DB_ACCESS_PAGED and DB_ACCESS_LAZY only, 0 selects the default */
+    uint32_t u32_cache_size;  /* memory budget of the record cache in bytes, not for LAZY */
+    uint32_t u32_blk_rec_num; /* number of records per cache block */
+    uint8_t u8_read_ahead;    /* blocks read ahead on sequential access */
+};
+
+/* condition of struct db_scan */
+#define DB_SCAN_EQ (0)         /* C field equal to the key padded with spaces */
+#define DB_SCAN_PREFIX (1)     /* field starting with the key */
+#define DB_SCAN_DATE_RANGE (2) /* D field between two YYYYMMDD dates, inclusive */
+#define DB_SCAN_DELETED (3)    /* record marked deleted, no field */
+
+struct db_scan
+{
+    uint8_t u8_op;
+    uint32_t u32_field_idx;
+
+    /* key, or lowest date with NULL for no limit */
+    const uint8_t *pu8_key;
+    uint32_t u32_key_len;
+
+    /* DB_SCAN_DATE_RANGE only, highest date with NULL for no limit */
+    const uint8_t *pu8_hi;
+    uint32_t u32_hi_len;
 };
 
 struct db_record
 {
     uint32_t u32_rec_id;
     uint32_t u32_data_len;
-    uint8_t *pu8_data;
+    const uint8_t *pu8_data;
 };
 
 struct db_info
@@ -47,7 +122,7 @@ struct db_info
     uint32_t u32_rec_num;
     uint16_t u16_rec_len;
     uint8_t u8_enc;
-    uint8_t u8_code_page;
+    uint8_t u8_code_page; /* language driver byte, see db_cp_to_utf8 */
 };
 
 struct db_var
@@ -57,6 +132,67 @@ struct db_var
     void *pv_data;
 };
 
+struct db_tag_info
+{
+    char s_name[11];
+    const char *s_expr;
+    const char *s_for;
+    uint16_t u16_key_len;
+    bool b_unique;
+    bool b_desc;
+    int16_t i16_field_idx; /* field covered by the key expression, -1 if none */
+};
+
+/* value type of struct db_column */
+#define DB_COLUMN_STR (0)    /* char[u32_width] per row, not terminated */
+#define DB_COLUMN_INT64 (1)  /* int64_t, N without decimals, I, Y in 1/10000 */
+#define DB_COLUMN_DOUBLE (2) /* double, N with decimals, F and B */
+#define DB_COLUMN_DATE (3)   /* int32_t, days since 1970-01-01 */
+#define DB_COLUMN_BOOL (4)   /* uint8_t, 1 for true and 0 for false */
+#define DB_COLUMN_TIME (5)   /* int64_t, T as milliseconds since 1970-01-01 */
+
+struct db_column
+{
+    uint32_t u32_field_idx;
+    uint8_t u8_type;
+    uint32_t u32_width; /* bytes per row of pv_data */
+    uint32_t u32_row_num;
+
+    void *pv_data;
+    uint16_t *pu16_len;    /* DB_COLUMN_STR only, length without padding */
+    uint8_t *pu8_null;     /* 1 for blank or invalid values */
+    uint8_t *pu8_deleted;  /* 1 for rows of records marked deleted */
+};
+
+struct db_memo
+{
+    uint32_t u32_blk_idx;
+    uint32_t u32_len;
+};
+
+struct db_view
+{
+    uint8_t u8_type;
+    uint32_t u32_data_len;
+    const uint8_t *pu8_data;
+};
+
+/* output format of struct db_export */
+#define DB_EXPORT_CSV (0)   /* RFC 4180, fields quoted only when needed */
+#define DB_EXPORT_JSONL (1) /* one JSON object per line keyed by field name */
+
+struct db_export
+{
+    uint8_t u8_format;
+    const uint32_t *pu32_field_idx; /* fields in output order, NULL for all but the VFP null flags */
+    uint32_t u32_field_num;         /* size of the pu32_field_idx array */
+    hdb_filter h_filter;            /* records to export, NULL for all */
+    bool b_header;                  /* CSV only, field names as first line */
+    bool b_crlf;                    /* CSV only, end lines with CR LF as RFC 4180 asks, LF otherwise */
+    bool b_deleted;                 /* export records marked deleted too */
+    uint32_t u32_worker_num;        /* threads formatting chunks, 0 or 1 for the calling thread */
+};
+
 /** @brief open database with specific name
  * 
  *  @param s_name the name of the database.
@@ -64,6 +200,19 @@ struct db_var
  */
 hdb db_open(char *s_name);
 
+/** @brief open database with specific name and configuration
+ * 
+ *  @param s_name the name of the database.
+ *  @param pst_config open configuration, NULL for default.
+ *  @return database handle
+ *
+ *  @note the record data handed out by db_record_find and the
+ *        iterator points into the record store of the handle in
+ *        every access mode and is const; with DB_ACCESS_MMAP it is
+ *        the read-only mapping of the file.
+ */
+hdb db_open_ex(char *s_name, const struct db_config *pst_config);
+
 /** @brief close database
  * 
  *  @param h_db database handle.
@@ -79,6 +228,46 @@ bool db_close(hdb h_db);
  */
 bool db_get_info(hdb h_db, struct db_info *pst_info);
 
+/** @brief read records into memory ahead of their use
+ * 
+ *  @param h_db database handle.
+ *  @param u32_first_id first record to read.
+ *  @param u32_num number of records, cut at the last record.
+ *  @return function call success or not
+ *
+ *  @note DB_ACCESS_CACHE tables are already in memory and
+ *        DB_ACCESS_MMAP tables are only advised to the kernel.
+ *        DB_ACCESS_PAGED keeps at most its cache size of the range.
+ */
+bool db_prefetch(hdb h_db, uint32_t u32_first_id, uint32_t u32_num);
+
+/** @brief pick up records appended since the table was opened
+ * 
+ *  @param h_db database handle.
+ *  @param pu32_first_id returned id of the first new record, may be NULL.
+ *  @param pu32_num returned number of new records, may be NULL.
+ *  @return false if the table can not be followed and must be opened
+ *          again, e.g. after it was packed
+ *
+ *  @note only the new records are read; hash and ordered indexes are
+ *        extended with them, FoxPro index tags are not and key lookups
+ *        through a tag scan the new records after it. Record data
+ *        handed out before the call may be moved by it, and it must
+ *        not run while cursors of the handle are in use.
+ */
+bool db_refresh(hdb h_db, uint32_t *pu32_first_id, uint32_t *pu32_num);
+
+/** @brief refresh the table whenever it is written to
+ * 
+ *  @param h_db database handle.
+ *  @param u32_poll_ms longest wait between refreshes, for file systems
+ *         which do not report changes.
+ *  @param pf_follow callback after each refresh.
+ *  @param pv_usr_data user data of the callback.
+ *  @return false if a refresh failed, true when stopped by the callback
+ */
+bool db_follow(hdb h_db, uint32_t u32_poll_ms, db_pf_follow pf_follow, void *pv_usr_data);
+
 /** @brief get number of field
  * 
  *  @param h_db database handle
@@ -108,7 +297,7 @@ int16_t db_field_get_idx(hdb h_db, char *s_name);
  */
 struct db_var db_field_map_data(
         hdb h_db,
-        uint8_t *pu8_rec_data,
+        const uint8_t *pu8_rec_data,
         uint32_t u32_field_idx);
 
 /** @brief unmap mapped data
@@ -121,6 +310,144 @@ bool db_field_unmap_data(
         hdb h_db,
         struct db_var *pst_var);
 
+/** @brief create an arena for values of db_field_map_data_arena
+ * 
+ *  @param u32_blk_size bytes allocated at a time, 0 for the default.
+ *  @return arena handle, NULL on failure
+ *
+ *  @note an arena is not thread safe, use one per thread.
+ */
+hdb_arena db_arena_create(uint32_t u32_blk_size);
+
+/** @brief allocate memory from an arena
+ * 
+ *  @param h_arena arena handle.
+ *  @param u32_len number of bytes.
+ *  @return memory aligned to 8 bytes, NULL on failure
+ *
+ *  @note the memory is valid until the arena is reset or freed.
+ */
+void *db_arena_alloc(hdb_arena h_arena, uint32_t u32_len);
+
+/** @brief release everything allocated from an arena at once
+ * 
+ *  @param h_arena arena handle.
+ *
+ *  @note the memory is kept for the next allocations, so an arena
+ *        reset once per record or batch stops allocating once it
+ *        has grown to the largest record.
+ */
+void db_arena_reset(hdb_arena h_arena);
+
+/** @brief free an arena and everything allocated from it
+ * 
+ *  @param h_arena arena handle.
+ */
+void db_arena_free(hdb_arena h_arena);
+
+/** @brief retrive data to specific field into an arena
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data start address of record.
+ *  @param u32_field_idx target field index.
+ *  @param h_arena arena the data is allocated from.
+ *  @return data after mapping, as db_field_map_data
+ *
+ *  @note the data is valid until the arena is reset or freed and
+ *        must not be passed to db_field_unmap_data.
+ */
+struct db_var db_field_map_data_arena(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        hdb_arena h_arena);
+
+/** @brief view data of specific field without allocation
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data start address of record.
+ *  @param u32_field_idx target field index.
+ *  @param pst_view returned view to the field data.
+ *  @param pu8_scratch buffer for decoded types (T, M), may be NULL.
+ *  @param u32_scratch_len size of the scratch buffer.
+ *  @return function call success or not
+ *
+ *  @note C, N, F, D and L fields are returned in place, trimmed
+ *        of padding spaces and not NUL terminated; D fields are
+ *        returned as YYYYMMDD and an empty view means blank data.
+ *        T fields are formatted as "YYYY/MM/DD hh:mm:ss". M fields
+ *        point into the mapped memo file and stay valid until the
+ *        db is closed; when the memo file cannot be mapped they are
+ *        read into the scratch buffer and memo text longer than the
+ *        scratch buffer is truncated. Other types are returned as
+ *        raw field bytes.
+ */
+bool db_field_view(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        struct db_view *pst_view,
+        uint8_t *pu8_scratch,
+        uint32_t u32_scratch_len);
+
+/** @brief open a memo of specific record without reading its text
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data start address of record.
+ *  @param u32_field_idx index of an M field.
+ *  @param pst_memo returned memo handle, u32_len is 0 for blank memos.
+ *  @return function call success or not
+ *
+ *  @note the handle does not allocate and needs no closing, it
+ *        stays valid until the db is closed.
+ */
+bool db_memo_open(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        struct db_memo *pst_memo);
+
+/** @brief copy part of a memo
+ * 
+ *  @param h_db database handle.
+ *  @param pst_memo memo handle from db_memo_open.
+ *  @param u32_offset first byte of the memo to copy.
+ *  @param pu8_buf output buffer.
+ *  @param u32_buf_len size of the output buffer.
+ *  @return number of bytes copied, 0 at the end of the memo
+ */
+uint32_t db_memo_read(
+        hdb h_db,
+        const struct db_memo *pst_memo,
+        uint32_t u32_offset,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len);
+
+/** @brief get the memo text in place
+ * 
+ *  @param h_db database handle.
+ *  @param pst_memo memo handle from db_memo_open.
+ *  @return u32_len bytes of memo text, NULL for blank memos or
+ *          when the memo file is not mapped
+ */
+const uint8_t *db_memo_ptr(hdb h_db, const struct db_memo *pst_memo);
+
+/** @brief pass a memo to a writer in chunks
+ * 
+ *  @param h_db database handle.
+ *  @param pst_memo memo handle from db_memo_open.
+ *  @param u32_chunk_size largest chunk passed to the writer, 0 for default.
+ *  @param pf_writer writer called in memo order, returns false to stop.
+ *  @param pv_usr_data user data passed to the writer.
+ *  @return false if the memo could not be read
+ */
+bool db_memo_stream(
+        hdb h_db,
+        const struct db_memo *pst_memo,
+        uint32_t u32_chunk_size,
+        db_pf_memo_writer pf_writer,
+        void *pv_usr_data);
+
 bool db_field_cmp(
         hdb h_db,
         const uint8_t *pu8_rec_data,
@@ -136,6 +463,13 @@ bool db_field_cmp(
  *  @param pu8_cmp_data
  *  @param pf_cmp
  *  @return
+ *
+ *  @note when pf_cmp is NULL, pu8_cmp_data is a NUL terminated key
+ *        compared to the field data with padding spaces stripped;
+ *        the hash index of the field is used if it is built.
+ *  @note pu8_data of the record found points in place into the
+ *        record store, it must not be modified and is valid until
+ *        the next call on this handle; copy it to keep it.
  */
 struct db_record db_record_find(
         hdb h_db,
@@ -145,11 +479,794 @@ struct db_record db_record_find(
         db_pf_cmp pf_cmp,
         void *pv_usr_data);
 
+/** @brief build an in-memory hash index on specific field
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx target field index.
+ *  @return function call success or not
+ *
+ *  @note keys are the field data with padding spaces stripped,
+ *        the same as returned by db_field_view.
+ */
+bool db_index_build(hdb h_db, uint32_t u32_field_idx);
+
+/** @brief release the hash index of specific field
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx target field index.
+ *  @return function call success or not
+ */
+bool db_index_drop(hdb h_db, uint32_t u32_field_idx);
+
+/** @brief save built hash and ordered indexes to the sidecar file of
+ *         the database
+ * 
+ *  @param h_db database handle.
+ *  @return function call success or not
+ *
+ *  @note the sidecar (.HIX next to the .dbf) is attached by db_open
+ *        as long as the last update date, number of records and size
+ *        of the table still match; nothing is written when no index
+ *        was built or dropped since open.
+ */
+bool db_index_save(hdb h_db);
+
+/** @brief lookup the first record of a key in the hash index
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx indexed field.
+ *  @param pu8_key key data without padding.
+ *  @param u32_key_len length of the key.
+ *  @return matched record, u32_data_len is 0 if not found
+ *
+ *  @note falls back to a sequential scan if the field is not indexed.
+ */
+struct db_record db_index_find(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len);
+
+/** @brief lookup all records of a key in the hash index
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx indexed field.
+ *  @param pu8_key key data without padding.
+ *  @param u32_key_len length of the key.
+ *  @param pu32_rec_id returned record ids in ascending order.
+ *  @param u32_max capacity of pu32_rec_id.
+ *  @return total number of matched records, may exceed u32_max
+ *
+ *  @note falls back to a sequential scan if the field is not indexed.
+ */
+uint32_t db_index_find_all(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len,
+        uint32_t *pu32_rec_id,
+        uint32_t u32_max);
+
+/** @brief join two tables on equal field values
+ * 
+ *  @param h_left database handle of the left table.
+ *  @param u32_left_field key field of the left table.
+ *  @param h_right database handle of the right table, may be h_left.
+ *  @param u32_right_field key field of the right table.
+ *  @param u8_type join type (DB_JOIN_xxx).
+ *  @param pf_join callback receiving each pair.
+ *  @param pv_usr_data user data passed to pf_join.
+ *  @return false if stopped by pf_join or on failure
+ *
+ *  @note keys are compared without padding as by db_index_find. The
+ *        hash index of one side is built once with db_index_build and
+ *        kept, an indexed side is preferred and otherwise the smaller
+ *        one. Pairs come in record order of the other side, left
+ *        records without a match of DB_JOIN_LEFT follow the pairs when
+ *        the left side is the indexed one.
+ */
+bool db_join(
+        hdb h_left,
+        uint32_t u32_left_field,
+        hdb h_right,
+        uint32_t u32_right_field,
+        uint8_t u8_type,
+        db_pf_join pf_join,
+        void *pv_usr_data);
+
+/** @brief get number of FoxPro index tags
+ * 
+ *  @param h_db database handle.
+ *  @return number of tags from the structural .CDX and attached files
+ */
+uint16_t db_tag_get_num(hdb h_db);
+
+/** @brief retrive information of an index tag
+ * 
+ *  @param h_db database handle.
+ *  @param u16_tag_idx target tag index.
+ *  @param pst_info returned information.
+ *  @return function call success or not
+ */
+bool db_tag_get_info(hdb h_db, uint16_t u16_tag_idx, struct db_tag_info *pst_info);
+
+/** @brief lookup tag index from tag name
+ * 
+ *  @param h_db database handle.
+ *  @param s_name the name of the target tag (case insensitive).
+ *  @return an integer of tag index, -1 if not found
+ */
+int16_t db_tag_get_idx(hdb h_db, const char *s_name);
+
+/** @brief attach the tags of an extra .IDX or .CDX file
+ * 
+ *  @param h_db database handle.
+ *  @param s_file_name the name of the index file.
+ *  @return function call success or not
+ */
+bool db_tag_attach(hdb h_db, const char *s_file_name);
+
+/** @brief find the first record of a key through an index tag
+ * 
+ *  @param h_db database handle.
+ *  @param u16_tag_idx tag to search.
+ *  @param pu8_key key as field data, see db_field_view.
+ *  @param u32_key_len length of the key.
+ *  @return matched record, u32_data_len is 0 if not found
+ *
+ *  @note only tags on a plain field or UPPER(field) of type C, N, F,
+ *        D or I with machine collation in ascending order are
+ *        understood, and every hit is checked against the record.
+ *  @note db_record_find and db_index_find use a tag of the field when
+ *        it has no hash index, unless the tag is UPPER, UNIQUE or has
+ *        a FOR clause, the index file is older than the table or the
+ *        tag does not hold a key for every record; the result is the
+ *        same as that of a scan.
+ */
+struct db_record db_tag_seek(
+        hdb h_db,
+        uint16_t u16_tag_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len);
+
+/** @brief iterate records in tag order within a key range
+ * 
+ *  @param h_db database handle.
+ *  @param u16_tag_idx tag to walk.
+ *  @param pu8_lo lowest key as field data, NULL from the first key.
+ *  @param u32_lo_len length of the lowest key.
+ *  @param pu8_hi highest key as field data, NULL to the last key.
+ *  @param u32_hi_len length of the highest key.
+ *  @param pf_itor callback for each record, return false to stop.
+ *  @param pv_usr_data user data of the callback.
+ *  @return false if stopped by the callback or the tag is unusable
+ *
+ *  @note descending tags are refused.
+ */
+bool db_tag_range(
+        hdb h_db,
+        uint16_t u16_tag_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len,
+        db_pf_itor pf_itor,
+        void *pv_usr_data);
+
+/** @brief build an in-memory ordered index on a D or T field
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx target field index.
+ *  @return function call success or not
+ *
+ *  @note records with blank data are left out of the index. An index
+ *        saved by db_index_save is attached by db_open, so building
+ *        it again costs nothing while the table is unchanged.
+ */
+bool db_order_build(hdb h_db, uint32_t u32_field_idx);
+
+/** @brief release the ordered index of specific field
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx target field index.
+ *  @return function call success or not
+ */
+bool db_order_drop(hdb h_db, uint32_t u32_field_idx);
+
+/** @brief get the record ids of a date/time range in field order
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx field with an ordered index.
+ *  @param pu8_lo lowest date/time, NULL from the earliest record.
+ *  @param u32_lo_len length of the lowest date/time.
+ *  @param pu8_hi highest date/time, NULL to the latest record.
+ *  @param u32_hi_len length of the highest date/time.
+ *  @param ppu32_rec_id returned pointer to the record ids in the index.
+ *  @return number of record ids in the range
+ *
+ *  @note bounds are YYYYMMDD[hhmmss[mmm]], separators are skipped;
+ *        a bound without time covers the whole day. A bound with
+ *        other digits or an invalid date or time matches nothing.
+ *        The returned ids belong to the index and stay valid until
+ *        it is dropped.
+ */
+uint32_t db_order_slice(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len,
+        const uint32_t **ppu32_rec_id);
+
+/** @brief iterate the records of a date/time range in field order
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx field with an ordered index.
+ *  @param pu8_lo lowest date/time, NULL from the earliest record.
+ *  @param u32_lo_len length of the lowest date/time.
+ *  @param pu8_hi highest date/time, NULL to the latest record.
+ *  @param u32_hi_len length of the highest date/time.
+ *  @param pf_itor callback for each record, return false to stop.
+ *  @param pv_usr_data user data of the callback.
+ *  @return false if stopped by the callback or the field has no
+ *          ordered index
+ */
+bool db_order_range(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len,
+        db_pf_itor pf_itor,
+        void *pv_usr_data);
+
+/** @brief create a filter matching a field equal to a key
+ * 
+ *  @param h_db database handle the filter is evaluated on.
+ *  @param u32_field_idx target field index.
+ *  @param pu8_key key in the field format, see note.
+ *  @param u32_key_len length of the key.
+ *  @return filter handle, NULL on a malformed key
+ *
+ *  @note C and other text keys may be shorter than the field and are
+ *        padded with spaces, D keys are YYYYMMDD, N and F keys are
+ *        numbers in text compared by value, as doubles when the field
+ *        is wider than 18 digits with its decimals, I/Y/B/T keys are
+ *        the raw field bytes. Blank dates and numbers never match.
+ */
+hdb_filter db_filter_eq(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len);
+
+/** @brief create a filter matching a field starting with some bytes
+ * 
+ *  @param h_db database handle the filter is evaluated on.
+ *  @param u32_field_idx target field index.
+ *  @param pu8_key leading bytes of the field.
+ *  @param u32_key_len length of the leading bytes.
+ *  @return filter handle, NULL if longer than the field
+ */
+hdb_filter db_filter_prefix(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len);
+
+/** @brief create a filter matching a field between two keys, inclusive
+ * 
+ *  @param h_db database handle the filter is evaluated on.
+ *  @param u32_field_idx target field index.
+ *  @param pu8_lo lowest key as for db_filter_eq, NULL for no limit.
+ *  @param u32_lo_len length of the lowest key.
+ *  @param pu8_hi highest key as for db_filter_eq, NULL for no limit.
+ *  @param u32_hi_len length of the highest key.
+ *  @return filter handle, NULL on a malformed key
+ */
+hdb_filter db_filter_range(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_lo,
+        uint32_t u32_lo_len,
+        const uint8_t *pu8_hi,
+        uint32_t u32_hi_len);
+
+/** @brief create a filter matching a field equal to any of some keys
+ * 
+ *  @param h_db database handle the filter is evaluated on.
+ *  @param u32_field_idx target field index.
+ *  @param apu8_key keys as for db_filter_eq.
+ *  @param au32_key_len length of each key.
+ *  @param u32_key_num number of keys.
+ *  @return filter handle, NULL on a malformed key
+ */
+hdb_filter db_filter_in(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        const uint8_t * const *apu8_key,
+        const uint32_t *au32_key_len,
+        uint32_t u32_key_num);
+
+/** @brief combine filters, the new filter owns both
+ * 
+ *  @return filter handle, NULL if either one is NULL
+ */
+hdb_filter db_filter_and(hdb_filter h_left, hdb_filter h_right);
+hdb_filter db_filter_or(hdb_filter h_left, hdb_filter h_right);
+hdb_filter db_filter_not(hdb_filter h_filter);
+
+/** @brief release a filter and the filters it owns
+ * 
+ *  @param h_filter filter handle.
+ */
+void db_filter_free(hdb_filter h_filter);
+
+/** @brief evaluate a filter on raw record data
+ * 
+ *  @param h_filter filter handle.
+ *  @param pu8_rec_data record data.
+ *  @return record matches or not
+ */
+bool db_filter_match(hdb_filter h_filter, const uint8_t *pu8_rec_data);
+
+/** @brief find the first record matching a filter
+ * 
+ *  @param h_db database handle.
+ *  @param u32_start_idx start record index.
+ *  @param h_filter filter handle.
+ *  @return record, u32_data_len is 0 if not found
+ */
+struct db_record db_filter_find(hdb h_db, uint32_t u32_start_idx, hdb_filter h_filter);
+
+/** @brief find all records matching a filter
+ * 
+ *  @param h_db database handle.
+ *  @param h_filter filter handle.
+ *  @param pu32_rec_id returned record ids in ascending order.
+ *  @param u32_max_num size of pu32_rec_id.
+ *  @return number of matched records, may exceed u32_max_num
+ */
+uint32_t db_filter_find_all(
+        hdb h_db,
+        hdb_filter h_filter,
+        uint32_t *pu32_rec_id,
+        uint32_t u32_max_num);
+
+/** @brief compare one field of every record with vector instructions
+ * 
+ *  @param h_db database handle.
+ *  @param pst_scan condition to test.
+ *  @param pu64_sel returned bitmap of (record number+63)/64 words,
+ *         bit (id%64) of word (id/64) is set for a matching record.
+ *  @return number of matched records, 0 on an invalid condition
+ */
+uint32_t db_scan_bitmap(hdb h_db, const struct db_scan *pst_scan, uint64_t *pu64_sel);
+
+/** @brief compare one field of every record with vector instructions
+ * 
+ *  @param h_db database handle.
+ *  @param pst_scan condition to test.
+ *  @param pu32_rec_id returned record ids in ascending order.
+ *  @param u32_max_num size of pu32_rec_id.
+ *  @return number of matched records, may exceed u32_max_num
+ */
+uint32_t db_scan_ids(
+        hdb h_db,
+        const struct db_scan *pst_scan,
+        uint32_t *pu32_rec_id,
+        uint32_t u32_max_num);
+
+/** @brief copy some fields of a record range into typed column arrays
+ * 
+ *  @param h_db database handle.
+ *  @param au32_field_idx fields to copy.
+ *  @param u32_column_num number of fields.
+ *  @param u32_first_id first record of the range.
+ *  @param u32_row_num number of records, 0 up to the last record.
+ *  @param ast_column returned columns, one per field, released by
+ *         db_column_free.
+ *  @return function call success or not
+ *
+ *  @note C fields keep their bytes with the length of the text in
+ *        pu16_len; field types without a typed column, and I, B, Y or
+ *        T fields not of their binary length such as a dBase B memo
+ *        pointer, are copied as they are with the full field length.
+ *        Deleted records are projected too, flagged in pu8_deleted.
+ */
+bool db_project(
+        hdb h_db,
+        const uint32_t *au32_field_idx,
+        uint32_t u32_column_num,
+        uint32_t u32_first_id,
+        uint32_t u32_row_num,
+        struct db_column *ast_column);
+
+/** @brief release the arrays of columns filled by db_project
+ * 
+ *  @param ast_column columns.
+ *  @param u32_column_num number of columns.
+ */
+void db_column_free(struct db_column *ast_column, uint32_t u32_column_num);
+
+/** @brief get a N or F field as a fixed point number
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data record data.
+ *  @param u32_field_idx target field index.
+ *  @param u8_scale number of decimals kept, the value is multiplied
+ *         by 10^u8_scale and further decimals are dropped.
+ *  @param pi64_val returned value.
+ *  @return false if the field is blank, invalid, of another type or
+ *          the scaled value does not fit in int64
+ */
+bool db_field_get_fixed(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        uint8_t u8_scale,
+        int64_t *pi64_val);
+
+/** @brief get the integer part of a N or F field
+ * 
+ *  @see db_field_get_fixed
+ */
+bool db_field_get_int64(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int64_t *pi64_val);
+
+/** @brief get a N, F or B field as a double
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data record data.
+ *  @param u32_field_idx target field index.
+ *  @param pd_val returned value.
+ *  @return false if the field is blank, invalid or of another type
+ */
+bool db_field_get_double(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        double *pd_val);
+
+/** @brief get an I field
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data record data.
+ *  @param u32_field_idx target field index.
+ *  @param pi32_val returned value.
+ *  @return false if the field is of another type
+ */
+bool db_field_get_int32(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int32_t *pi32_val);
+
+/** @brief get a Y field in ten-thousandths
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data record data.
+ *  @param u32_field_idx target field index.
+ *  @param pi64_val returned value.
+ *  @return false if the field is of another type
+ */
+bool db_field_get_currency(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int64_t *pi64_val);
+
+/** @brief get a T field as milliseconds since 1970-01-01 UTC
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data record data.
+ *  @param u32_field_idx target field index.
+ *  @param pi64_ms returned value.
+ *  @return false if the field is blank or of another type
+ */
+bool db_field_get_time(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        int64_t *pi64_ms);
+
+/** @brief decode a N or F field of a record range as fixed point numbers
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx target field index.
+ *  @param u32_first_id first record of the range.
+ *  @param u32_num number of records.
+ *  @param u8_scale number of decimals kept as for db_field_get_fixed.
+ *  @param pi64_val returned values, u32_num entries.
+ *  @param pu8_null returned 1 for blank, invalid or overflowing values,
+ *         may be NULL.
+ *  @return number of decoded records
+ */
+uint32_t db_column_get_fixed(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        uint8_t u8_scale,
+        int64_t *pi64_val,
+        uint8_t *pu8_null);
+
+/** @brief decode a N or F field of a record range as doubles
+ * 
+ *  @see db_column_get_fixed
+ */
+uint32_t db_column_get_double(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        double *pd_val,
+        uint8_t *pu8_null);
+
+/** @brief look up the language driver byte of a code page name
+ * 
+ *  @param s_name "cp950", "windows-1252", "big5", "gbk", "utf-8", ...
+ *  @param pu8_code_page returned byte as in struct db_info, 0 for utf-8.
+ *  @return false if there is no built-in table for the code page
+ */
+bool db_cp_find(const char *s_name, uint8_t *pu8_code_page);
+
+/** @brief transcode text of a code page to UTF-8 into a caller buffer
+ * 
+ *  @param u8_code_page language driver byte as in struct db_info.
+ *  @param pu8_src text to transcode.
+ *  @param u32_src_len length of the text.
+ *  @param pu8_buf returned UTF-8 text, not terminated.
+ *  @param u32_buf_len size of pu8_buf, 3*u32_src_len always suffices.
+ *  @param pu32_used returned number of source bytes transcoded, may be NULL.
+ *  @return number of bytes written, the text is cut before the first
+ *          character not fitting into pu8_buf
+ *  @note nothing is allocated. Unmapped bytes become U+FFFD and text of
+ *        a code page without a table is copied as it is.
+ */
+uint32_t db_cp_to_utf8(
+        uint8_t u8_code_page,
+        const uint8_t *pu8_src,
+        uint32_t u32_src_len,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len,
+        uint32_t *pu32_used);
+
+/** @brief get a C field as UTF-8 using the code page of the table
+ * 
+ *  @param h_db database handle.
+ *  @param pu8_rec_data record data.
+ *  @param u32_field_idx target field index.
+ *  @param pu8_buf returned text without trailing spaces, not terminated.
+ *  @param u32_buf_len size of pu8_buf, 3 times the field length always suffices.
+ *  @param pu32_len returned length of the text.
+ *  @return false if the field is of another type or pu8_buf is too small
+ */
+bool db_field_get_utf8(
+        hdb h_db,
+        const uint8_t *pu8_rec_data,
+        uint32_t u32_field_idx,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len,
+        uint32_t *pu32_len);
+
+/** @brief get a C field of a record range as UTF-8
+ * 
+ *  @param h_db database handle.
+ *  @param u32_field_idx target field index.
+ *  @param u32_first_id first record of the range.
+ *  @param u32_num number of records.
+ *  @param pu8_buf returned texts back to back without trailing spaces.
+ *  @param u32_buf_len size of pu8_buf.
+ *  @param pu32_offset returned start of each text in pu8_buf plus the
+ *         end of the last one, u32_num+1 entries.
+ *  @return number of decoded records, fewer than u32_num when pu8_buf
+ *          is full
+ */
+uint32_t db_column_get_utf8(
+        hdb h_db,
+        uint32_t u32_field_idx,
+        uint32_t u32_first_id,
+        uint32_t u32_num,
+        uint8_t *pu8_buf,
+        uint32_t u32_buf_len,
+        uint32_t *pu32_offset);
+
+/** @brief skip records not matching a filter before the iterator runs
+ * 
+ *  @param h_db database handle with an initialized iterator.
+ *  @param h_filter filter handle, NULL for all records; still owned
+ *         by the caller and must outlive the iteration.
+ *  @return function call success or not
+ */
+bool db_itor_set_filter(hdb h_db, hdb_filter h_filter);
+
+/** @brief set the iterator called for each record by db_itor_start
+ * 
+ *  @param h_db database handle.
+ *  @param pf_itor iterator, return false to stop.
+ *  @param pv_usr_data user data of the iterator.
+ *  @return function call success or not
+ *
+ *  @note the record passed to the iterator points in place into the
+ *        record store, it must not be modified and is only valid
+ *        during the call; copy it to keep it.
+ */
+bool db_itor_init(hdb h_db, db_pf_itor pf_itor, void *pv_usr_data);
+
 /* itertation function */
-bool db_itor_init(hdb, db_pf_itor, void *);
 bool db_itor_start(hdb);
+
+/** @brief start the iteration with a pool of worker threads
+ * 
+ *  @param h_db database handle.
+ *  @param u32_worker_num number of threads, 0 for one per online cpu.
+ *  @param pf_merge NULL to stop all workers once the iterator returns
+ *         false; otherwise the records the iterator returned true for
+ *         are passed to it in record order after the scan.
+ *  @return false if stopped by a callback
+ *
+ *  @note the iterator of db_itor_init runs concurrently on disjoint
+ *        record ranges; it must not call functions of this handle
+ *        other than db_field_view and db_field_cmp.
+ */
+bool db_itor_start_parallel(hdb h_db, uint32_t u32_worker_num, db_pf_itor pf_merge);
+
+/** @brief iterate all records a block at a time
+ * 
+ *  @param h_db database handle.
+ *  @param u32_max_num most records per call, 0 for no limit.
+ *  @param pf_batch callback for each block, return false to stop.
+ *  @param pv_usr_data user data of the callback.
+ *  @return false if stopped by the callback
+ *
+ *  @note blocks point straight into the record cache, the mapping or
+ *        a cache block and are only valid during the callback.
+ */
+bool db_itor_start_batch(hdb h_db, uint32_t u32_max_num, db_pf_batch pf_batch, void *pv_usr_data);
+
 bool db_itor_deinit(hdb);
 
+/* cursor function, each cursor has its own position and record buffer
+ * so any number of them may read one handle from different threads */
+
+/** @brief open a cursor positioned at the first record
+ * 
+ *  @param h_db database handle.
+ *  @return cursor handle, NULL on failure
+ *
+ *  @note indexes and tags must not be built, dropped or attached
+ *        while cursors of the handle are in use.
+ */
+hdb_cursor db_cursor_open(hdb h_db);
+
+/** @brief close a cursor
+ * 
+ *  @param h_cursor cursor handle.
+ *  @return function call success or not
+ */
+bool db_cursor_close(hdb_cursor h_cursor);
+
+/** @brief skip records not matching a filter
+ * 
+ *  @param h_cursor cursor handle.
+ *  @param h_filter filter, NULL to visit all records.
+ *  @return function call success or not
+ *
+ *  @note the filter is not copied and must outlive its use.
+ */
+bool db_cursor_set_filter(hdb_cursor h_cursor, hdb_filter h_filter);
+
+/** @brief move a cursor back to the first record
+ * 
+ *  @param h_cursor cursor handle.
+ *  @return function call success or not
+ */
+bool db_cursor_rewind(hdb_cursor h_cursor);
+
+/** @brief find the next record whose field equals the key
+ * 
+ *  @param h_cursor cursor handle.
+ *  @param u32_field_idx target field index.
+ *  @param pu8_key key, trailing spaces are ignored.
+ *  @param u32_key_len key length.
+ *  @return record found, pu8_data is NULL if none
+ *
+ *  @note the search starts at the cursor position and leaves the
+ *        cursor after the record found. Records returned are valid
+ *        until the next call on the same cursor.
+ */
+struct db_record db_cursor_find(
+        hdb_cursor h_cursor,
+        uint32_t u32_field_idx,
+        const uint8_t *pu8_key,
+        uint32_t u32_key_len);
+
+/** @brief find the next record matching the cursor filter
+ * 
+ *  @param h_cursor cursor handle with a filter set.
+ *  @return record found, pu8_data is NULL if none
+ */
+struct db_record db_cursor_find_filter(hdb_cursor h_cursor);
+
+/** @brief move a cursor to a record
+ * 
+ *  @param h_cursor cursor handle.
+ *  @param u32_rec_id next record to visit, the record number to move
+ *         past the last record.
+ *  @return false if the record does not exist
+ */
+bool db_cursor_seek(hdb_cursor h_cursor, uint32_t u32_rec_id);
+
+/** @brief get the position of a cursor
+ * 
+ *  @param h_cursor cursor handle.
+ *  @return next record to visit, to resume later with db_cursor_seek
+ */
+uint32_t db_cursor_tell(hdb_cursor h_cursor);
+
+/** @brief read the record at the cursor and move past it
+ * 
+ *  @param h_cursor cursor handle.
+ *  @return next record matching the cursor filter, pu8_data is NULL
+ *          at the end of the table
+ *
+ *  @note the record is valid until the next call on the same cursor.
+ */
+struct db_record db_cursor_next(hdb_cursor h_cursor);
+
+/** @brief read up to u32_max_num records at the cursor and move past them
+ * 
+ *  @param h_cursor cursor handle.
+ *  @param pst_record returned records.
+ *  @param u32_max_num size of the pst_record array.
+ *  @return number of records returned, 0 at the end of the table
+ *
+ *  @note records point into the record cache or the mapping when the
+ *        table is resident and into a cursor buffer otherwise; they
+ *        are valid until the next call on the same cursor.
+ */
+uint32_t db_cursor_next_batch(hdb_cursor h_cursor, struct db_record *pst_record, uint32_t u32_max_num);
+
+/** @brief iterate records from the cursor position
+ * 
+ *  @param h_cursor cursor handle.
+ *  @param pf_itor callback for each record, return false to stop.
+ *  @param pv_usr_data user data of the callback.
+ *  @return false if stopped by the callback
+ *
+ *  @note the cursor is left after the last record visited, so a
+ *        stopped iteration resumes where it stopped.
+ */
+bool db_cursor_iterate(hdb_cursor h_cursor, db_pf_itor pf_itor, void *pv_usr_data);
+
+/** @brief write the records of a table as CSV or JSON Lines
+ * 
+ *  @param h_db database handle.
+ *  @param pst_export output format, fields and records to write.
+ *  @param pf_writer called with each block of output, in record order.
+ *  @param pv_usr_data user data of the writer.
+ *  @return false on failure or if stopped by the writer
+ *
+ *  @note text is transcoded to UTF-8 with the code page of the table.
+ *        Blank dates, numbers and memos are empty in CSV and null in
+ *        JSON; dates are YYYY-MM-DD and datetimes YYYY-MM-DDThh:mm:ss.
+ *        With several workers each chunk of records is formatted by
+ *        its own thread and the writer is called from any of them,
+ *        one call at a time; workers wait rather than format chunks
+ *        far ahead of the writer.
+ */
+bool db_export(
+        hdb h_db,
+        const struct db_export *pst_export,
+        db_pf_export_writer pf_writer,
+        void *pv_usr_data);
+
 /* debug function */
 void db_dump_field_desc(hdb);
 void db_dump_record(hdb);
@@ -14,32 +14,55 @@ struct context
 
     char *date;
     char date2[11];
+    char date3[9];
     char *type;
     db_pf_itor itor;
+
+    /* mapped fields of the current record */
+    hdb_arena h_arena;
 };
 
-static bool _cmp_id(
-    hdb h_db,
-    const uint8_t *pu8_data1,
-    const uint8_t *pu8_data2,
-    void *pv_usr_data)
+const char s_deliver[]={0xb0, 0x65, 0xb3, 0x66, 0x00};
+const char s_taichung[]={0xa5, 0x78, 0xa4, 0xa4, 0xa5, 0xab};
+
+/* print text of a table as UTF-8, the tables keep it in their code page */
+static void _print_text(hdb h_db, const char *s_text)
 {
-    if(0 == strcmp((char *)pu8_data1, (char *)pu8_data2))
-        return true;
+    struct db_info st_info;
+    uint8_t au8_buf[256];
+    uint32_t u32_len = (s_text)?(strlen(s_text)):(0);
 
-    return false;
-}
+    if(false == db_get_info(h_db, &st_info))
+        return;
 
-const char s_deliver[]={0xb0, 0x65, 0xb3, 0x66, 0x00};
-const char s_taichung[]={0xa5, 0x78, 0xa4, 0xa4, 0xa5, 0xab};
+    while(u32_len > 0)
+    {
+        uint32_t u32_used;
+        uint32_t u32_out = db_cp_to_utf8(
+                st_info.u8_code_page,
+                (const uint8_t *)s_text,
+                u32_len,
+                au8_buf,
+                sizeof(au8_buf),
+                &u32_used);
+
+        fwrite(au8_buf, 1, u32_out, stdout);
+
+        if(0 == u32_used)
+            break;
+
+        s_text += u32_used;
+        u32_len -= u32_used;
+    }
+}
 
 static bool _dump_service(
     hdb h_db,
     const struct db_record *pst_record,
     void *pv_data)
 {
-    struct db_var st_date;
-    struct db_var st_cust_id;
+    struct db_view st_date;
+    struct db_view st_cust_id;
     struct db_var st_cust_name;
     struct db_var st_deliv_addr;
     struct db_var st_serv_item;
@@ -47,85 +70,98 @@ static bool _dump_service(
     struct db_record st_rec_cust;
     struct db_record st_rec_item;
     struct context *pst_ctx;
+    hdb h_text_db = h_db;
     char *s_item;
     char *s_type;
     bool b_ret = true;
 
     pst_ctx = (struct context *)pv_data;
-    st_date = db_field_map_data(
+    if(false == db_field_view(
             h_db,
             pst_record->pu8_data,
-            53);
-
-    if(NULL == st_date.pv_data)
+            53,
+            &st_date,
+            NULL,
+            0))
         return true;
 
-    if(0 == strncmp((char *)st_date.pv_data, pst_ctx->date, 10))
+    if((8 == st_date.u32_data_len) && (0 == memcmp(st_date.pu8_data, pst_ctx->date3, 8)))
     {
-        st_cust_id = db_field_map_data(
+        db_field_view(
                 h_db,
                 pst_record->pu8_data,
+                0,
+                &st_cust_id,
+                NULL,
                 0);
 
-        st_rec_cust = db_record_find(
+        st_rec_cust = db_index_find(
                 pst_ctx->h_cust_db,
-                0,
                 1,
-                st_cust_id.pv_data,
-                _cmp_id,
-                NULL);
+                st_cust_id.pu8_data,
+                st_cust_id.u32_data_len);
 
         if(0 == st_rec_cust.u32_data_len)
         {
-            printf("fail to find customer id [%s].", (char *)st_cust_id.pv_data);
+            printf("fail to find customer id [%.*s].", (int)st_cust_id.u32_data_len, (char *)st_cust_id.pu8_data);
             b_ret = false;
         }
         else
         {
-            st_cust_name = db_field_map_data(
+            db_arena_reset(pst_ctx->h_arena);
+
+            st_cust_name = db_field_map_data_arena(
                     pst_ctx->h_cust_db,
                     st_rec_cust.pu8_data,
-                    4);
+                    4,
+                    pst_ctx->h_arena);
 
-            st_deliv_addr = db_field_map_data(
+            st_deliv_addr = db_field_map_data_arena(
                     h_db,
                     pst_record->pu8_data,
-                    11);
+                    11,
+                    pst_ctx->h_arena);
 
-            st_serv_content = db_field_map_data(
+            st_serv_content = db_field_map_data_arena(
                     h_db,
                     pst_record->pu8_data,
-                    52);
+                    52,
+                    pst_ctx->h_arena);
 
-            st_serv_item = db_field_map_data(
+            st_serv_item = db_field_map_data_arena(
                     h_db,
                     pst_record->pu8_data,
-                    51);
+                    51,
+                    pst_ctx->h_arena);
 
-            s_type = ('R' == *(char *)st_serv_item.pv_data)?("RO"):(pst_ctx->type);
+            s_type = ((st_serv_item.pv_data) && ('R' == *(char *)st_serv_item.pv_data))?("RO"):(pst_ctx->type);
             s_item = (char *)st_serv_content.pv_data;
 
-            if(0 == st_serv_content.u32_data_len)
+            if((0 == st_serv_content.u32_data_len) && (NULL != st_serv_item.pv_data))
             {
                 st_rec_item = db_record_find(
                         pst_ctx->h_item_db,
                         0,
                         0,
                         st_serv_item.pv_data,
-                        _cmp_id,
+                        NULL,
                         NULL);
 
-                db_field_unmap_data(h_db, &st_serv_item);
-
                 if (0 != st_rec_item.u32_data_len)
                 {
-                    st_serv_item = db_field_map_data(
+                    st_serv_item = db_field_map_data_arena(
                             pst_ctx->h_item_db,
                             st_rec_item.pu8_data,
-                            1);
+                            1,
+                            pst_ctx->h_arena);
+                    h_text_db = pst_ctx->h_item_db;
+                    s_item = (char *)st_serv_item.pv_data;
+                }
+                else
+                {
+                    /* unknown item, print its code as recorded */
+                    s_item = (char *)st_serv_item.pv_data;
                 }
-
-                s_item = (char *)st_serv_item.pv_data;
             }
 
             if(NULL == s_item)
@@ -133,25 +169,20 @@ static bool _dump_service(
                 s_item = "";
             }
 
-            printf("'(%s)%s','%s','%s'",
-                    s_type,
-                    (char *)st_cust_name.pv_data,
-                    (char *)st_deliv_addr.pv_data,
-                    s_item
-                  );
+            printf("'(");
+            _print_text(h_db, s_type);
+            printf(")");
+            _print_text(pst_ctx->h_cust_db, (char *)st_cust_name.pv_data);
+            printf("','");
+            _print_text(h_db, (char *)st_deliv_addr.pv_data);
+            printf("','");
+            _print_text(h_text_db, s_item);
+            printf("'");
 
             printf("\n");
-
-            db_field_unmap_data(h_db, &st_cust_id);
-            db_field_unmap_data(pst_ctx->h_item_db, &st_serv_item);
-            db_field_unmap_data(pst_ctx->h_item_db, &st_serv_content);
-            db_field_unmap_data(h_db, &st_deliv_addr);
-            db_field_unmap_data(pst_ctx->h_cust_db, &st_cust_name);
         }
     }
 
-    db_field_unmap_data(h_db, &st_date);
-
     return b_ret;
 }
 
@@ -160,8 +191,8 @@ static bool _dump_deliver(
     const struct db_record *pst_record,
     void *pv_data)
 {
-    struct db_var st_date;
-    struct db_var st_cust_id;
+    struct db_view st_date;
+    struct db_view st_cust_id;
     struct db_var st_cust_name;
     struct db_var st_deliv_addr;
     struct db_record st_rec_cust;
@@ -169,63 +200,66 @@ static bool _dump_deliver(
     bool b_ret = true;
 
     pst_ctx = (struct context *)pv_data;
-    st_date = db_field_map_data(
+    if(false == db_field_view(
             h_db,
             pst_record->pu8_data,
-            5);
-
-    if(NULL == st_date.pv_data)
+            5,
+            &st_date,
+            NULL,
+            0))
         return true;
 
-    if(0 == strncmp((char *)st_date.pv_data, pst_ctx->date2, 10))
+    if((10 <= st_date.u32_data_len) && (0 == memcmp(st_date.pu8_data, pst_ctx->date2, 10)))
     {
-        st_cust_id = db_field_map_data(
+        db_field_view(
                 h_db,
                 pst_record->pu8_data,
+                0,
+                &st_cust_id,
+                NULL,
                 0);
 
-        st_rec_cust = db_record_find(
+        st_rec_cust = db_index_find(
                 pst_ctx->h_cust_db,
-                0,
                 1,
-                st_cust_id.pv_data,
-                _cmp_id,
-                NULL);
+                st_cust_id.pu8_data,
+                st_cust_id.u32_data_len);
 
         if(0 == st_rec_cust.u32_data_len)
         {
-            printf("fail to find customer id [%s].", (char *)st_cust_id.pv_data);
+            printf("fail to find customer id [%.*s].", (int)st_cust_id.u32_data_len, (char *)st_cust_id.pu8_data);
             b_ret = false;
         }
         else
         {
-            st_cust_name = db_field_map_data(
+            db_arena_reset(pst_ctx->h_arena);
+
+            st_cust_name = db_field_map_data_arena(
                     pst_ctx->h_cust_db,
                     st_rec_cust.pu8_data,
-                    4);
+                    4,
+                    pst_ctx->h_arena);
 
-            st_deliv_addr = db_field_map_data(
+            st_deliv_addr = db_field_map_data_arena(
                     h_db,
                     pst_record->pu8_data,
-                    11);
-
-            printf("'(%s)%s','%s','%s'",
-                    pst_ctx->type,
-                    (char *)st_cust_name.pv_data,
-                    (char *)st_deliv_addr.pv_data,
-                    s_deliver
-                  );
+                    11,
+                    pst_ctx->h_arena);
+
+            printf("'(");
+            _print_text(h_db, pst_ctx->type);
+            printf(")");
+            _print_text(pst_ctx->h_cust_db, (char *)st_cust_name.pv_data);
+            printf("','");
+            _print_text(h_db, (char *)st_deliv_addr.pv_data);
+            printf("','");
+            _print_text(h_db, s_deliver);
+            printf("'");
 
             printf("\n");
-
-            db_field_unmap_data(h_db, &st_cust_id);
-            db_field_unmap_data(h_db, &st_deliv_addr);
-            db_field_unmap_data(pst_ctx->h_cust_db, &st_cust_name);
         }
     }
 
-    db_field_unmap_data(h_db, &st_date);
-
     return b_ret;
 }
 
@@ -236,35 +270,38 @@ static bool _iterator(
 {
     bool b_ret = true;
     struct context *pst_ctx = (struct context *)pv_data;
-    struct db_var st_type;
+    struct db_view st_type;
 
-    st_type = db_field_map_data(
+    if(false == db_field_view(
             h_db,
             pst_record->pu8_data,
-            1);
+            1,
+            &st_type,
+            NULL,
+            0))
+        return b_ret;
 
-    if(0 == strncmp((char *)st_type.pv_data, pst_ctx->type, 2))
+    if((2 <= st_type.u32_data_len) && (0 == memcmp(st_type.pu8_data, pst_ctx->type, 2)))
     {
         b_ret = pst_ctx->itor(h_db, pst_record, pv_data);
     }
 
-    db_field_unmap_data(h_db, &st_type);
-
     return b_ret;
 }
 
-static void _convert_date_format(char *s_src, char *s_trg)
+static void _convert_date_format(char *s_src, char *s_trg, char *s_trg_raw)
 {
     int year;
     int month;
     int day;
     char *s_str = strdup(s_src);
 
-    year = atoi(strtok(s_str, "/")) - 1911;
+    year = atoi(strtok(s_str, "/"));
     month = atoi(strtok(NULL, "/"));
     day = atoi(strtok(NULL, "/"));
 
-    sprintf(s_trg, "%04d.%02d.%02d", year, month, day);
+    sprintf(s_trg, "%04d.%02d.%02d", year - 1911, month, day);
+    sprintf(s_trg_raw, "%04d%02d%02d", year, month, day);
 }
 
 int main(int argc, char **argv)
@@ -272,6 +309,7 @@ int main(int argc, char **argv)
     struct context ctx = {0};
     char s_type_service[]={0xaa, 0x41, 0x00};
     char s_type_deliver[]={0xa5, 0x58, 0x00};
+    hdb_filter h_filter;
 
     char *s_db_ship=argv[2];
     char *s_db_cust=argv[3];
@@ -304,18 +342,50 @@ int main(int argc, char **argv)
         return 2;
     }
 
+    /* customer and item lookups are keyed on a single field, the
+     * indexes are kept next to the tables for the next run */
+    db_index_build(ctx.h_cust_db, 1);
+    db_index_build(ctx.h_item_db, 0);
+    db_index_save(ctx.h_cust_db);
+    db_index_save(ctx.h_item_db);
+
+    ctx.h_arena = db_arena_create(0);
+    if(NULL == ctx.h_arena)
+    {
+        printf("fail to create arena.\n");
+        return 3;
+    }
+
     ctx.date = argv[1];
-    _convert_date_format(argv[1], ctx.date2);
+    _convert_date_format(argv[1], ctx.date2, ctx.date3);
 
     /* service type */
     ctx.type = s_type_service;
     ctx.itor = _dump_service;
 
-    if(false == db_itor_init(ctx.h_ship_db, _iterator, &ctx))
-        return 4;
+    /* services are picked by date, the ordered index of the date is
+     * kept next to the table so a run only visits the rows of that day */
+    if(true == db_order_build(ctx.h_ship_db, 53))
+    {
+        db_index_save(ctx.h_ship_db);
+        db_order_range(
+                ctx.h_ship_db,
+                53,
+                (const uint8_t *)ctx.date3,
+                8,
+                (const uint8_t *)ctx.date3,
+                8,
+                _iterator,
+                &ctx);
+    }
+    else
+    {
+        if(false == db_itor_init(ctx.h_ship_db, _iterator, &ctx))
+            return 4;
 
-    db_itor_start(ctx.h_ship_db);
-    db_itor_deinit(ctx.h_ship_db);
+        db_itor_start(ctx.h_ship_db);
+        db_itor_deinit(ctx.h_ship_db);
+    }
 
     /* deliver type */
     ctx.type = s_type_deliver;
@@ -324,8 +394,16 @@ int main(int argc, char **argv)
     if(false == db_itor_init(ctx.h_ship_db, _iterator, &ctx))
         return 4;
 
+    /* only records of the type and day reach the callbacks */
+    h_filter = db_filter_and(
+            db_filter_prefix(ctx.h_ship_db, 1, (const uint8_t *)ctx.type, 2),
+            db_filter_prefix(ctx.h_ship_db, 5, (const uint8_t *)ctx.date2, 10));
+    db_itor_set_filter(ctx.h_ship_db, h_filter);
+
     db_itor_start(ctx.h_ship_db);
     db_itor_deinit(ctx.h_ship_db);
+    db_filter_free(h_filter);
+    db_arena_free(ctx.h_arena);
 
     db_close(ctx.h_item_db);
     db_close(ctx.h_cust_db);
@@ -81,9 +81,37 @@ static void _dump_db_records(hdb h_db)
     }
 }
 
+static bool _export_writer(
+        const uint8_t *pu8_data,
+        uint32_t u32_len,
+        void *pv_data)
+{
+    return (u32_len == fwrite(pu8_data, 1, u32_len, stdout));
+}
+
+/* "export=csv" or "export=jsonl" in the config writes the records
+ * with db_export instead of the quoted dump */
+static bool _export_db_records(hdb h_db, const char *s_format)
+{
+    struct db_export st_export = {.u32_worker_num=1,.b_header=true};
+
+    if(0 == strcmp(s_format, "csv"))
+        st_export.u8_format = DB_EXPORT_CSV;
+    else if(0 == strcmp(s_format, "jsonl"))
+        st_export.u8_format = DB_EXPORT_JSONL;
+    else
+    {
+        printf("unknown export format: %s\n", s_format);
+        return false;
+    }
+
+    return db_export(h_db, &st_export, _export_writer, NULL);
+}
+
 int main(int argc, char **argv)
 {
     struct config *pst_config;
+    const char *s_export;
     hdb h_db;
 
     pst_config = config_init(argv[1]);
@@ -95,9 +123,17 @@ int main(int argc, char **argv)
 
     h_db = db_open(pst_config->pf_get(pst_config, "db_name"));
 
-    _dump_db_info(h_db);
-    _dump_db_fields(h_db);
-    _dump_db_records(h_db);
+    s_export = pst_config->pf_get(pst_config, "export");
+    if(NULL != s_export)
+    {
+        _export_db_records(h_db, s_export);
+    }
+    else
+    {
+        _dump_db_info(h_db);
+        _dump_db_fields(h_db);
+        _dump_db_records(h_db);
+    }
 
     db_close(h_db);
 
@@ -0,0 +1,1266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "db.h"
+
+struct test_field
+{
+    char *s_name;
+    char c_type;
+    uint8_t u8_len;
+    uint8_t u8_dec;
+};
+
+struct test_case
+{
+    char *s_name;
+    bool (*pf_run)(void);
+};
+
+struct test_follow
+{
+    uint32_t u32_call;
+    bool b_pass;
+};
+
+struct test_join
+{
+    uint32_t u32_num;
+    uint32_t au32_pair[8][2];
+};
+
+struct test_buf
+{
+    uint8_t *pu8_data;
+    size_t t_len;
+};
+
+static char s_table[64];
+static char s_index[64];
+static char s_memo[64];
+
+/* write a dBASE III table of text records, each record is the field
+ * data laid out back to back */
+static bool _table_write(
+    const char *s_file_name,
+    const struct test_field *ast_field,
+    uint32_t u32_field_num,
+    const char **as_rec,
+    uint32_t u32_rec_num)
+{
+    uint8_t au8_hdr[32] = {0};
+    uint16_t u16_hdr_len = 32+32*u32_field_num+1;
+    uint16_t u16_rec_len = 1;
+    FILE *fp;
+
+    for(uint32_t idx=0; idx<u32_field_num; idx++)
+        u16_rec_len += ast_field[idx].u8_len;
+
+    fp = fopen(s_file_name, "wb");
+    if(NULL == fp)
+        return false;
+
+    au8_hdr[0] = 0x03;
+    au8_hdr[1] = 118;
+    au8_hdr[2] = 1;
+    au8_hdr[3] = 1;
+    au8_hdr[4] = u32_rec_num;
+    au8_hdr[5] = u32_rec_num>>8;
+    au8_hdr[6] = u32_rec_num>>16;
+    au8_hdr[7] = u32_rec_num>>24;
+    au8_hdr[8] = u16_hdr_len;
+    au8_hdr[9] = u16_hdr_len>>8;
+    au8_hdr[10] = u16_rec_len;
+    au8_hdr[11] = u16_rec_len>>8;
+    fwrite(au8_hdr, 1, sizeof(au8_hdr), fp);
+
+    for(uint32_t idx=0; idx<u32_field_num; idx++)
+    {
+        uint8_t au8_field[32] = {0};
+
+        strncpy((char *)au8_field, ast_field[idx].s_name, 10);
+        au8_field[11] = ast_field[idx].c_type;
+        au8_field[16] = ast_field[idx].u8_len;
+        au8_field[17] = ast_field[idx].u8_dec;
+        fwrite(au8_field, 1, sizeof(au8_field), fp);
+    }
+
+    fputc(0x0d, fp);
+
+    for(uint32_t idx=0; idx<u32_rec_num; idx++)
+    {
+        fputc(' ', fp);
+        fwrite(as_rec[idx], 1, u16_rec_len-1, fp);
+    }
+
+    fputc(0x1a, fp);
+
+    return 0 == fclose(fp);
+}
+
+/* append text records to a table written by _table_write */
+static bool _table_append(const char *s_file_name, const char **as_rec, uint32_t u32_rec_num)
+{
+    uint8_t au8_hdr[12];
+    uint32_t u32_old_num;
+    uint16_t u16_hdr_len;
+    uint16_t u16_rec_len;
+    FILE *fp;
+
+    fp = fopen(s_file_name, "r+b");
+    if(NULL == fp)
+        return false;
+
+    if(sizeof(au8_hdr) != fread(au8_hdr, 1, sizeof(au8_hdr), fp))
+    {
+        fclose(fp);
+        return false;
+    }
+
+    u32_old_num = au8_hdr[4] | au8_hdr[5]<<8 | au8_hdr[6]<<16 | (uint32_t)au8_hdr[7]<<24;
+    u16_hdr_len = au8_hdr[8] | au8_hdr[9]<<8;
+    u16_rec_len = au8_hdr[10] | au8_hdr[11]<<8;
+
+    /* records first, the header count last as a writer would */
+    fseek(fp, u16_hdr_len+(long)u32_old_num*u16_rec_len, SEEK_SET);
+    for(uint32_t idx=0; idx<u32_rec_num; idx++)
+    {
+        fputc(' ', fp);
+        fwrite(as_rec[idx], 1, u16_rec_len-1, fp);
+    }
+
+    fputc(0x1a, fp);
+
+    u32_old_num += u32_rec_num;
+    au8_hdr[4] = u32_old_num;
+    au8_hdr[5] = u32_old_num>>8;
+    au8_hdr[6] = u32_old_num>>16;
+    au8_hdr[7] = u32_old_num>>24;
+    fseek(fp, 4, SEEK_SET);
+    fwrite(&au8_hdr[4], 1, 4, fp);
+
+    return 0 == fclose(fp);
+}
+
+/* mark a record of a table written by _table_write deleted */
+static bool _table_delete(const char *s_file_name, uint32_t u32_rec_id)
+{
+    uint8_t au8_hdr[12];
+    FILE *fp;
+
+    fp = fopen(s_file_name, "r+b");
+    if(NULL == fp)
+        return false;
+
+    if(sizeof(au8_hdr) == fread(au8_hdr, 1, sizeof(au8_hdr), fp))
+    {
+        fseek(fp, (au8_hdr[8] | au8_hdr[9]<<8)+(long)u32_rec_id*(au8_hdr[10] | au8_hdr[11]<<8), SEEK_SET);
+        fputc('*', fp);
+    }
+
+    return 0 == fclose(fp);
+}
+
+/* write the .FPT of a table written by _table_write in blocks of 64
+ * bytes, the memos start at block 8 each on a block of its own */
+static bool _memo_write(const char *s_file_name, const char **as_memo, uint32_t u32_memo_num)
+{
+    uint8_t au8_hdr[512] = {0};
+    uint32_t u32_blk_idx = 8;
+    FILE *fp;
+
+    fp = fopen(s_file_name, "r+b");
+    if(NULL == fp)
+        return false;
+
+    /* the table has a memo file */
+    fseek(fp, 28, SEEK_SET);
+    fputc(0x02, fp);
+    if(0 != fclose(fp))
+        return false;
+
+    fp = fopen(s_memo, "wb");
+    if(NULL == fp)
+        return false;
+
+    for(uint32_t idx=0; idx<u32_memo_num; idx++)
+        u32_blk_idx += (8+strlen(as_memo[idx])+63)/64;
+
+    au8_hdr[0] = u32_blk_idx>>24;
+    au8_hdr[1] = u32_blk_idx>>16;
+    au8_hdr[2] = u32_blk_idx>>8;
+    au8_hdr[3] = u32_blk_idx;
+    au8_hdr[7] = 64;
+    fwrite(au8_hdr, 1, sizeof(au8_hdr), fp);
+
+    for(uint32_t idx=0; idx<u32_memo_num; idx++)
+    {
+        uint32_t u32_len = strlen(as_memo[idx]);
+        uint8_t au8_blk[8] = {0, 0, 0, 1, u32_len>>24, u32_len>>16, u32_len>>8, u32_len};
+        uint8_t au8_pad[64] = {0};
+
+        fwrite(au8_blk, 1, sizeof(au8_blk), fp);
+        fwrite(as_memo[idx], 1, u32_len, fp);
+        fwrite(au8_pad, 1, (64-(8+u32_len)%64)%64, fp);
+    }
+
+    return 0 == fclose(fp);
+}
+
+/* write a single .IDX of one leaf, keys sorted with their record ids */
+static bool _index_write(
+    const char *s_file_name,
+    const char *s_expr,
+    uint8_t u8_option,
+    uint16_t u16_key_len,
+    const char **as_key,
+    const uint32_t *au32_rec_id,
+    uint32_t u32_key_num)
+{
+    uint8_t au8_node[1024] = {0};
+    uint8_t *pu8_entry = &au8_node[512+12];
+    FILE *fp;
+
+    /* header: root node, key length, options and expression */
+    au8_node[1] = 2;
+    au8_node[12] = u16_key_len;
+    au8_node[13] = u16_key_len>>8;
+    au8_node[14] = u8_option;
+    strncpy((char *)&au8_node[16], s_expr, 220);
+
+    /* root leaf without siblings */
+    au8_node[512] = 3;
+    au8_node[512+2] = u32_key_num;
+    au8_node[512+3] = u32_key_num>>8;
+    memset(&au8_node[512+4], 0xff, 8);
+
+    for(uint32_t idx=0; idx<u32_key_num; idx++, pu8_entry+=u16_key_len+4)
+    {
+        uint32_t u32_rec_no = au32_rec_id[idx]+1;
+
+        memcpy(pu8_entry, as_key[idx], u16_key_len);
+        pu8_entry[u16_key_len] = u32_rec_no>>24;
+        pu8_entry[u16_key_len+1] = u32_rec_no>>16;
+        pu8_entry[u16_key_len+2] = u32_rec_no>>8;
+        pu8_entry[u16_key_len+3] = u32_rec_no;
+    }
+
+    fp = fopen(s_file_name, "wb");
+    if(NULL == fp)
+        return false;
+
+    fwrite(au8_node, 1, sizeof(au8_node), fp);
+
+    return 0 == fclose(fp);
+}
+
+/* binary fields are decoded only at the width of their type */
+static bool _test_field_map_bin(void)
+{
+    struct test_field ast_field[] =
+    {
+        {"QTY", 'I', 4, 0}, {"VAL", 'B', 8, 0}, {"COST", 'Y', 8, 0},
+        {"STAMP", 'T', 8, 0}, {"MEMO", 'B', 10, 0}, {"WIDE", 'I', 6, 0},
+    };
+    const char *as_rec[] =
+    {
+        "\xf9\xff\xff\xff" "\x00\x00\x00\x00\x00\x00\x29\x40"
+        "\x40\xe2\x01\x00\x00\x00\x00\x00" "\x2b\x82\x25\x00\x80\x29\xb3\x02"
+        "         3" "    42",
+    };
+    const char *as_expect[] = {"-7", "12.5", "12.3456", "2018/02/05 12:34:56", "         3 ", "    42 "};
+    struct db_record st_record;
+    struct db_var st_var;
+    hdb_cursor h_cursor;
+    hdb h_db;
+    bool b_ret;
+
+    if(false == _table_write(s_table, ast_field, 6, as_rec, 1))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    h_cursor = db_cursor_open(h_db);
+    st_record = db_cursor_next(h_cursor);
+    b_ret = (NULL != st_record.pu8_data);
+    for(uint32_t idx=0; (idx<6) && (true == b_ret); idx++)
+    {
+        st_var = db_field_map_data(h_db, st_record.pu8_data, idx);
+        b_ret = (NULL != st_var.pv_data) && (0 == strcmp((char *)st_var.pv_data, as_expect[idx]));
+        db_field_unmap_data(h_db, &st_var);
+    }
+
+    db_cursor_close(h_cursor);
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* numbers of a max-width N field do not fit the fixed point keys */
+static bool _test_filter_wide_num(void)
+{
+    struct test_field ast_field[] = {{"VAL", 'N', 20, 0}};
+    const char *as_rec[] =
+    {
+        "99999999999999999999",
+        " 9223372036854775807",
+        "                   1",
+        "-9999999999999999999",
+        "                    ",
+    };
+    uint32_t au32_id[8];
+    hdb_filter h_filter;
+    hdb h_db;
+    bool b_ret = false;
+
+    if(false == _table_write(s_table, ast_field, 1, as_rec, 5))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    do
+    {
+        h_filter = db_filter_range(h_db, 0, (const uint8_t *)"10000000000000000000", 20, NULL, 0);
+        if((NULL == h_filter) ||
+           (1 != db_filter_find_all(h_db, h_filter, au32_id, 8)) || (0 != au32_id[0]))
+            break;
+        db_filter_free(h_filter);
+
+        h_filter = db_filter_range(h_db, 0, (const uint8_t *)"-1", 2, (const uint8_t *)"9223372036854775807", 19);
+        if((NULL == h_filter) ||
+           (2 != db_filter_find_all(h_db, h_filter, au32_id, 8)) || (1 != au32_id[0]) || (2 != au32_id[1]))
+            break;
+        db_filter_free(h_filter);
+
+        h_filter = db_filter_eq(h_db, 0, (const uint8_t *)"-9999999999999999999", 20);
+        if((NULL == h_filter) ||
+           (1 != db_filter_find_all(h_db, h_filter, au32_id, 8)) || (3 != au32_id[0]))
+            break;
+
+        b_ret = true;
+    }while(0);
+
+    db_filter_free(h_filter);
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* fixed point getters report values which overflow once scaled */
+static bool _test_fixed_overflow(void)
+{
+    struct test_field ast_field[] = {{"VAL", 'N', 20, 2}};
+    const char *as_rec[] =
+    {
+        "99999999999999999.99",
+        "   92233720368547.75",
+        "               -1.25",
+    };
+    uint8_t au8_rec[21];
+    uint8_t au8_null[3];
+    int64_t ai64_val[3];
+    int64_t i64_val;
+    hdb h_db;
+    bool b_ret;
+
+    if(false == _table_write(s_table, ast_field, 1, as_rec, 3))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    au8_rec[0] = ' ';
+    memcpy(&au8_rec[1], as_rec[1], 20);
+
+    b_ret = (false == db_field_get_fixed(h_db, au8_rec, 0, 6, &i64_val)) &&
+            (true == db_field_get_fixed(h_db, au8_rec, 0, 4, &i64_val)) && (922337203685477500ll == i64_val) &&
+            (3 == db_column_get_fixed(h_db, 0, 0, 3, 2, ai64_val, au8_null)) &&
+            (1 == au8_null[0]) && (0 == au8_null[1]) && (0 == au8_null[2]) &&
+            (9223372036854775ll == ai64_val[1]) && (-125 == ai64_val[2]);
+
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* a paged table starts empty and grows, blocks are clamped to the budget */
+static bool _test_paged_empty(void)
+{
+    struct test_field ast_field[] = {{"ID", 'C', 6, 0}};
+    const char *as_rec[] = {"A00001", "A00002", "A00003"};
+    struct db_config st_config = {.u8_access=DB_ACCESS_PAGED,.u32_cache_size=64,.u32_blk_rec_num=0xffffffff};
+    struct db_info st_info = {0};
+    uint32_t u32_first_id = 0;
+    uint32_t u32_num = 0;
+    hdb h_db;
+    bool b_ret;
+
+    if(false == _table_write(s_table, ast_field, 1, as_rec, 0))
+        return false;
+
+    h_db = db_open_ex(s_table, &st_config);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = (true == db_get_info(h_db, &st_info)) && (0 == st_info.u32_rec_num) &&
+            (0 == db_record_find(h_db, 0, 0, (const uint8_t *)"A00001", NULL, NULL).u32_data_len) &&
+            (true == _table_append(s_table, as_rec, 3)) &&
+            (true == db_refresh(h_db, &u32_first_id, &u32_num)) && (0 == u32_first_id) && (3 == u32_num) &&
+            (2 == db_record_find(h_db, 0, 0, (const uint8_t *)"A00003", NULL, NULL).u32_rec_id) &&
+            (0 == memcmp(db_record_find(h_db, 0, 0, (const uint8_t *)"A00001", NULL, NULL).pu8_data, " A00001", 7));
+
+    db_close(h_db);
+
+    return b_ret;
+}
+
+static long _file_read(const char *s_file_name, uint8_t *pu8_buf, long l_len)
+{
+    FILE *fp = fopen(s_file_name, "rb");
+    long l_read;
+
+    if(NULL == fp)
+        return -1;
+
+    l_read = fread(pu8_buf, 1, l_len, fp);
+    fclose(fp);
+
+    return l_read;
+}
+
+/* a corrupt sidecar neither loops nor is written again by open */
+static bool _test_hix_corrupt(void)
+{
+    struct test_field ast_field[] = {{"ID", 'C', 6, 0}};
+    const char *as_rec[] = {"A00001", "A00002", "A00002", "A00003"};
+    char s_hix[64];
+    uint8_t au8_hix[4096];
+    uint8_t au8_after[4096];
+    uint32_t au32_id[4];
+    uint32_t u32_mask;
+    uint32_t u32_off;
+    uint32_t u32_num;
+    long l_len;
+    FILE *fp;
+    hdb h_db;
+    bool b_ret;
+
+    snprintf(s_hix, sizeof(s_hix), "/tmp/selftest_%d.HIX", (int)getpid());
+
+    if(false == _table_write(s_table, ast_field, 1, as_rec, 4))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    u32_num = ((true == db_index_build(h_db, 0)) && (true == db_index_save(h_db)))?(1):(0);
+    db_close(h_db);
+
+    l_len = _file_read(s_hix, au8_hix, sizeof(au8_hix));
+    if((0 == u32_num) || (l_len < 56))
+        return false;
+
+    /* link every record to itself, the chains of the first entry loop */
+    u32_mask = au8_hix[44] | au8_hix[45]<<8 | au8_hix[46]<<16 | (uint32_t)au8_hix[47]<<24;
+    u32_off = au8_hix[48] | au8_hix[49]<<8 | au8_hix[50]<<16 | (uint32_t)au8_hix[51]<<24;
+    u32_off += (u32_mask+1)*4;
+    for(uint32_t idx=0; (idx<4) && (u32_off+4*idx+4 <= l_len); idx++)
+    {
+        au8_hix[u32_off+4*idx] = idx+1;
+        memset(&au8_hix[u32_off+4*idx+1], 0, 3);
+    }
+
+    fp = fopen(s_hix, "wb");
+    if(NULL == fp)
+        return false;
+    fwrite(au8_hix, 1, l_len, fp);
+    fclose(fp);
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    u32_num = db_index_find_all(h_db, 0, (const uint8_t *)"A00002", 6, au32_id, 4);
+    db_close(h_db);
+
+    b_ret = (1 == u32_num) && (1 == au32_id[0]) &&
+            (l_len == _file_read(s_hix, au8_after, sizeof(au8_after))) &&
+            (0 == memcmp(au8_hix, au8_after, l_len));
+
+    unlink(s_hix);
+
+    return b_ret;
+}
+
+/* lookups through an index agree with a scan whatever the index holds */
+static bool _test_tag_fallback(void)
+{
+    struct test_field ast_field[] = {{"ID", 'C', 6, 0}};
+    const char *as_rec[] = {"A00001", "A00002", "A00002", "A00003"};
+    const char *as_key[] = {"A00001", "A00002", "A00002", "A00003"};
+    const char *as_new[] = {"A00001", "A00002", "A00002", "A00002"};
+    uint32_t au32_rec_id[] = {0, 1, 2, 3};
+    uint32_t au32_unique_id[] = {0, 1, 3};
+    const char *as_unique[] = {"A00001", "A00002", "A00003"};
+    struct timespec ast_time[2] = {{0, UTIME_OMIT}, {1, 0}};
+    uint32_t au32_id[4];
+    bool b_ret = true;
+
+    for(int i_case=0; (i_case<3) && (true == b_ret); i_case++)
+    {
+        uint32_t u32_num = 3;
+        hdb h_db;
+
+        if(false == _table_write(s_table, ast_field, 1, (2 == i_case)?(as_new):(as_rec), 4))
+            return false;
+
+        /* a UNIQUE tag, a tag missing a record, and a tag older than
+         * the table which still holds the old key of record 3 */
+        if(0 == i_case)
+            b_ret = _index_write(s_index, "ID", 0x01, 6, as_unique, au32_unique_id, 3);
+        else if(1 == i_case)
+            b_ret = _index_write(s_index, "ID", 0, 6, as_unique, au32_unique_id, 3);
+        else
+            b_ret = _index_write(s_index, "ID", 0, 6, as_key, au32_rec_id, 4) &&
+                    (0 == utimensat(AT_FDCWD, s_index, ast_time, 0));
+
+        h_db = db_open(s_table);
+        if((false == b_ret) || (INVALID_DB_HANDLE == h_db))
+            return false;
+
+        if(2 == i_case)
+            u32_num = 4;
+
+        b_ret = (true == db_tag_attach(h_db, s_index)) &&
+                (u32_num-1 == db_index_find_all(h_db, 0, (const uint8_t *)"A00002", 6, au32_id, 4)) &&
+                (1 == au32_id[0]) && (2 == au32_id[1]) && ((3 == u32_num) || (3 == au32_id[2])) &&
+                (2 == db_record_find(h_db, 2, 0, (const uint8_t *)"A00002", NULL, NULL).u32_rec_id);
+
+        db_close(h_db);
+    }
+
+    return b_ret;
+}
+
+/* N tags hold doubles, but a lookup matches the field text as a scan */
+static bool _test_tag_num_key(void)
+{
+    struct test_field ast_field[] = {{"VAL", 'N', 5, 2}};
+    const char *as_rec[] = {" 1.00", " 1.50"};
+    uint32_t au32_rec_id[] = {0, 1};
+    double ad_val[] = {1.0, 1.5};
+    char as_buf[2][8];
+    const char *as_key[] = {as_buf[0], as_buf[1]};
+    uint32_t au32_id[2];
+    hdb h_db;
+    bool b_ret;
+
+    /* big endian doubles with the sign bit set for positive values */
+    for(int idx=0; idx<2; idx++)
+    {
+        uint64_t u64_val;
+
+        memcpy(&u64_val, &ad_val[idx], sizeof(u64_val));
+        u64_val |= 1ull<<63;
+        for(int i_byte=7; i_byte>=0; i_byte--, u64_val>>=8)
+            as_buf[idx][i_byte] = u64_val&0xff;
+    }
+
+    if((false == _table_write(s_table, ast_field, 1, as_rec, 2)) ||
+       (false == _index_write(s_index, "VAL", 0, 8, as_key, au32_rec_id, 2)))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = (true == db_tag_attach(h_db, s_index)) &&
+            (1 == db_tag_seek(h_db, 0, (const uint8_t *)"1.5", 3).u32_rec_id) &&
+            (0 == db_index_find_all(h_db, 0, (const uint8_t *)"1.5", 3, au32_id, 2)) &&
+            (1 == db_index_find_all(h_db, 0, (const uint8_t *)"1.50", 4, au32_id, 2)) && (1 == au32_id[0]) &&
+            (0 == db_record_find(h_db, 0, 0, (const uint8_t *)"1", NULL, NULL).u32_data_len);
+
+    db_close(h_db);
+
+    return b_ret;
+}
+
+static bool _order_visit(hdb h_db, const struct db_record *pst_record, void *pv_usr_data)
+{
+    uint32_t *pu32_id = (uint32_t *)pv_usr_data;
+
+    pu32_id[++pu32_id[0]] = pst_record->u32_rec_id;
+
+    return (pu32_id[0] < 7);
+}
+
+/* ordered index on a D field, reused from the sidecar by the next open */
+static bool _test_order_date(void)
+{
+    struct test_field ast_field[] = {{"DAY", 'D', 8, 0}};
+    const char *as_rec[] = {"20180206", "20180205", "        ", "20180204", "20180205", "20200229"};
+    const uint32_t *pu32_rec_id = NULL;
+    uint32_t au32_id[8] = {0};
+    char s_hix[64];
+    hdb h_db;
+    bool b_ret;
+
+    snprintf(s_hix, sizeof(s_hix), "/tmp/selftest_%d.HIX", (int)getpid());
+
+    if(false == _table_write(s_table, ast_field, 1, as_rec, 6))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = (true == db_order_build(h_db, 0)) &&
+            (true == db_order_range(h_db, 0, NULL, 0, NULL, 0, _order_visit, au32_id)) &&
+            (5 == au32_id[0]) && (3 == au32_id[1]) && (1 == au32_id[2]) && (4 == au32_id[3]) &&
+            (0 == au32_id[4]) && (5 == au32_id[5]) &&
+            (true == db_index_save(h_db));
+    db_close(h_db);
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    /* no build, the index comes from the sidecar */
+    b_ret = b_ret &&
+            (2 == db_order_slice(h_db, 0, (const uint8_t *)"2018/02/05", 10, (const uint8_t *)"20180205", 8, &pu32_rec_id)) &&
+            (1 == pu32_rec_id[0]) && (4 == pu32_rec_id[1]) &&
+            (1 == db_order_slice(h_db, 0, (const uint8_t *)"20200229", 8, NULL, 0, NULL)) &&
+            (0 == db_order_slice(h_db, 0, (const uint8_t *)"2018020", 7, NULL, 0, NULL)) &&
+            (0 == db_order_slice(h_db, 0, (const uint8_t *)"201802050", 9, NULL, 0, NULL)) &&
+            (0 == db_order_slice(h_db, 0, (const uint8_t *)"201802050000000000", 18, NULL, 0, NULL)) &&
+            (0 == db_order_slice(h_db, 0, (const uint8_t *)"20190229", 8, NULL, 0, NULL)) &&
+            (0 == db_order_slice(h_db, 0, (const uint8_t *)"20181301", 8, NULL, 0, NULL)) &&
+            (0 == db_order_slice(h_db, 0, NULL, 0, (const uint8_t *)"20180200", 8, NULL)) &&
+            (2 == db_order_slice(h_db, 0, (const uint8_t *)"20180205 00:00:00", 17, (const uint8_t *)"20180205235959", 14, NULL)) &&
+            (0 == db_order_slice(h_db, 0, (const uint8_t *)"20180205 24:00:00", 17, NULL, 0, NULL));
+    db_close(h_db);
+
+    unlink(s_hix);
+
+    return b_ret;
+}
+
+/* typed columns, with a dBase B memo pointer left as bytes */
+static bool _test_project(void)
+{
+    struct test_field ast_field[] =
+    {
+        {"NAME", 'C', 5, 0}, {"VAL", 'N', 6, 2}, {"DAY", 'D', 8, 0},
+        {"OK", 'L', 1, 0}, {"MEMO", 'B', 10, 0}, {"QTY", 'I', 4, 0},
+    };
+    const char *as_rec[] =
+    {
+        "abc   12.5020180205T        12\x05\x00\x00\x00",
+        "           20180230?          \xff\xff\xff\xff",
+        "xyz   -1.2520200229f         3\x00\x00\x00\x80",
+    };
+    uint32_t au32_field_idx[] = {0, 1, 2, 3, 4, 5};
+    struct db_column ast_column[6];
+    hdb h_db;
+    bool b_ret;
+
+    if((false == _table_write(s_table, ast_field, 6, as_rec, 3)) || (false == _table_delete(s_table, 2)))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    if(false == db_project(h_db, au32_field_idx, 6, 0, 0, ast_column))
+    {
+        db_close(h_db);
+        return false;
+    }
+
+    b_ret = (3 == ast_column[0].u32_row_num) &&
+            (DB_COLUMN_STR == ast_column[0].u8_type) &&
+            (3 == ast_column[0].pu16_len[0]) && (0 == ast_column[0].pu16_len[1]) &&
+            (0 == memcmp(ast_column[0].pv_data, "abc  ", 5)) &&
+            (0 == ast_column[0].pu8_null[0]) && (1 == ast_column[0].pu8_null[1]) && (0 == ast_column[0].pu8_null[2]) &&
+            (DB_COLUMN_DOUBLE == ast_column[1].u8_type) &&
+            (12.5 == ((double *)ast_column[1].pv_data)[0]) && (1 == ast_column[1].pu8_null[1]) &&
+            (-1.25 == ((double *)ast_column[1].pv_data)[2]) &&
+            (DB_COLUMN_DATE == ast_column[2].u8_type) &&
+            (17567 == ((int32_t *)ast_column[2].pv_data)[0]) && (1 == ast_column[2].pu8_null[1]) &&
+            (18321 == ((int32_t *)ast_column[2].pv_data)[2]) && (0 == ast_column[2].pu8_null[2]) &&
+            (DB_COLUMN_BOOL == ast_column[3].u8_type) &&
+            (1 == ((uint8_t *)ast_column[3].pv_data)[0]) && (1 == ast_column[3].pu8_null[1]) &&
+            (0 == ((uint8_t *)ast_column[3].pv_data)[2]) && (0 == ast_column[3].pu8_null[2]) &&
+            (DB_COLUMN_STR == ast_column[4].u8_type) && (10 == ast_column[4].u32_width) &&
+            (10 == ast_column[4].pu16_len[0]) && (1 == ast_column[4].pu8_null[1]) &&
+            (0 == memcmp((uint8_t *)ast_column[4].pv_data+20, "         3", 10)) &&
+            (DB_COLUMN_INT64 == ast_column[5].u8_type) &&
+            (5 == ((int64_t *)ast_column[5].pv_data)[0]) && (-1 == ((int64_t *)ast_column[5].pv_data)[1]) &&
+            (INT32_MIN == ((int64_t *)ast_column[5].pv_data)[2]);
+
+    for(int idx=0; (idx<6) && (true == b_ret); idx++)
+    {
+        b_ret = (0 == ast_column[idx].pu8_deleted[0]) && (0 == ast_column[idx].pu8_deleted[1]) &&
+                (1 == ast_column[idx].pu8_deleted[2]);
+    }
+
+    db_column_free(ast_column, 6);
+    db_close(h_db);
+
+    return b_ret;
+}
+
+static bool _follow_tag(hdb h_db, uint32_t u32_first_id, uint32_t u32_num, void *pv_usr_data)
+{
+    struct test_follow *pst_follow = (struct test_follow *)pv_usr_data;
+    const char *as_rec[] = {"A00004", "A00002"};
+    uint32_t au32_id[4];
+
+    if(0 == pst_follow->u32_call++)
+    {
+        /* the key is not in the table yet */
+        if(0 != db_index_find(h_db, 0, (const uint8_t *)"A00004", 6).u32_data_len)
+            return false;
+
+        return _table_append(s_table, as_rec, 2);
+    }
+
+    if(0 == u32_num)
+        return (pst_follow->u32_call < 100);
+
+    pst_follow->b_pass = (3 == u32_first_id) && (2 == u32_num) &&
+            (3 == db_index_find(h_db, 0, (const uint8_t *)"A00004", 6).u32_rec_id) &&
+            (4 == db_record_find(h_db, 2, 0, (const uint8_t *)"A00002", NULL, NULL).u32_rec_id) &&
+            (2 == db_index_find_all(h_db, 0, (const uint8_t *)"A00002", 6, au32_id, 4)) &&
+            (1 == au32_id[0]) && (4 == au32_id[1]);
+
+    return false;
+}
+
+/* records appended while following are found through a stale tag */
+static bool _test_follow_tag(void)
+{
+    struct test_field ast_field[] = {{"ID", 'C', 6, 0}};
+    const char *as_rec[] = {"A00001", "A00002", "A00003"};
+    uint32_t au32_rec_id[] = {0, 1, 2};
+    struct test_follow st_follow = {0};
+    hdb h_db;
+
+    if((false == _table_write(s_table, ast_field, 1, as_rec, 3)) ||
+       (false == _index_write(s_index, "ID", 0, 6, as_rec, au32_rec_id, 3)))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    if((true == db_tag_attach(h_db, s_index)) && (1 == db_tag_get_num(h_db)) &&
+       (1 == db_tag_seek(h_db, 0, (const uint8_t *)"A00002", 6).u32_rec_id))
+        db_follow(h_db, 10, _follow_tag, &st_follow);
+
+    db_close(h_db);
+
+    return st_follow.b_pass;
+}
+
+/* collect the output of db_export */
+static bool _export_writer(const uint8_t *pu8_data, uint32_t u32_len, void *pv_usr_data)
+{
+    struct test_buf *pst_buf = (struct test_buf *)pv_usr_data;
+    uint8_t *pu8_new = (uint8_t *)realloc(pst_buf->pu8_data, pst_buf->t_len+u32_len+1);
+
+    if(NULL == pu8_new)
+        return false;
+
+    memcpy((void *)&pu8_new[pst_buf->t_len], (void *)pu8_data, u32_len);
+    pst_buf->t_len += u32_len;
+    pst_buf->pu8_data = pu8_new;
+    pst_buf->pu8_data[pst_buf->t_len] = '\0';
+
+    return true;
+}
+
+/* CSV quotes and JSON escapes */
+static bool _test_export_text(void)
+{
+    struct test_field ast_field[] = {{"NAME", 'C', 6, 0}, {"VAL", 'N', 5, 1}, {"DAY", 'D', 8, 0}};
+    const char *as_rec[] =
+    {
+        "a\"b,c   1.520180205",
+        "x\x01\\y               ",
+    };
+    struct db_export st_export = {.b_header=true,.b_crlf=true};
+    struct test_buf st_csv = {0};
+    struct test_buf st_json = {0};
+    hdb h_db;
+    bool b_ret;
+
+    if(false == _table_write(s_table, ast_field, 3, as_rec, 2))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = db_export(h_db, &st_export, _export_writer, &st_csv);
+
+    st_export.u8_format = DB_EXPORT_JSONL;
+    b_ret = (true == b_ret) && (true == db_export(h_db, &st_export, _export_writer, &st_json));
+
+    b_ret = (true == b_ret) &&
+            (0 == strcmp((char *)st_csv.pu8_data,
+                "NAME,VAL,DAY\r\n"
+                "\"a\"\"b,c\",1.5,2018-02-05\r\n"
+                "x\x01\\y,,\r\n")) &&
+            (0 == strcmp((char *)st_json.pu8_data,
+                "{\"NAME\":\"a\\\"b,c\",\"VAL\":1.5,\"DAY\":\"2018-02-05\"}\n"
+                "{\"NAME\":\"x\\u0001\\\\y\",\"VAL\":null,\"DAY\":null}\n"));
+
+    free(st_csv.pu8_data);
+    free(st_json.pu8_data);
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* several workers write the same bytes as the calling thread */
+static bool _test_export_parallel(void)
+{
+    struct test_field ast_field[] = {{"ID", 'N', 6, 0}, {"NAME", 'C', 7, 0}};
+    const uint32_t u32_rec_num = 60000;
+    struct db_export st_export = {.u8_format=DB_EXPORT_JSONL};
+    struct test_buf st_serial = {0};
+    struct test_buf st_parallel = {0};
+    const char **as_rec;
+    char *s_data;
+    hdb h_db;
+    bool b_ret = false;
+
+    as_rec = (const char **)malloc(u32_rec_num*sizeof(char *));
+    s_data = (char *)malloc(u32_rec_num*14);
+    if(!as_rec || !s_data)
+    {
+        free(as_rec);
+        free(s_data);
+        return false;
+    }
+
+    for(uint32_t idx=0; idx<u32_rec_num; idx++)
+    {
+        snprintf(&s_data[idx*14], 14, "%6u%-7s", idx, (idx%3)?("item"):("x,\"y"));
+        as_rec[idx] = &s_data[idx*14];
+    }
+
+    b_ret = _table_write(s_table, ast_field, 2, as_rec, u32_rec_num);
+    free(as_rec);
+    free(s_data);
+
+    h_db = (true == b_ret)?(db_open(s_table)):(INVALID_DB_HANDLE);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = db_export(h_db, &st_export, _export_writer, &st_serial);
+
+    st_export.u32_worker_num = 4;
+    b_ret = (true == b_ret) && (true == db_export(h_db, &st_export, _export_writer, &st_parallel)) &&
+            (st_serial.t_len == st_parallel.t_len) &&
+            (0 == memcmp(st_serial.pu8_data, st_parallel.pu8_data, st_serial.t_len)) &&
+            (NULL != strstr((char *)st_serial.pu8_data, "{\"ID\":59999,\"NAME\":\"item\"}\n"));
+
+    free(st_serial.pu8_data);
+    free(st_parallel.pu8_data);
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* memos are handed out in place and read in parts */
+static bool _test_memo(void)
+{
+    struct test_field ast_field[] = {{"NAME", 'C', 4, 0}, {"NOTE", 'M', 4, 0}};
+    const char *as_rec[] =
+    {
+        "n1  \x08\x00\x00\x00",
+        "n2  \x00\x00\x00\x00",
+        "n3  \x09\x00\x00\x00",
+    };
+    const char *as_memo[] =
+    {
+        "hello memo",
+        "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789",
+    };
+    struct db_record ast_record[3];
+    struct db_memo st_memo;
+    struct db_view st_view;
+    struct db_var st_var;
+    struct test_buf st_buf = {0};
+    uint8_t au8_buf[32];
+    hdb_cursor h_cursor;
+    hdb h_db;
+    bool b_ret = false;
+
+    if((false == _table_write(s_table, ast_field, 2, as_rec, 3)) || (false == _memo_write(s_table, as_memo, 2)))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    h_cursor = db_cursor_open(h_db);
+
+    do
+    {
+        if(3 != db_cursor_next_batch(h_cursor, ast_record, 3))
+            break;
+
+        /* a mapped memo is viewed where it lies */
+        if((false == db_memo_open(h_db, ast_record[0].pu8_data, 1, &st_memo)) || (10 != st_memo.u32_len) ||
+           (NULL == db_memo_ptr(h_db, &st_memo)) || (0 != memcmp(db_memo_ptr(h_db, &st_memo), "hello memo", 10)) ||
+           (false == db_field_view(h_db, ast_record[0].pu8_data, 1, &st_view, NULL, 0)) ||
+           (st_view.pu8_data != db_memo_ptr(h_db, &st_memo)) || (10 != st_view.u32_data_len))
+            break;
+
+        st_var = db_field_map_data(h_db, ast_record[0].pu8_data, 1);
+        b_ret = (NULL != st_var.pv_data) && (0 == strcmp((char *)st_var.pv_data, "hello memo "));
+        db_field_unmap_data(h_db, &st_var);
+        if(false == b_ret)
+            break;
+
+        b_ret = false;
+        if((false == db_memo_open(h_db, ast_record[1].pu8_data, 1, &st_memo)) || (0 != st_memo.u32_len) ||
+           (NULL != db_memo_ptr(h_db, &st_memo)))
+            break;
+
+        /* a memo over two blocks */
+        if((false == db_memo_open(h_db, ast_record[2].pu8_data, 1, &st_memo)) || (100 != st_memo.u32_len) ||
+           (10 != db_memo_read(h_db, &st_memo, 90, au8_buf, sizeof(au8_buf))) || (0 != memcmp(au8_buf, "0123456789", 10)) ||
+           (0 != db_memo_read(h_db, &st_memo, 100, au8_buf, sizeof(au8_buf))) ||
+           (false == db_memo_stream(h_db, &st_memo, 16, _export_writer, &st_buf)))
+            break;
+
+        b_ret = (100 == st_buf.t_len) && (0 == memcmp(st_buf.pu8_data, as_memo[1], 100));
+    }while(0);
+
+    free(st_buf.pu8_data);
+    db_cursor_close(h_cursor);
+    db_close(h_db);
+    unlink(s_memo);
+
+    return b_ret;
+}
+
+/* visit every record of a table of numbered records */
+static bool _check_seq(hdb h_db, uint32_t u32_rec_num)
+{
+    hdb_cursor h_cursor = db_cursor_open(h_db);
+    struct db_record st_record;
+    char s_id[9];
+    uint32_t u32_id = 0;
+
+    if(NULL == h_cursor)
+        return false;
+
+    for(st_record=db_cursor_next(h_cursor); NULL != st_record.pu8_data; st_record=db_cursor_next(h_cursor))
+    {
+        snprintf(s_id, sizeof(s_id), "%8u", u32_id);
+        if((st_record.u32_rec_id != u32_id) || (0 != memcmp(&st_record.pu8_data[1], s_id, 8)))
+            break;
+
+        u32_id++;
+    }
+
+    db_cursor_close(h_cursor);
+
+    return u32_id == u32_rec_num;
+}
+
+/* a cached table larger than one read chunk and a paged table read
+ * ahead, by io_uring or by the pread threads of a DB_NO_IO_URING build */
+static bool _test_read_ahead(void)
+{
+    struct test_field ast_field[] = {{"ID", 'N', 8, 0}};
+    struct db_config st_config = {.u8_access=DB_ACCESS_PAGED,.u32_cache_size=64*1024,.u32_blk_rec_num=512,.u8_read_ahead=4};
+    const uint32_t u32_rec_num = 150000;
+    const char **as_rec;
+    char *s_data;
+    hdb h_db;
+    bool b_ret;
+
+    as_rec = (const char **)malloc(u32_rec_num*sizeof(char *));
+    s_data = (char *)malloc(u32_rec_num*9);
+    if(!as_rec || !s_data)
+    {
+        free(as_rec);
+        free(s_data);
+        return false;
+    }
+
+    for(uint32_t idx=0; idx<u32_rec_num; idx++)
+    {
+        snprintf(&s_data[idx*9], 9, "%8u", idx);
+        as_rec[idx] = &s_data[idx*9];
+    }
+
+    b_ret = _table_write(s_table, ast_field, 1, as_rec, u32_rec_num);
+    free(as_rec);
+    free(s_data);
+    if(false == b_ret)
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = _check_seq(h_db, u32_rec_num);
+    db_close(h_db);
+
+    h_db = db_open_ex(s_table, &st_config);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    b_ret = (true == b_ret) && (true == _check_seq(h_db, u32_rec_num));
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* Big5 text of a CP950 table read as UTF-8 */
+static bool _test_code_page(void)
+{
+    struct test_field ast_field[] = {{"CITY", 'C', 8, 0}};
+    const char *as_rec[] = {"\xa5\x78\xa4\xa4    "};
+    const uint8_t au8_utf8[] = {0xe5, 0x8f, 0xb0, 0xe4, 0xb8, 0xad};
+    struct db_config st_config = {.s_encode="utf-8"};
+    struct db_record st_record;
+    struct db_info st_info;
+    hdb_cursor h_cursor;
+    uint8_t au8_buf[24];
+    uint8_t u8_code_page;
+    uint32_t u32_used;
+    uint32_t u32_len;
+    hdb h_db;
+    bool b_ret = false;
+    FILE *fp;
+
+    if((false == db_cp_find("cp950", &u8_code_page)) || (false == _table_write(s_table, ast_field, 1, as_rec, 1)))
+        return false;
+
+    /* the language driver byte of the header */
+    fp = fopen(s_table, "r+b");
+    if(NULL == fp)
+        return false;
+
+    fseek(fp, 29, SEEK_SET);
+    fputc(u8_code_page, fp);
+    if(0 != fclose(fp))
+        return false;
+
+    /* a character not fitting the buffer is left for the next call */
+    if((6 != db_cp_to_utf8(u8_code_page, (const uint8_t *)as_rec[0], 4, au8_buf, sizeof(au8_buf), &u32_used)) ||
+       (4 != u32_used) || (0 != memcmp(au8_buf, au8_utf8, 6)) ||
+       (3 != db_cp_to_utf8(u8_code_page, (const uint8_t *)as_rec[0], 4, au8_buf, 5, &u32_used)) || (2 != u32_used))
+        return false;
+
+    h_db = db_open(s_table);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    h_cursor = db_cursor_open(h_db);
+    st_record = db_cursor_next(h_cursor);
+    b_ret = (NULL != st_record.pu8_data) && (true == db_get_info(h_db, &st_info)) && (u8_code_page == st_info.u8_code_page) &&
+            (true == db_field_get_utf8(h_db, st_record.pu8_data, 0, au8_buf, sizeof(au8_buf), &u32_len)) &&
+            (6 == u32_len) && (0 == memcmp(au8_buf, au8_utf8, 6));
+    db_cursor_close(h_cursor);
+    db_close(h_db);
+
+    /* a code page given at open overrides the header */
+    h_db = db_open_ex(s_table, &st_config);
+    if(INVALID_DB_HANDLE == h_db)
+        return false;
+
+    h_cursor = db_cursor_open(h_db);
+    st_record = db_cursor_next(h_cursor);
+    b_ret = (true == b_ret) && (NULL != st_record.pu8_data) &&
+            (true == db_field_get_utf8(h_db, st_record.pu8_data, 0, au8_buf, sizeof(au8_buf), &u32_len)) &&
+            (4 == u32_len) && (0 == memcmp(au8_buf, as_rec[0], 4));
+    db_cursor_close(h_cursor);
+    db_close(h_db);
+
+    return b_ret;
+}
+
+/* record each pair of a join, UINT32_MAX for a missing right record */
+static bool _join_visit(const struct db_record *pst_left, const struct db_record *pst_right, void *pv_usr_data)
+{
+    struct test_join *pst_join = (struct test_join *)pv_usr_data;
+
+    if(pst_join->u32_num >= 8)
+        return false;
+
+    pst_join->au32_pair[pst_join->u32_num][0] = pst_left->u32_rec_id;
+    pst_join->au32_pair[pst_join->u32_num][1] = (NULL != pst_right)?(pst_right->u32_rec_id):(UINT32_MAX);
+    pst_join->u32_num++;
+
+    return true;
+}
+
+/* orders joined to their customers, one order of an unknown customer */
+static bool _test_join(void)
+{
+    struct test_field ast_order_field[] = {{"CUST", 'C', 4, 0}, {"QTY", 'N', 3, 0}};
+    struct test_field ast_cust_field[] = {{"ID", 'C', 4, 0}};
+    const char *as_order[] = {"c1    1", "c2    2", "c9    3", "c1    4"};
+    const char *as_cust[] = {"c1  ", "c2  ", "c3  "};
+    const uint32_t au32_inner[][2] = {{0, 0}, {1, 1}, {3, 0}};
+    const uint32_t au32_left[][2] = {{0, 0}, {1, 1}, {2, UINT32_MAX}, {3, 0}};
+    struct test_join st_inner = {0};
+    struct test_join st_left = {0};
+    char s_cust[64];
+    hdb h_order;
+    hdb h_cust;
+    bool b_ret;
+
+    snprintf(s_cust, sizeof(s_cust), "/tmp/selftest_%d_cust.dbf", (int)getpid());
+
+    if((false == _table_write(s_table, ast_order_field, 2, as_order, 4)) ||
+       (false == _table_write(s_cust, ast_cust_field, 1, as_cust, 3)))
+        return false;
+
+    h_order = db_open(s_table);
+    h_cust = db_open(s_cust);
+
+    b_ret = (INVALID_DB_HANDLE != h_order) && (INVALID_DB_HANDLE != h_cust) &&
+            (true == db_join(h_order, 0, h_cust, 0, DB_JOIN_INNER, _join_visit, &st_inner)) &&
+            (true == db_join(h_order, 0, h_cust, 0, DB_JOIN_LEFT, _join_visit, &st_left)) &&
+            (3 == st_inner.u32_num) && (0 == memcmp(st_inner.au32_pair, au32_inner, sizeof(au32_inner))) &&
+            (4 == st_left.u32_num) && (0 == memcmp(st_left.au32_pair, au32_left, sizeof(au32_left)));
+
+    if(INVALID_DB_HANDLE != h_order)
+        db_close(h_order);
+
+    if(INVALID_DB_HANDLE != h_cust)
+        db_close(h_cust);
+
+    unlink(s_cust);
+
+    return b_ret;
+}
+
+/* blocks of an arena are used again after a reset, a value larger
+ * than a block gets a block of its own */
+static bool _test_arena(void)
+{
+    struct test_field ast_field[] = {{"NAME", 'C', 6, 0}};
+    const char *as_rec[] = {"abc   "};
+    struct db_record st_record;
+    struct db_var st_var;
+    hdb_cursor h_cursor;
+    hdb_arena h_arena;
+    uint8_t *pu8_first;
+    uint8_t *pu8_second;
+    uint8_t *pu8_large;
+    uint8_t *pu8_next;
+    hdb h_db;
+    bool b_ret = false;
+
+    h_arena = db_arena_create(64);
+    if(NULL == h_arena)
+        return false;
+
+    do
+    {
+        pu8_first = (uint8_t *)db_arena_alloc(h_arena, 10);
+        pu8_second = (uint8_t *)db_arena_alloc(h_arena, 10);
+        pu8_large = (uint8_t *)db_arena_alloc(h_arena, 1000);
+        pu8_next = (uint8_t *)db_arena_alloc(h_arena, 10);
+        if(!pu8_first || !pu8_second || !pu8_large || !pu8_next ||
+           (pu8_second != pu8_first+16) || (0 != ((uintptr_t)pu8_large&7)))
+            break;
+
+        memset((void *)pu8_large, 0x5a, 1000);
+
+        db_arena_reset(h_arena);
+        if((pu8_first != db_arena_alloc(h_arena, 10)) || (pu8_second != db_arena_alloc(h_arena, 10)) ||
+           (pu8_next != db_arena_alloc(h_arena, 48)))
+            break;
+
+        db_arena_reset(h_arena);
+        if(false == _table_write(s_table, ast_field, 1, as_rec, 1))
+            break;
+
+        h_db = db_open(s_table);
+        if(INVALID_DB_HANDLE == h_db)
+            break;
+
+        /* mapped values come from the arena */
+        h_cursor = db_cursor_open(h_db);
+        st_record = db_cursor_next(h_cursor);
+        if(NULL != st_record.pu8_data)
+        {
+            st_var = db_field_map_data_arena(h_db, st_record.pu8_data, 0, h_arena);
+            b_ret = ((uint8_t *)st_var.pv_data == pu8_first) && (0 == strcmp((char *)st_var.pv_data, "abc "));
+        }
+
+        db_cursor_close(h_cursor);
+        db_close(h_db);
+    }while(0);
+
+    db_arena_free(h_arena);
+
+    return b_ret;
+}
+
+static const struct test_case ast_test[] =
+{
+    {"paged access of an empty table", _test_paged_empty},
+    {"corrupt hash index sidecar", _test_hix_corrupt},
+    {"index tags a scan does not trust", _test_tag_fallback},
+    {"numeric tag keys", _test_tag_num_key},
+    {"ordered index on a date", _test_order_date},
+    {"projection into columns", _test_project},
+    {"binary field mapping", _test_field_map_bin},
+    {"filter on a max-width N field", _test_filter_wide_num},
+    {"fixed point overflow", _test_fixed_overflow},
+    {"follow a table with a tag", _test_follow_tag},
+    {"export quoting and escapes", _test_export_text},
+    {"parallel export", _test_export_parallel},
+    {"memo access", _test_memo},
+    {"read ahead", _test_read_ahead},
+    {"code page to UTF-8", _test_code_page},
+    {"hash join", _test_join},
+    {"arena reuse", _test_arena},
+};
+
+int main(int argc, char **argv)
+{
+    uint32_t u32_fail = 0;
+
+    snprintf(s_table, sizeof(s_table), "/tmp/selftest_%d.dbf", (int)getpid());
+    snprintf(s_index, sizeof(s_index), "/tmp/selftest_%d.idx", (int)getpid());
+    snprintf(s_memo, sizeof(s_memo), "/tmp/selftest_%d.FPT", (int)getpid());
+
+    for(uint32_t idx=0; idx<sizeof(ast_test)/sizeof(ast_test[0]); idx++)
+    {
+        bool b_pass = ast_test[idx].pf_run();
+
+        printf("%s: %s\n", (b_pass)?("ok"):("FAIL"), ast_test[idx].s_name);
+        u32_fail += (b_pass)?(0):(1);
+    }
+
+    unlink(s_table);
+    unlink(s_index);
+
+    return (0 == u32_fail)?(0):(1);
+}